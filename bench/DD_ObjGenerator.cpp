@@ -0,0 +1,303 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include "DD_ObjGenerator.h"
+#include "DD_TextWriter.h"
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	const char* const k_shape_names[k_num_obj_shapes] = {
+		"grid", "fan", "materials", "reuse", "soup"
+	};
+	const float k_pi = 3.14159265f;
+
+	/// \brief xorshift32: same sequence on every platform (unlike the
+	/// std distributions)
+	struct Random
+	{
+		uint32_t state;
+
+		Random(const uint32_t seed) : state(seed ? seed : 1u) {}
+
+		uint32_t next()
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return state;
+		}
+
+		// [0, 1)
+		float unit() { return (next() >> 8) * (1.f / 16777216.f); }
+	};
+
+	/// \brief obj records on top of DD_TextWriter
+	struct ObjWriter
+	{
+		DD_TextWriter out;
+
+		void vec(const char* tag, const float* val, const unsigned count)
+		{
+			out.put(tag);
+			for (unsigned i = 0; i < count; i++) {
+				out.put(' ');
+				out.putFixed(val[i], 6);
+			}
+			out.put('\n');
+		}
+
+		// 1-based corners, each "v/v/v" or "v/vt/vn"
+		void face(const unsigned* v, const unsigned* vt, const unsigned* vn,
+				  const unsigned count)
+		{
+			out.put('f');
+			for (unsigned i = 0; i < count; i++) {
+				out.put(' ');
+				out.putUnsigned(v[i]);
+				out.put('/');
+				out.putUnsigned(vt[i]);
+				out.put('/');
+				out.putUnsigned(vn[i]);
+			}
+			out.put('\n');
+		}
+
+		void usemtl(const unsigned id)
+		{
+			out.put("usemtl mat_");
+			out.putUnsigned(id);
+			out.put('\n');
+		}
+	};
+
+	/// \brief (n + 1)^2 grid vertices of a bumpy height field, v/vt/vn
+	/// numbered alike
+	void gridVertices(ObjWriter &w, const unsigned n, Random &rng)
+	{
+		for (unsigned j = 0; j <= n; j++) {
+			for (unsigned i = 0; i <= n; i++) {
+				const float x = (float)i / n, z = (float)j / n;
+				const float p[3] = {
+					x, 0.05f * std::sin(x * 12.f) * std::cos(z * 9.f) +
+						0.001f * rng.unit(), z };
+				w.vec("v", p, 3);
+			}
+		}
+		for (unsigned j = 0; j <= n; j++) {
+			for (unsigned i = 0; i <= n; i++) {
+				const float t[2] = { (float)i / n, (float)j / n };
+				w.vec("vt", t, 2);
+			}
+		}
+		for (unsigned j = 0; j <= n; j++) {
+			for (unsigned i = 0; i <= n; i++) {
+				const float x = (float)i / n, z = (float)j / n;
+				float nrm[3] = {
+					-0.6f * std::cos(x * 12.f) * std::cos(z * 9.f), 1.f,
+					0.45f * std::sin(x * 12.f) * std::sin(z * 9.f) };
+				const float len = std::sqrt(nrm[0] * nrm[0] + 1.f +
+											nrm[2] * nrm[2]);
+				for (int k = 0; k < 3; k++) { nrm[k] /= len; }
+				w.vec("vn", nrm, 3);
+			}
+		}
+	}
+
+	/// \brief Cells of an n x n grid as quads or triangle pairs. A usemtl is
+	/// written every group_faces faces (0 = one group)
+	void gridFaces(ObjWriter &w, const unsigned n, const bool quads,
+				   const unsigned group_faces)
+	{
+		unsigned faces = 0, groups = 0;
+		if (group_faces == 0) { w.usemtl(0); }
+		for (unsigned j = 0; j < n; j++) {
+			for (unsigned i = 0; i < n; i++) {
+				const unsigned a = j * (n + 1) + i + 1, b = a + 1;
+				const unsigned c = a + n + 1, d = c + 1;
+				const unsigned quad[4] = { a, b, d, c };
+				const unsigned tri0[3] = { a, b, d };
+				const unsigned tri1[3] = { a, d, c };
+				for (unsigned f = 0; f < (quads ? 1u : 2u); f++) {
+					if (group_faces && faces++ % group_faces == 0) {
+						w.usemtl(groups++);
+					}
+					const unsigned* v = quads ? quad : (f ? tri1 : tri0);
+					w.face(v, v, v, quads ? 4 : 3);
+				}
+			}
+		}
+	}
+
+	void writeGrid(ObjWriter &w, const unsigned num_triangles,
+				   const bool quads, const unsigned group_faces, Random &rng)
+	{
+		const unsigned n = (unsigned)std::ceil(std::sqrt(num_triangles / 2.0));
+		gridVertices(w, n ? n : 1, rng);
+		gridFaces(w, n ? n : 1, quads, group_faces);
+	}
+
+	void writeFans(ObjWriter &w, const unsigned num_triangles, Random &rng)
+	{
+		const unsigned num_fans = (num_triangles + k_fan_valence - 1) /
+								  k_fan_valence;
+		const unsigned per_fan = k_fan_valence + 1;	// center + ring
+		const unsigned side = (unsigned)std::ceil(std::sqrt((double)num_fans));
+		for (unsigned f = 0; f < num_fans; f++) {
+			const float cx = (float)(f % side), cz = (float)(f / side);
+			const float center[3] = { cx, 0.2f, cz };
+			w.vec("v", center, 3);
+			for (unsigned i = 0; i < k_fan_valence; i++) {
+				const float a = 2.f * k_pi * i / k_fan_valence;
+				const float r = 0.45f + 0.02f * rng.unit();
+				const float p[3] = { cx + r * std::cos(a), 0.f,
+									 cz + r * std::sin(a) };
+				w.vec("v", p, 3);
+			}
+		}
+		for (unsigned f = 0; f < num_fans; f++) {
+			const float center[2] = { 0.5f, 0.5f };
+			w.vec("vt", center, 2);
+			for (unsigned i = 0; i < k_fan_valence; i++) {
+				const float a = 2.f * k_pi * i / k_fan_valence;
+				const float t[2] = { 0.5f + 0.5f * std::cos(a),
+									 0.5f + 0.5f * std::sin(a) };
+				w.vec("vt", t, 2);
+			}
+		}
+		for (unsigned f = 0; f < num_fans; f++) {
+			const float up[3] = { 0.f, 1.f, 0.f };
+			w.vec("vn", up, 3);
+			for (unsigned i = 0; i < k_fan_valence; i++) {
+				const float a = 2.f * k_pi * i / k_fan_valence;
+				const float nrm[3] = { 0.37f * std::cos(a), 0.93f,
+									   0.37f * std::sin(a) };
+				w.vec("vn", nrm, 3);
+			}
+		}
+		w.usemtl(0);
+		for (unsigned f = 0; f < num_fans; f++) {
+			const unsigned c = f * per_fan + 1;
+			for (unsigned i = 0; i < k_fan_valence; i++) {
+				const unsigned tri[3] = {
+					c, c + 1 + (i + 1) % k_fan_valence, c + 1 + i };
+				w.face(tri, tri, tri, 3);
+			}
+		}
+	}
+
+	void writeReuse(ObjWriter &w, const unsigned num_triangles, Random &rng)
+	{
+		// positions on a sphere; normal = its closest axis
+		unsigned axis_of[k_reuse_positions];
+		for (unsigned i = 0; i < k_reuse_positions; i++) {
+			const float z = 2.f * rng.unit() - 1.f;
+			const float a = 2.f * k_pi * rng.unit();
+			const float r = std::sqrt(1.f - z * z);
+			const float p[3] = { r * std::cos(a), r * std::sin(a), z };
+			w.vec("v", p, 3);
+			unsigned axis = 0;
+			for (unsigned k = 1; k < 3; k++) {
+				if (std::fabs(p[k]) > std::fabs(p[axis])) { axis = k; }
+			}
+			axis_of[i] = axis * 2 + (p[axis] < 0.f ? 1 : 0) + 1;
+		}
+		const float uv[2] = { 0.5f, 0.5f };
+		w.vec("vt", uv, 2);
+		for (unsigned k = 0; k < 6; k++) {
+			float nrm[3] = { 0.f, 0.f, 0.f };
+			nrm[k / 2] = (k % 2) ? -1.f : 1.f;
+			w.vec("vn", nrm, 3);
+		}
+		w.usemtl(0);
+		const unsigned vt[3] = { 1, 1, 1 };
+		for (unsigned t = 0; t < num_triangles; t++) {
+			unsigned v[3], vn[3];
+			for (int c = 0; c < 3; c++) {
+				const unsigned i = rng.next() % k_reuse_positions;
+				v[c] = i + 1;
+				vn[c] = axis_of[i];
+			}
+			w.face(v, vt, vn, 3);
+		}
+	}
+
+	void writeSoup(ObjWriter &w, const unsigned num_triangles, Random &rng)
+	{
+		const unsigned side = (unsigned)std::ceil(
+			std::sqrt((double)num_triangles));
+		for (unsigned t = 0; t < num_triangles; t++) {
+			const float x = (float)(t % side), z = (float)(t / side);
+			for (int c = 0; c < 3; c++) {
+				const float p[3] = { x + rng.unit(), 0.1f * rng.unit(),
+									 z + rng.unit() };
+				w.vec("v", p, 3);
+			}
+		}
+		for (unsigned t = 0; t < num_triangles * 3; t++) {
+			const float uv[2] = { rng.unit(), rng.unit() };
+			w.vec("vt", uv, 2);
+		}
+		for (unsigned t = 0; t < num_triangles * 3; t++) {
+			const float a = 2.f * k_pi * rng.unit();
+			const float nrm[3] = { 0.3f * std::cos(a), 0.954f,
+								   0.3f * std::sin(a) };
+			w.vec("vn", nrm, 3);
+		}
+		w.usemtl(0);
+		for (unsigned t = 0; t < num_triangles; t++) {
+			const unsigned v[3] = { t * 3 + 1, t * 3 + 2, t * 3 + 3 };
+			w.face(v, v, v, 3);
+		}
+	}
+}
+
+const char* dd_objShapeName(const ObjShape shape)
+{
+	return k_shape_names[(unsigned)shape];
+}
+
+bool dd_objShapeFromName(const char* name, ObjShape &shape)
+{
+	for (unsigned i = 0; i < k_num_obj_shapes; i++) {
+		if (strcmp(name, k_shape_names[i]) == 0) {
+			shape = (ObjShape)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool dd_generateObj(const char* filename, const ObjShape shape,
+					const unsigned num_triangles, const uint32_t seed)
+{
+	ObjWriter w;
+	if (!w.out.open(filename)) { return false; }
+	Random rng(seed);
+
+	w.out.put("# ddm bench: ");
+	w.out.put(dd_objShapeName(shape));
+	w.out.put(' ');
+	w.out.putUnsigned(num_triangles);
+	w.out.put('\n');
+	switch (shape) {
+	case ObjShape::GRID:
+		writeGrid(w, num_triangles, true, 0, rng);
+		break;
+	case ObjShape::FAN:
+		writeFans(w, num_triangles, rng);
+		break;
+	case ObjShape::MATERIALS:
+		writeGrid(w, num_triangles, false, k_material_faces, rng);
+		break;
+	case ObjShape::REUSE:
+		writeReuse(w, num_triangles, rng);
+		break;
+	case ObjShape::SOUP:
+		writeSoup(w, num_triangles, rng);
+		break;
+	}
+	return w.out.close();
+}
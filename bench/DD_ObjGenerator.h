@@ -0,0 +1,46 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstdint>
+
+/*-----------------------------------------------------------------------------
+*
+*	Synthetic obj files for benchmarking. Output only depends on shape,
+*	triangle count & seed (and the platform's sin/cos rounding), so every
+*	run parses the same bytes:
+*		grid		- height field of quads (fan triangulated on import),
+*					  v/vt/vn shared by ~6 triangles, one usemtl
+*		fan			- disks of k_fan_valence triangles around a center
+*					  vertex (high valence)
+*		materials	- triangle grid w/ a usemtl every k_material_faces faces
+*		reuse		- random triangles over a small pool of positions, one
+*					  uv and 6 normals: few unique vertices, mostly dedup
+*					  hits
+*		soup		- every corner has its own v/vt/vn: no reuse at all
+*
+-----------------------------------------------------------------------------*/
+
+enum class ObjShape
+{
+	GRID,
+	FAN,
+	MATERIALS,
+	REUSE,
+	SOUP
+};
+
+const unsigned k_num_obj_shapes = 5;
+const unsigned k_fan_valence = 512;
+const unsigned k_material_faces = 64;
+const unsigned k_reuse_positions = 4096;
+
+const char* dd_objShapeName(const ObjShape shape);
+bool dd_objShapeFromName(const char* name, ObjShape &shape);
+
+/// \brief Write an obj w/ about num_triangles triangles (rounded to whole
+/// rows/fans). Returns false if the file can't be written
+bool dd_generateObj(const char* filename, const ObjShape shape,
+					const unsigned num_triangles, const uint32_t seed = 1);
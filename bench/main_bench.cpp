@@ -0,0 +1,303 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "DD_ObjConverter.h"
+#include "DD_ObjGenerator.h"
+#include "DD_ProcessMemory.h"
+
+#ifdef _WIN32
+	#include <direct.h>
+#endif
+#include <sys/stat.h>
+
+/*-----------------------------------------------------------------------------
+*
+*	ddm_bench: generates synthetic obj files (see DD_ObjGenerator.h) and
+*	converts each one several times, reporting the median time of every
+*	stage as one CSV row per file:
+*		- read (open & map), scan (record counting & sizing), parse, dedup
+*		  (vertices & faces), tangents, import (all of the above + optional
+*		  stages), export. read, scan, parse & dedup come from the
+*		  DD_PROFILE stages (0 when built w/o it)
+*		- import MB/s & triangles/s, peak RSS of the case
+*	Generated files are kept in the data directory and reused by later
+*	runs, so only the first run pays for writing them.
+*
+-----------------------------------------------------------------------------*/
+
+namespace
+{
+	struct BenchOptions
+	{
+		std::string				data_dir = "bench_data";
+		const char*				out_file = nullptr;	// stdout if null
+		std::vector<ObjShape>	shapes;
+		std::vector<unsigned>	sizes;				// target triangles
+		unsigned				threads = 1;
+		unsigned				repeats = 3;
+		bool					regenerate = false;
+		DDMFormat				format = DDMFormat::BINARY;
+	};
+
+	/// \brief Named sizes for -s
+	struct SizeName
+	{
+		const char*	name;
+		unsigned	triangles;
+	};
+	const SizeName k_sizes[] = {
+		{ "small", 16384 }, { "medium", 262144 }, { "large", 1048576 }
+	};
+
+	void printUsage(const char* exe)
+	{
+		printf("Usage: %s [options]\n", exe);
+		printf("Options:\n");
+		printf("  -d <dir>  data directory for generated objs "
+			   "(default bench_data)\n");
+		printf("  -o <csv>  write results to a file (default stdout)\n");
+		printf("  -s <lst>  sizes: small, medium, large or a triangle count,"
+			   " comma\n            separated (default small,medium)\n");
+		printf("  -g <lst>  shapes: grid, fan, materials, reuse, soup "
+			   "(default all)\n");
+		printf("  -j <n>    parse threads (0 = all hardware threads, "
+			   "default 1)\n");
+		printf("  -r <n>    runs per file, the median is reported "
+			   "(default 3)\n");
+		printf("  -t        export text .ddm instead of binary\n");
+		printf("  -f        regenerate objs even if they exist\n");
+	}
+
+	/// \brief Split "a,b,c"
+	std::vector<std::string> splitList(const char* list)
+	{
+		std::vector<std::string> items;
+		const char* start = list;
+		while (true) {
+			const char* end = strchr(start, ',');
+			items.push_back(end ? std::string(start, end) :
+								  std::string(start));
+			if (!end) { break; }
+			start = end + 1;
+		}
+		return items;
+	}
+
+	bool parseSizes(const char* list, std::vector<unsigned> &sizes)
+	{
+		sizes.clear();
+		for (const std::string &item : splitList(list)) {
+			unsigned size = 0;
+			for (const SizeName &named : k_sizes) {
+				if (item == named.name) { size = named.triangles; }
+			}
+			if (size == 0) {
+				size = (unsigned)std::strtoul(item.c_str(), nullptr, 10);
+			}
+			if (size == 0) { return false; }
+			sizes.push_back(size);
+		}
+		return true;
+	}
+
+	bool parseShapes(const char* list, std::vector<ObjShape> &shapes)
+	{
+		shapes.clear();
+		for (const std::string &item : splitList(list)) {
+			ObjShape shape;
+			if (!dd_objShapeFromName(item.c_str(), shape)) { return false; }
+			shapes.push_back(shape);
+		}
+		return true;
+	}
+
+	bool fileExists(const char* path)
+	{
+		struct stat info;
+		return stat(path, &info) == 0;
+	}
+
+	bool makeDirectory(const char* dir)
+	{
+		struct stat info;
+		if (stat(dir, &info) == 0) { return (info.st_mode & S_IFDIR) != 0; }
+	#ifdef _WIN32
+		return _mkdir(dir) == 0;
+	#else
+		return mkdir(dir, 0755) == 0;
+	#endif
+	}
+
+	double median(std::vector<double> values)
+	{
+		if (values.empty()) { return 0.0; }
+		std::sort(values.begin(), values.end());
+		const size_t mid = values.size() / 2;
+		return (values.size() % 2) ? values[mid] :
+									 (values[mid - 1] + values[mid]) * 0.5;
+	}
+
+	double perSecond(const double amount, const double ms)
+	{
+		return (ms > 0.0) ? amount / (ms / 1000.0) : 0.0;
+	}
+
+	/// \brief Per stage timings of every run of one file
+	struct CaseTimes
+	{
+		std::vector<double> read, scan, parse, dedup, tangent, import, exp;
+
+		void add(const ObjConvertStats &stats)
+		{
+			read.push_back(stats.profile.read.ms);
+			scan.push_back(stats.profile.scan.ms);
+			parse.push_back(stats.profile.parse.ms);
+			dedup.push_back(stats.profile.dedup.ms);
+			tangent.push_back(stats.tangent_ms);
+			import.push_back(stats.import_ms);
+			exp.push_back(stats.export_ms);
+		}
+	};
+
+	const char* const k_csv_header =
+		"shape,target_triangles,file_bytes,triangles,vertices,ebos,threads,"
+		"runs,read_ms,scan_ms,parse_ms,dedup_ms,tangent_ms,import_ms,"
+		"export_ms,import_mb_s,triangles_s,output_bytes,peak_rss_kb,"
+		"rss_scope\n";
+
+	/// \brief Convert path opts.repeats times and write its CSV row. Returns
+	/// false if the conversion failed
+	bool runCase(const BenchOptions &opts, const ObjShape shape,
+				 const unsigned size, const std::string &path, FILE* csv)
+	{
+		// the peak is only per case where the OS can reset it
+		const bool rss_reset = dd_resetPeakRSS();
+
+		DD_ObjConverter converter;
+		CaseTimes times;
+		ObjConvertStats stats;
+		for (unsigned run = 0; run < opts.repeats; run++) {
+			if (converter.importOBJ(path.c_str(), opts.threads) !=
+				ObjImportStatus::GOOD) {
+				fprintf(stderr, "%s: import failed\n", path.c_str());
+				return false;
+			}
+			converter.setName("bench_out");
+			if (!converter.exportMesh(opts.format, opts.data_dir.c_str())) {
+				fprintf(stderr, "%s: export failed\n", path.c_str());
+				return false;
+			}
+			stats = converter.stats();
+			times.add(stats);
+		}
+
+		const double import_ms = median(times.import);
+		fprintf(csv, "%s,%u,%llu,%u,%u,%u,%u,%u,%.3f,%.3f,%.3f,%.3f,%.3f,"
+				"%.3f,%.3f,%.2f,%.0f,%llu,%llu,%s\n",
+				dd_objShapeName(shape), size,
+				(unsigned long long)stats.bytes_read, stats.num_triangles,
+				stats.num_vertices, stats.num_ebos, stats.parse_threads,
+				opts.repeats, median(times.read), median(times.scan),
+				median(times.parse), median(times.dedup),
+				median(times.tangent), import_ms, median(times.exp),
+				perSecond(stats.bytes_read / (1024.0 * 1024.0), import_ms),
+				perSecond(stats.num_triangles, import_ms),
+				(unsigned long long)stats.bytes_written,
+				(unsigned long long)(dd_peakRSS() / 1024),
+				rss_reset ? "case" : "process");
+		fflush(csv);
+		return true;
+	}
+}
+
+int main(int argc, char const *argv[])
+{
+	BenchOptions opts;
+	parseSizes("small,medium", opts.sizes);
+	for (unsigned i = 0; i < k_num_obj_shapes; i++) {
+		opts.shapes.push_back((ObjShape)i);
+	}
+
+	for (int i = 1; i < argc; i++) {
+		bool ok = true;
+		if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+			opts.data_dir = argv[++i];
+		}
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			opts.out_file = argv[++i];
+		}
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+			ok = parseSizes(argv[++i], opts.sizes);
+		}
+		else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) {
+			ok = parseShapes(argv[++i], opts.shapes);
+		}
+		else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			opts.threads = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+			opts.repeats = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+			ok = opts.repeats > 0;
+		}
+		else if (strcmp(argv[i], "-t") == 0) {
+			opts.format = DDMFormat::TEXT;
+		}
+		else if (strcmp(argv[i], "-f") == 0) {
+			opts.regenerate = true;
+		}
+		else {
+			ok = false;
+		}
+		if (!ok) {
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!makeDirectory(opts.data_dir.c_str())) {
+		fprintf(stderr, "Cannot create %s\n", opts.data_dir.c_str());
+		return 1;
+	}
+	FILE* csv = opts.out_file ? fopen(opts.out_file, "w") : stdout;
+	if (!csv) {
+		fprintf(stderr, "Cannot open %s\n", opts.out_file);
+		return 1;
+	}
+	fputs(k_csv_header, csv);
+
+	unsigned failed = 0;
+	for (const ObjShape shape : opts.shapes) {
+		for (const unsigned size : opts.sizes) {
+			const std::string path = opts.data_dir + "/" +
+				dd_objShapeName(shape) + "_" + std::to_string(size) + ".obj";
+			if (opts.regenerate || !fileExists(path.c_str())) {
+				const auto start = std::chrono::high_resolution_clock::now();
+				if (!dd_generateObj(path.c_str(), shape, size)) {
+					fprintf(stderr, "Cannot write %s\n", path.c_str());
+					failed++;
+					continue;
+				}
+				fprintf(stderr, "generated %s (%.0f ms)\n", path.c_str(),
+						std::chrono::duration<double, std::milli>(
+							std::chrono::high_resolution_clock::now() -
+							start).count());
+			}
+			fprintf(stderr, "running %s\n", path.c_str());
+			failed += runCase(opts, shape, size, path, csv) ? 0 : 1;
+		}
+	}
+
+	if (csv != stdout) {
+		fclose(csv);
+		fprintf(stderr, "wrote %s\n", opts.out_file);
+	}
+	return failed ? 1 : 0;
+}
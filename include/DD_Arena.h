@@ -0,0 +1,113 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/*-----------------------------------------------------------------------------
+*
+*	dd_arena:
+*		- bump allocator for the temporaries of one conversion
+*			- allocations come from large blocks & are never freed one by one
+*			- reset: drops every allocation at once. Keeps the memory as one
+*			  block so the next conversion of a similar file doesn't allocate
+*			- release: frees every block
+*			- allocArray: value initialized arrays of trivially destructible
+*			  types (no destructors are run)
+*			- not thread safe: allocate on one thread, fill from many
+*
+-----------------------------------------------------------------------------*/
+
+class dd_arena
+{
+public:
+	dd_arena(const size_t block_size = 1 << 20) : m_block_size(block_size) {}
+
+	// raw memory aligned to align (a power of 2)
+	void* alloc(const size_t bytes,
+				const size_t align = alignof(std::max_align_t))
+	{
+		if (!m_blocks.empty()) {
+			Block &block = m_blocks.back();
+			const uintptr_t base = (uintptr_t)block.data.get();
+			const uintptr_t ptr = (base + m_used + align - 1) &
+								 ~(uintptr_t)(align - 1);
+			if (ptr + bytes <= base + block.size) {
+				m_used = (size_t)(ptr + bytes - base);
+				m_allocated += bytes;
+				return (void*)ptr;
+			}
+		}
+		addBlock(std::max(m_block_size, bytes + align));
+		return alloc(bytes, align);
+	}
+
+	template <class T>
+	T* allocArray(const size_t count)
+	{
+		static_assert(std::is_trivially_destructible<T>::value,
+					  "arena memory is dropped w/o running destructors");
+		T* data = (T*)alloc(count * sizeof(T), alignof(T));
+		for (size_t i = 0; i < count; i++) { new (data + i) T(); }
+		return data;
+	}
+
+	// drop all allocations, keep the memory
+	void reset()
+	{
+		if (m_blocks.size() > 1) {
+			const size_t total = capacity();
+			m_blocks.clear();
+			addBlock(total);
+		}
+		m_used = 0;
+		m_allocated = 0;
+	}
+
+	// drop all allocations & free the memory
+	void release()
+	{
+		m_blocks.clear();
+		m_used = 0;
+		m_allocated = 0;
+	}
+
+	// bytes handed out since the last reset
+	inline size_t bytesAllocated() const { return m_allocated; }
+	// bytes in blocks
+	inline size_t capacity() const
+	{
+		size_t total = 0;
+		for (const Block &block : m_blocks) { total += block.size; }
+		return total;
+	}
+
+private:
+	struct Block
+	{
+		std::unique_ptr<uint8_t[]>	data;
+		size_t						size;
+	};
+
+	void addBlock(const size_t size)
+	{
+		Block block;
+		block.data.reset(new uint8_t[size]);
+		block.size = size;
+		m_blocks.push_back(std::move(block));
+		m_used = 0;
+	}
+
+	std::vector<Block> m_blocks;	// allocating from the last one
+	size_t m_block_size;
+	size_t m_used = 0;				// bytes used in the last block
+	size_t m_allocated = 0;
+};
@@ -0,0 +1,50 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "DD_MeshFormat.h"
+#include "DD_MeshUtility.h"
+
+/*-----------------------------------------------------------------------------
+*
+*	Triangle BVH per draw range [offsets[i], offsets[i + 1]), for picking &
+*	physics queries:
+*		- binned SAH build (k_bvh_bins bins per axis over the triangle
+*		  centroids); a node becomes a leaf when splitting costs more than
+*		  testing its triangles and it holds <= max_leaf triangles
+*		- the top of each tree is split on the calling thread until nodes
+*		  are small enough, the subtrees are then built as tasks on a
+*		  work-stealing pool (small ranges are a single task)
+*		- flattened depth first: an inner node's first child is the next
+*		  node, so one of the two child fetches is always sequential
+*		- triangle order in the index data isn't changed, leaves point into
+*		  a separate list of triangle numbers
+*
+-----------------------------------------------------------------------------*/
+
+/// \brief SAH bins per axis
+const unsigned k_bvh_bins = 16;
+/// \brief Largest max_leaf accepted
+const unsigned k_bvh_max_leaf = 64;
+
+/// \brief BVHs of every range, in range order
+struct BvhBuild
+{
+	std::vector<DDMBvh>		bvhs;
+	std::vector<DDMBvhNode>	nodes;
+	std::vector<uint32_t>	triangles;	// triangle # within the range
+
+	void clear();
+};
+
+/// \brief Build one BVH per range over the vertex positions. Runs on
+/// num_threads threads (0 = all)
+void dd_buildBvh(const Vertex* vertices, const vec3_u* triangles,
+				 const unsigned* offsets, const size_t num_ranges,
+				 const unsigned max_leaf, BvhBuild &out,
+				 const unsigned num_threads);
@@ -1,6 +1,11 @@
 #pragma once
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include "Pow2Assert.h"
 
 /*
@@ -13,13 +18,17 @@
 *	dd_array:
 *		- array container
 *			- can be accessed w/ []
-*			- can be resized
+*			- can be resized (contents are kept)
+*			- grows by capacity: reserve, push_back, clear keeps memory
+*			- storage aligned to k_dd_array_align (cache line / SIMD)
+*			- resizeUninitialized: no zero fill for trivial types
 *			- has validation check
 *			- reports n size & n byte size
 *	dd_2Darray:
-*		- 2D array container
+*		- 2D array container (row major, on top of dd_array)
 *			- can be accessed w/ [][]
 *			- can be resized
+*			- grows by rows w/ appendRow
 *			- has validation check
 *			- reports n size & n byte size
 *	TODO:
@@ -27,50 +36,137 @@
 *	Uses POW_ASSERT
 -----------------------------------------------------------------------------*/
 
+/// \brief Alignment of dd_array storage: a cache line, enough for any SIMD
+/// load
+const size_t k_dd_array_align = 64;
+
+/// \brief bytes aligned to align (a power of 2), free w/ dd_alignedFree
+inline void* dd_alignedAlloc(const size_t bytes, const size_t align)
+{
+	// room to align & to keep the pointer operator delete needs
+	uint8_t* raw = (uint8_t*)::operator new(bytes + align + sizeof(void*));
+	const uintptr_t ptr = ((uintptr_t)(raw + sizeof(void*)) + align - 1) &
+						  ~(uintptr_t)(align - 1);
+	((void**)ptr)[-1] = raw;
+	return (void*)ptr;
+}
+
+inline void dd_alignedFree(void* ptr)
+{
+	if (ptr) { ::operator delete(((void**)ptr)[-1]); }
+}
+
 // Array container used for Day Dream engine
 template <class T>
 class dd_array
 {
 public:
 	// ctor
-	dd_array(const size_t _size = 0) : m_size(_size)
+	dd_array(const size_t _size = 0) : m_size(0), m_capacity(0),
+		m_data(nullptr)
 	{
-		if( _size != 0 ) {
-			m_data = new T[_size]();
-		}
-		else {
-			m_data = nullptr;
-		}
+		resize(_size);
 	}
 	// dtor
 	~dd_array()
 	{
-		if( m_size > 0 ) {
-			delete[] m_data;
-		}
+		release();
 	}
 	// copy ctor
-	dd_array(const dd_array& other)
+	dd_array(const dd_array& other) : m_size(0), m_capacity(0),
+		m_data(nullptr)
 	{
-		m_size = other.m_size;
-		m_data = new T[m_size]();
-		std::copy(other.m_data, other.m_data + m_size, m_data);
+		*this = other;
 	}
 
-	// set size
+	// set size, keeps contents. New elements are value initialized (0)
 	bool resize(const size_t _size)
 	{
-		if( m_size > 0 ) {
-			delete[] m_data;
-			m_size = 0;
+		reserve(_size);
+		for( size_t i = m_size; i < _size; i++ ) {
+			new (m_data + i) T();
 		}
-		if( _size != 0 ) {
-			m_size = _size;
-			m_data = new T[_size]();
+		shrinkTo(_size);
+		return isValid();
+	}
+
+	// set size, keeps contents. New elements are default initialized: left
+	// as is for trivial types (for buffers that are filled right after)
+	bool resizeUninitialized(const size_t _size)
+	{
+		reserve(_size);
+		if( !std::is_trivial<T>::value ) {
+			for( size_t i = m_size; i < _size; i++ ) {
+				new (m_data + i) T;
+			}
 		}
+		shrinkTo(_size);
 		return isValid();
 	}
 
+	// make room for _capacity elements w/o changing the size
+	void reserve(const size_t _capacity)
+	{
+		if( _capacity <= m_capacity ) {
+			return;
+		}
+		T* data = (T*)dd_alignedAlloc(_capacity * sizeof(T),
+									  std::max(k_dd_array_align, alignof(T)));
+		relocate(m_data, m_size, data);
+		dd_alignedFree(m_data);
+		m_data = data;
+		m_capacity = _capacity;
+	}
+
+	// append, growing capacity geometrically
+	void push_back(const T& value)
+	{
+		if( m_size == m_capacity ) {
+			T copy(value);	// value may live in the buffer being replaced
+			grow();
+			new (m_data + m_size) T(std::move(copy));
+		}
+		else {
+			new (m_data + m_size) T(value);
+		}
+		m_size++;
+	}
+
+	void push_back(T&& value)
+	{
+		if( m_size == m_capacity ) {
+			T moved(std::move(value));
+			grow();
+			new (m_data + m_size) T(std::move(moved));
+		}
+		else {
+			new (m_data + m_size) T(std::move(value));
+		}
+		m_size++;
+	}
+
+	// drop elements, keeps capacity
+	void clear()
+	{
+		shrinkTo(0);
+	}
+
+	// drop elements & free memory
+	void release()
+	{
+		shrinkTo(0);
+		dd_alignedFree(m_data);
+		m_data = nullptr;
+		m_capacity = 0;
+	}
+
+	void swap(dd_array& other)
+	{
+		std::swap(m_size, other.m_size);
+		std::swap(m_capacity, other.m_capacity);
+		std::swap(m_data, other.m_data);
+	}
+
 	// returns T from 1D array
 	T & operator[](const size_t FirstIndex)
 	{
@@ -81,7 +177,7 @@ public:
 	}
 
 	// returns const T from 1D array
-	T & operator[](const size_t FirstIndex) const
+	const T & operator[](const size_t FirstIndex) const
 	{
 		POW2_VERIFY_MSG(
 			FirstIndex < m_size,
@@ -89,60 +185,89 @@ public:
 		return m_data[FirstIndex];
 	}
 
-	// assign
-	void operator=(const dd_array &other)
+	// assign (copies all of other)
+	dd_array& operator=(const dd_array &other)
 	{
-		if( other.m_size == 0 ) {
-			return;		// nothing in the second array
-		}
-		if( m_size == 0 ) {	// nothing in this array
+		if( this != &other ) {
+			clear();
+			reserve(other.m_size);
+			for( size_t i = 0; i < other.m_size; i++ ) {
+				new (m_data + i) T(other.m_data[i]);
+			}
 			m_size = other.m_size;
-			m_data = new T[m_size]();
-		}
-
-		if( m_size >= other.m_size ) { // other array is smaller
-			std::copy(other.m_data, other.m_data + other.m_size, m_data);
-		}
-		else {	// other array is bigger or equal to this array
-			std::copy(other.m_data, other.m_data + m_size, m_data);
 		}
+		return *this;
 	}
 
 	// move ctor
-	dd_array(dd_array&& other) : m_size(0), m_data(nullptr)
+	dd_array(dd_array&& other) : m_size(0), m_capacity(0), m_data(nullptr)
 	{
-		m_data = other.m_data;
-		m_size = other.m_size;
-
-		other.m_data = nullptr;
-		other.m_size = 0;
+		swap(other);
 	}
 
 	// move assignment
 	dd_array& operator=(dd_array&& other)
 	{
 		if( this != &other ) {
-			if( m_data != nullptr ) {
-				delete[] m_data;
-			}
-			m_data = other.m_data;
-			m_size = other.m_size;
-
-			other.m_size = 0;
-			other.m_data = nullptr;
+			release();
+			swap(other);
 		}
 		return *this;
 	}
 
+	// raw access (for loops that shouldn't pay for bounds checks)
+	inline T* data() { return m_data; }
+	inline const T* data() const { return m_data; }
+	inline T* begin() { return m_data; }
+	inline const T* begin() const { return m_data; }
+	inline T* end() { return m_data + m_size; }
+	inline const T* end() const { return m_data + m_size; }
+
 	// number of elements
 	inline size_t size() const { return m_size; }
+	inline bool empty() const { return m_size == 0; }
+	// number of elements that fit w/o reallocating
+	inline size_t capacity() const { return m_capacity; }
 	// size of data in bytes
 	inline size_t sizeInBytes() const { return m_size * sizeof(T); }
 	// checks is data was allocated in memory
 	inline bool isValid() const { return (m_data == nullptr) ? false : true; }
 
 private:
+	void grow()
+	{
+		reserve(std::max<size_t>(16, m_capacity * 2));
+	}
+
+	// destroy elements past _size (no-op when growing)
+	void shrinkTo(const size_t _size)
+	{
+		if( !std::is_trivially_destructible<T>::value ) {
+			for( size_t i = _size; i < m_size; i++ ) {
+				m_data[i].~T();
+			}
+		}
+		m_size = _size;
+	}
+
+	// move count elements from src to uninitialized dst
+	static void relocate(T* src, const size_t count, T* dst)
+	{
+		if( count == 0 ) {
+			return;
+		}
+		if( std::is_trivially_copyable<T>::value ) {
+			memcpy((void*)dst, (const void*)src, count * sizeof(T));
+			return;
+		}
+		for( size_t i = 0; i < count; i++ ) {
+			new (dst + i) T(std::move(src[i]));
+			src[i].~T();
+		}
+	}
+
 	size_t m_size;
+	size_t m_capacity;
 	T *m_data;
 };
 
@@ -169,40 +294,45 @@ public:
 
 	// ctor
 	dd_2Darray(const size_t Row = 0, const size_t Column = 0) :
-		m_row(Row),
-		m_column(Column)
+		m_row(0),
+		m_column(0)
 	{
-		if( Row != 0 && Column != 0 ) {
-			m_data = new T[(Row * Column)]();
-		}
-		else {
-			m_data = nullptr;
-		}
+		resize(Row, Column);
 	}
-	// dtor
-	~dd_2Darray()
+
+	// set size. Rows are kept if the column count doesn't change, new
+	// elements are value initialized (0)
+	bool resize(const size_t Row, const size_t Column)
 	{
-		if( isValid() ) {
-			delete[] m_data;
-		}
+		reshape(Row, Column);
+		m_data.resize(m_row * m_column);
+		return isValid();
 	}
 
-	// set size
-	bool resize(const size_t Row, const size_t Column)
+	// resize w/o initializing new elements of trivial types
+	bool resizeUninitialized(const size_t Row, const size_t Column)
 	{
-		if( isValid() ) {
-			m_row = 0;
-			m_column = 0;
-			delete[] m_data;
-		}
-		if( Row != 0 && Column != 0 ) {
-			m_row = Row;
-			m_column = Column;
-			m_data = new T[(Row * Column)]();
-		}
+		reshape(Row, Column);
+		m_data.resizeUninitialized(m_row * m_column);
 		return isValid();
 	}
 
+	// make room for Row rows of the current column count
+	void reserveRows(const size_t Row)
+	{
+		m_data.reserve(Row * m_column);
+	}
+
+	// append a row of numColumns() values, growing capacity geometrically
+	void appendRow(const T* values)
+	{
+		POW2_VERIFY_MSG(m_column > 0, "No columns to append to :: 2D", 0);
+		for( size_t i = 0; i < m_column; i++ ) {
+			m_data.push_back(values[i]);
+		}
+		m_row++;
+	}
+
 	// Return a proxy object that "knows" to which container it has to ask the
 	// element and which is the first index (specified in this call). Returns T
 	// from 2D array
@@ -215,57 +345,29 @@ public:
 	T & GetElement(size_t FirstIndex, size_t SecondIndex)
 	{
 		POW2_VERIFY_MSG(
-			(FirstIndex * m_column + SecondIndex) < (m_column * m_row),
+			SecondIndex < m_column && FirstIndex < m_row,
 			"Index out of bounds :: 2D", 0);
-		return m_data[(FirstIndex * m_column) + SecondIndex];
+		return m_data.data()[(FirstIndex * m_column) + SecondIndex];
 	}
 	// return const 2D data
-	T & GetElement(size_t FirstIndex, size_t SecondIndex) const
+	const T & GetElement(size_t FirstIndex, size_t SecondIndex) const
 	{
 		POW2_VERIFY_MSG(
-			(FirstIndex * m_column + SecondIndex) < (m_column * m_row),
+			SecondIndex < m_column && FirstIndex < m_row,
 			"Index out of bounds :: 2D", 0);
-		return m_data[(FirstIndex * m_column) + SecondIndex];
+		return m_data.data()[(FirstIndex * m_column) + SecondIndex];
 	}
 
-	// copying
-	void operator=(const dd_2Darray &other)
-	{
-		POW2_VERIFY_MSG(
-			other.isValid(),
-			"Invalid second array being assigned from :: 2D", 0);
-		if( other.m_column == m_column && other.m_row == m_row ) {
-			std::copy(
-				other.m_data,
-				other.m_data + (other.m_row * other.m_column),
-				m_data);
-		}
-		else {
-			const size_t min_row = std::min(other.m_row, m_row);
-			const size_t min_col = std::min(other.m_column, m_column);
-			for( size_t i = 0; i < min_row; i++ ) {
-				const size_t m_i = i * m_column;
-				const size_t o_i = i * other.m_column;
-				std::copy(
-					other.m_data + o_i,
-					other.m_data + o_i + min_col,
-					m_data + m_i);
-			}
-		}
-
-	}
+	// copying (copies all of other)
+	dd_2Darray(const dd_2Darray &other) = default;
+	dd_2Darray& operator=(const dd_2Darray &other) = default;
 
 	// move ctor
 	dd_2Darray(dd_2Darray&& other) :
-		m_data(nullptr),
-		m_row(0),
-		m_column(0)
+		m_row(other.m_row),
+		m_column(other.m_column),
+		m_data(std::move(other.m_data))
 	{
-		m_data = other.m_data;
-		m_row = other.m_row;
-		m_column = other.m_column;
-
-		other.m_data = nullptr;
 		other.m_row = 0;
 		other.m_column = 0;
 	}
@@ -274,20 +376,20 @@ public:
 	dd_2Darray& operator=(dd_2Darray&& other)
 	{
 		if( this != &other ) {
-			if( m_data != nullptr ) {
-				delete[] m_data;
-			}
-			m_data = other.m_data;
+			m_data = std::move(other.m_data);
 			m_row = other.m_row;
 			m_column = other.m_column;
 
-			other.m_data = nullptr;
 			other.m_row = 0;
 			other.m_column = 0;
 		}
 		return *this;
 	}
 
+	// row major elements
+	inline T* data() { return m_data.data(); }
+	inline const T* data() const { return m_data.data(); }
+
 	// number of elements
 	inline size_t size() const { return m_row * m_column; }
 	// size of data in bytes
@@ -295,9 +397,19 @@ public:
 	inline size_t numRows() const { return m_row; }
 	inline size_t numColumns() const { return m_column; }
 	// checks is data was allocated in memory
-	inline bool isValid() const { return (m_data == nullptr) ? false : true; }
+	inline bool isValid() const { return m_data.isValid(); }
 
 private:
+	// set dimensions, dropping the rows if the layout changes
+	void reshape(const size_t Row, const size_t Column)
+	{
+		if( Column != m_column ) {
+			m_data.clear();
+		}
+		m_row = Row;
+		m_column = Column;
+	}
+
 	size_t m_row, m_column;
-	T *m_data;
+	dd_array<T> m_data;
 };
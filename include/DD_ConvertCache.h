@@ -0,0 +1,78 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+/*-----------------------------------------------------------------------------
+*
+*	DD_ConvertCache:
+*		- on-disk cache of converted .ddm files
+*			- keyed by a 64 bit hash of the input bytes seeded w/ a hash of
+*			  the converter options (format, mesh name, version, ...)
+*			- entries are <dir>/<key as hex>.ddm
+*			- a hit copies the cached file to the output path
+*			- least recently used entries are removed once the cache grows
+*			  past max_bytes
+*			- safe to share between threads of one process
+*
+-----------------------------------------------------------------------------*/
+
+struct ConvertCacheStats
+{
+	uint64_t	hits = 0;
+	uint64_t	misses = 0;
+	uint64_t	bytes_saved = 0;	// input bytes that didn't need converting
+	uint64_t	bytes_reused = 0;	// output bytes copied from the cache
+	uint64_t	evictions = 0;
+	uint64_t	bytes_evicted = 0;
+};
+
+class DD_ConvertCache
+{
+public:
+	// Use (and create) cache directory dir, bounded to max_bytes
+	bool open(const char* dir, const uint64_t max_bytes);
+	inline bool isOpen() const { return !m_dir.empty(); }
+
+	// hash of data (xxHash64 style, 4 lanes)
+	static uint64_t hash(const void* data, const size_t bytes,
+						 const uint64_t seed = 0);
+	// key for an input file & converter options. Returns false if the input
+	// can't be read
+	static bool makeKey(const char* input, const char* options, uint64_t &key,
+						uint64_t &input_bytes);
+
+	// copy cached output for key to out_path. Returns false on a miss
+	bool fetch(const uint64_t key, const uint64_t input_bytes,
+			   const char* out_path);
+	// add converted file ddm_path under key, then evict down to max_bytes
+	bool store(const uint64_t key, const char* ddm_path);
+
+	ConvertCacheStats stats() const;
+	inline uint64_t sizeInBytes() const { return m_total; }
+
+private:
+	struct Entry
+	{
+		uint64_t size;
+		uint64_t last_use;		// larger == more recent
+	};
+
+	std::string entryPath(const uint64_t key) const;
+	void evict();
+
+	std::string m_dir;
+	uint64_t m_max_bytes = 0;
+	uint64_t m_total = 0;
+	uint64_t m_clock = 0;
+	std::map<uint64_t, Entry> m_entries;
+	ConvertCacheStats m_stats;
+	mutable std::mutex m_mutex;
+};
@@ -0,0 +1,73 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/*-----------------------------------------------------------------------------
+*
+*	Varint index stream (DDM_BLOCK_INDICES_VARINT):
+*		- each index is stored as the difference to the previous index of
+*		  the same ebo (the first one to 0), zigzag mapped so small
+*		  negative steps stay small, then written 7 bits per byte, low
+*		  bits first, high bit set on every byte but the last
+*		- indices are relative to the ebo's base vertex, so vertex cache &
+*		  fetch ordered meshes mostly take 1 byte per index
+*
+-----------------------------------------------------------------------------*/
+
+namespace dd_indexcodec
+{
+	inline uint32_t zigzag(const int32_t val)
+	{
+		return ((uint32_t)val << 1) ^ (uint32_t)(val >> 31);
+	}
+
+	inline int32_t unzigzag(const uint32_t val)
+	{
+		return (int32_t)(val >> 1) ^ -(int32_t)(val & 1);
+	}
+}
+
+/// \brief Append count indices (minus base) to out as a varint stream
+inline void dd_encodeIndices(const uint32_t* indices, const size_t count,
+							 const uint32_t base, std::vector<uint8_t> &out)
+{
+	uint32_t prev = 0;
+	for (size_t i = 0; i < count; i++) {
+		const uint32_t idx = indices[i] - base;
+		uint32_t val = dd_indexcodec::zigzag((int32_t)(idx - prev));
+		prev = idx;
+		while (val >= 0x80) {
+			out.push_back((uint8_t)(val | 0x80));
+			val >>= 7;
+		}
+		out.push_back((uint8_t)val);
+	}
+}
+
+/// \brief Decode count indices (plus base) from a varint stream. Returns
+/// bytes consumed, 0 if the stream ends early or is malformed
+inline size_t dd_decodeIndices(const uint8_t* data, const size_t bytes,
+							   const size_t count, const uint32_t base,
+							   uint32_t* out)
+{
+	size_t pos = 0;
+	uint32_t prev = 0;
+	for (size_t i = 0; i < count; i++) {
+		uint32_t val = 0;
+		for (int shift = 0; ; shift += 7) {
+			if (pos == bytes || shift > 28) { return 0; }
+			const uint8_t byte = data[pos++];
+			val |= (uint32_t)(byte & 0x7F) << shift;
+			if (!(byte & 0x80)) { break; }
+		}
+		prev += (uint32_t)dd_indexcodec::unzigzag(val);
+		out[i] = prev + base;
+	}
+	return pos;
+}
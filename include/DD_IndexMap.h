@@ -0,0 +1,135 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/*-----------------------------------------------------------------------------
+*
+*	dd_indexmap:
+*		- maps an index triple (e.g. obj v/vt/vn) to an unsigned value
+*			- open addressing w/ linear probing in one flat array
+*			- keys are compared exactly (no hash-only matches)
+*			- reserve() sizes the table once from an estimate; grows by 2x
+*			  past 70% load
+*			- clear() keeps capacity for reuse
+*			- counts probes so lookup cost can be reported
+*
+-----------------------------------------------------------------------------*/
+
+class dd_indexmap
+{
+public:
+	// value stored in empty slots (can't be used as a value)
+	static const unsigned k_empty = 0xFFFFFFFFu;
+
+	dd_indexmap() {}
+
+	// make room for n keys without growing
+	void reserve(const size_t n)
+	{
+		size_t cap = 16;
+		while (cap * 7 < n * 10) { cap <<= 1; }
+		if (cap > m_slots.size()) { rehash(cap); }
+	}
+
+	// remove all keys, keeps memory
+	void clear()
+	{
+		for (Slot &slot : m_slots) { slot.value = k_empty; }
+		m_count = 0;
+		m_lookups = 0;
+		m_probes = 0;
+	}
+
+	// Returns the value stored for key (a, b, c). If the key is missing,
+	// value is inserted and returned, and inserted is set to true
+	unsigned findOrInsert(const unsigned a, const unsigned b, const unsigned c,
+						  const unsigned value, bool &inserted)
+	{
+		if ((m_count + 1) * 10 > m_slots.size() * 7) {
+			rehash(m_slots.empty() ? 16 : m_slots.size() * 2);
+		}
+		m_lookups++;
+		size_t idx = hash(a, b, c) & m_mask;
+		while (true) {
+			m_probes++;
+			Slot &slot = m_slots[idx];
+			if (slot.value == k_empty) {
+				slot.key[0] = a;
+				slot.key[1] = b;
+				slot.key[2] = c;
+				slot.value = value;
+				m_count++;
+				inserted = true;
+				return value;
+			}
+			if (slot.key[0] == a && slot.key[1] == b && slot.key[2] == c) {
+				inserted = false;
+				return slot.value;
+			}
+			idx = (idx + 1) & m_mask;
+		}
+	}
+
+	// number of keys
+	inline size_t size() const { return m_count; }
+	// number of slots
+	inline size_t capacity() const { return m_slots.size(); }
+	// size of table in bytes
+	inline size_t sizeInBytes() const { return m_slots.size() * sizeof(Slot); }
+	// findOrInsert calls & slots they visited since the last clear
+	inline uint64_t lookups() const { return m_lookups; }
+	inline uint64_t probes() const { return m_probes; }
+	// average slots visited per findOrInsert
+	inline double avgProbes() const
+	{
+		return m_lookups ? (double)m_probes / (double)m_lookups : 0.0;
+	}
+
+private:
+	struct Slot
+	{
+		unsigned key[3];
+		unsigned value;
+	};
+
+	static inline size_t hash(const unsigned a, const unsigned b,
+							  const unsigned c)
+	{
+		// splitmix64 finalizer over the packed triple
+		uint64_t h = ((uint64_t)a << 32 | b) ^
+					 ((uint64_t)c * 0x9E3779B97F4A7C15ull);
+		h ^= h >> 30;
+		h *= 0xBF58476D1CE4E5B9ull;
+		h ^= h >> 27;
+		h *= 0x94D049BB133111EBull;
+		h ^= h >> 31;
+		return (size_t)h;
+	}
+
+	void rehash(const size_t new_cap)
+	{
+		std::vector<Slot> old;
+		old.swap(m_slots);
+		Slot empty_slot;
+		empty_slot.value = k_empty;
+		m_slots.assign(new_cap, empty_slot);
+		m_mask = new_cap - 1;
+		for (const Slot &slot : old) {
+			if (slot.value == k_empty) { continue; }
+			size_t idx = hash(slot.key[0], slot.key[1], slot.key[2]) & m_mask;
+			while (m_slots[idx].value != k_empty) { idx = (idx + 1) & m_mask; }
+			m_slots[idx] = slot;
+		}
+	}
+
+	std::vector<Slot> m_slots;
+	size_t m_mask = 0;
+	size_t m_count = 0;
+	uint64_t m_lookups = 0;
+	uint64_t m_probes = 0;
+};
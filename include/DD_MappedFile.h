@@ -0,0 +1,57 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstddef>
+
+/*-----------------------------------------------------------------------------
+*
+*	DD_MappedFile:
+*		- read-only view of an entire file
+*			- memory mapped (mmap / MapViewOfFile) when possible
+*			- falls back to reading the file into a heap buffer
+*			- the byte at end() is always readable and is '\0', so parsers
+*			  can scan the last line without copying it
+*			- prefetch: fault a range in on the calling thread (a reader
+*			  stage running ahead of the parser)
+*
+-----------------------------------------------------------------------------*/
+
+class DD_MappedFile
+{
+public:
+	DD_MappedFile() {}
+	~DD_MappedFile() { close(); }
+
+	DD_MappedFile(const DD_MappedFile&) = delete;
+	DD_MappedFile& operator=(const DD_MappedFile&) = delete;
+
+	// map file contents. Returns false if the file cannot be opened
+	bool open(const char* filename);
+	// unmap/free file contents
+	void close();
+	// read [offset, offset + len) of a mapping into memory (touches every
+	// page). No-op for heap copies
+	void prefetch(const size_t offset, const size_t len) const;
+
+	inline const char* begin() const { return m_data; }
+	inline const char* end() const { return m_data + m_size; }
+	// size of file in bytes
+	inline size_t size() const { return m_size; }
+	// true if the view is an OS mapping (not a heap copy)
+	inline bool isMapped() const { return m_mapped; }
+
+private:
+	bool readToHeap(const char* filename);
+
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+	bool m_mapped = false;
+	char* m_heap = nullptr;
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#endif
+};
@@ -0,0 +1,232 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstdint>
+
+/*-----------------------------------------------------------------------------
+*
+*	Binary .ddm layout (all values in the writer's native byte order):
+*
+*		DDMHeader			- magic, endian tag, version, name, counts
+*		DDMBlock[]			- table of every data block in the file
+*		blocks				- each starts on a k_ddm_align byte boundary
+*			DDM_BLOCK_ATTRIBS	- DDMVertexAttrib[] describing a vertex
+*			DDM_BLOCK_MATERIALS	- DDMMaterial[]
+*			DDM_BLOCK_EBOS		- DDMEbo[] (one per submesh)
+*			DDM_BLOCK_VERTICES	- interleaved vertices (header.vertex_stride)
+*			  or DDM_BLOCK_VERTEX_STREAM per attribute - split vertices,
+*			  in attribute block order (DDMVertexAttrib::stride)
+*			DDM_BLOCK_INDICES	- index data, each ebo range aligned
+*			  or DDM_BLOCK_INDICES_VARINT - compressed index data (see
+*			  DD_IndexCodec.h), each ebo range aligned
+*			DDM_BLOCK_VERTEX_RANGES	- DDMVertexRange[] (one per ebo)
+*			DDM_BLOCK_ATTRIB_RANGES	- DDMAttribRange[] (one per attribute)
+*			DDM_BLOCK_LODS		- DDMLod[] (coarser levels, optional)
+*			DDM_BLOCK_LOD_EBOS	- DDMEbo[] (header.num_ebos per level,
+*								  indices in the index block)
+*			DDM_BLOCK_MESHLETS	- DDMMeshlet[] (optional)
+*			DDM_BLOCK_MESHLET_VERTICES	- uint32_t vertex ids of meshlets
+*			DDM_BLOCK_MESHLET_TRIANGLES	- uint8_t[3] per meshlet triangle,
+*										  into its vertex ids
+*			DDM_BLOCK_BVHS		- DDMBvh[] (one per ebo, optional)
+*			DDM_BLOCK_BVH_NODES	- DDMBvhNode[]
+*			DDM_BLOCK_BVH_TRIANGLES	- uint32_t triangle # (within the ebo)
+*									  referenced by the bvh leaves
+*
+*	A loader can map the file, check magic/endian/version_major, and point
+*	graphics buffers straight at the vertex and index blocks. Block types a
+*	loader doesn't know about can be skipped. Minor version bumps only add
+*	block types or use reserved fields; anything an older loader would
+*	misread bumps the major version.
+*
+-----------------------------------------------------------------------------*/
+
+const char k_ddm_magic[4] = { 'D', 'D', 'M', 'B' };
+// reads as 0x04030201 when the file was written on a machine w/ the other
+// byte order
+const uint32_t k_ddm_endian_tag = 0x01020304u;
+const uint16_t k_ddm_version_major = 1;
+const uint16_t k_ddm_version_minor = 0;
+// alignment of every block and ebo index range (cache line/SIMD friendly)
+const uint32_t k_ddm_align = 64;
+
+enum DDMBlockType : uint32_t
+{
+	DDM_BLOCK_ATTRIBS = 1,
+	DDM_BLOCK_MATERIALS = 2,
+	DDM_BLOCK_EBOS = 3,
+	DDM_BLOCK_VERTICES = 4,
+	DDM_BLOCK_INDICES = 5,
+	DDM_BLOCK_VERTEX_RANGES = 6,
+	DDM_BLOCK_INDICES_VARINT = 7,
+	DDM_BLOCK_ATTRIB_RANGES = 8,
+	DDM_BLOCK_LODS = 9,
+	DDM_BLOCK_LOD_EBOS = 10,
+	DDM_BLOCK_MESHLETS = 11,
+	DDM_BLOCK_MESHLET_VERTICES = 12,
+	DDM_BLOCK_MESHLET_TRIANGLES = 13,
+	DDM_BLOCK_BVHS = 14,
+	DDM_BLOCK_BVH_NODES = 15,
+	DDM_BLOCK_BVH_TRIANGLES = 16,
+	DDM_BLOCK_VERTEX_STREAM = 17
+};
+
+enum DDMAttribSemantic : uint32_t
+{
+	DDM_ATTRIB_POSITION = 0,
+	DDM_ATTRIB_NORMAL = 1,
+	DDM_ATTRIB_TEXCOORD = 2,
+	DDM_ATTRIB_TANGENT = 3
+};
+
+enum DDMAttribFormat : uint32_t
+{
+	DDM_FORMAT_FLOAT32x2 = 0,
+	DDM_FORMAT_FLOAT32x3 = 1,
+	DDM_FORMAT_FLOAT32x4 = 2,
+	DDM_FORMAT_FLOAT16x2 = 3,
+	DDM_FORMAT_FLOAT16x4 = 4,		// position: w = 1
+	DDM_FORMAT_UNORM16x2 = 5,		// over DDMAttribRange
+	DDM_FORMAT_UNORM16x4 = 6,		// over DDMAttribRange, w unused
+	DDM_FORMAT_OCT_SNORM16x2 = 7,	// octahedral unit vector
+	DDM_FORMAT_OCT_SNORM16x4 = 8,	// octahedral xy, z = sign, w unused
+	DDM_FORMAT_SNORM10x3_2 = 9		// xyz 10 bit, w 2 bit (sign), x in low
+									// bits (GL_INT_2_10_10_10_REV)
+};
+
+struct DDMHeader
+{
+	char		magic[4];		// k_ddm_magic
+	uint32_t	endian;			// k_ddm_endian_tag
+	uint16_t	version_major;
+	uint16_t	version_minor;
+	uint32_t	header_size;	// sizeof(DDMHeader)
+	uint64_t	file_size;
+	char		name[64];		// null terminated
+	uint32_t	num_vertices;
+	uint32_t	num_ebos;
+	uint32_t	num_materials;
+	uint32_t	vertex_stride;	// bytes per vertex (over all streams)
+	uint32_t	num_blocks;
+	uint32_t	reserved;
+	uint64_t	block_offset;	// offset of DDMBlock table
+};
+
+struct DDMBlock
+{
+	uint32_t	type;			// DDMBlockType
+	uint32_t	count;			// # of elements in block
+	uint64_t	offset;			// from start of file
+	uint64_t	size;			// in bytes
+};
+
+struct DDMVertexAttrib
+{
+	uint32_t	semantic;		// DDMAttribSemantic
+	uint32_t	format;			// DDMAttribFormat
+	uint32_t	offset;			// byte offset inside a vertex
+	uint32_t	stride;			// split: bytes per vertex of its stream
+								// (offset 0), interleaved: 0
+};
+
+struct DDMMaterial
+{
+	char		name[32];		// null terminated
+	float		diffuse[4];
+	float		specular[4];
+};
+
+struct DDMEbo
+{
+	uint64_t	offset;			// of first index, from start of file
+	uint32_t	num_indices;	// 3 per triangle
+	uint32_t	index_size;		// bytes per (decoded) index: 2 or 4
+	uint32_t	material;		// index into material block
+	uint32_t	base_vertex;	// added to every stored index
+};
+
+/// \brief Vertices an ebo's indices reference (glDrawRangeElements bounds).
+/// When the converter optimizes vertex fetch, every ebo owns exactly this
+/// contiguous block of the vertex buffer
+struct DDMVertexRange
+{
+	uint32_t	first_vertex;
+	uint32_t	num_vertices;	// 0 for an empty ebo
+};
+
+/// \brief Bounds of an attribute over all vertices. unorm formats store
+/// (value - min) / (max - min)
+struct DDMAttribRange
+{
+	uint32_t	semantic;		// DDMAttribSemantic
+	uint32_t	reserved[3];
+	float		min[4];
+	float		max[4];
+};
+
+/// \brief A simplified version of the whole mesh. Its ebos replace the full
+/// resolution ebos 1:1 (same material & vertex range) and index the same
+/// vertex buffer
+struct DDMLod
+{
+	uint32_t	first_ebo;		// into DDM_BLOCK_LOD_EBOS
+	uint32_t	num_triangles;	// over all of the level's ebos
+	float		error;			// relative to the bounding box diagonal
+	uint32_t	reserved;
+};
+
+/// \brief A cluster of a full resolution ebo's triangles. Culling: skip it
+/// when the sphere is outside the frustum, or when
+/// dot(normalize(cone_apex - camera), cone_axis) >= cone_cutoff (every
+/// triangle faces away)
+struct DDMMeshlet
+{
+	uint32_t	first_vertex;	// into DDM_BLOCK_MESHLET_VERTICES
+	uint32_t	first_triangle;	// into DDM_BLOCK_MESHLET_TRIANGLES
+	uint32_t	num_vertices;
+	uint32_t	num_triangles;
+	float		center[3];		// bounding sphere
+	float		radius;
+	float		cone_apex[3];
+	float		cone_cutoff;	// 1 = never backfacing
+	float		cone_axis[3];
+	uint32_t	ebo;			// full resolution ebo it came from
+};
+
+/// \brief Bounding volume hierarchy over an ebo's triangles. Node 0 is the
+/// root; all offsets are relative to the bvh's first node/triangle
+struct DDMBvh
+{
+	uint32_t	first_node;		// into DDM_BLOCK_BVH_NODES
+	uint32_t	num_nodes;		// 0 for an empty ebo
+	uint32_t	first_triangle;	// into DDM_BLOCK_BVH_TRIANGLES
+	uint32_t	num_triangles;
+	float		sah_cost;		// expected cost of a ray query (lower is
+								// better, num_triangles = no tree)
+	uint32_t	depth;			// of the deepest leaf (root = 1)
+};
+
+/// \brief Node of a depth first flattened bvh (two per cache line)
+struct DDMBvhNode
+{
+	float		min[3];
+	uint32_t	offset;			// inner: second child (first child is the
+								// next node), leaf: first triangle
+	float		max[3];
+	uint32_t	count;			// leaf: # of triangles, 0 = inner node
+};
+
+static_assert(sizeof(DDMHeader) == 120, "DDMHeader layout changed");
+static_assert(sizeof(DDMBlock) == 24, "DDMBlock layout changed");
+static_assert(sizeof(DDMVertexAttrib) == 16, "DDMVertexAttrib layout changed");
+static_assert(sizeof(DDMMaterial) == 64, "DDMMaterial layout changed");
+static_assert(sizeof(DDMEbo) == 24, "DDMEbo layout changed");
+static_assert(sizeof(DDMVertexRange) == 8, "DDMVertexRange layout changed");
+static_assert(sizeof(DDMAttribRange) == 48, "DDMAttribRange layout changed");
+static_assert(sizeof(DDMLod) == 16, "DDMLod layout changed");
+static_assert(sizeof(DDMMeshlet) == 64, "DDMMeshlet layout changed");
+static_assert(sizeof(DDMBvh) == 24, "DDMBvh layout changed");
+static_assert(sizeof(DDMBvhNode) == 32, "DDMBvhNode layout changed");
@@ -0,0 +1,71 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "DD_MeshUtility.h"
+
+/*-----------------------------------------------------------------------------
+*
+*	Index stream optimization:
+*		- triangles are handled per draw range: [offsets[i], offsets[i + 1])
+*		  (i.e. the converter's mesh_offset ranges), each range is
+*		  reordered on its own and the cache is flushed between ranges
+*		- vertex indices are global (into the shared vertex buffer)
+*
+-----------------------------------------------------------------------------*/
+
+/// \brief FIFO post-transform cache size used for analysis & optimization
+const unsigned k_vertex_cache_size = 16;
+
+/// \brief Result of simulating a FIFO post-transform vertex cache
+struct VertexCacheStats
+{
+	uint64_t triangles = 0;
+	uint64_t vertices = 0;		// distinct vertices referenced per range
+	uint64_t transforms = 0;	// cache misses
+
+	// average cache miss ratio: vertex shader runs per triangle (0.5 - 3)
+	inline double acmr() const
+	{
+		return triangles ? (double)transforms / triangles : 0.0;
+	}
+	// average transform to vertex ratio: shader runs per vertex (1 is ideal)
+	inline double atvr() const
+	{
+		return vertices ? (double)transforms / vertices : 0.0;
+	}
+};
+
+/// \brief Simulate a FIFO cache of cache_size entries over each range
+VertexCacheStats dd_analyzeVertexCache(const vec3_u* triangles,
+									   const unsigned* offsets,
+									   const size_t num_ranges,
+									   const size_t num_vertices,
+									   const unsigned cache_size =
+										   k_vertex_cache_size);
+
+/// \brief Reorder the triangles of each range for post-transform cache
+/// hits (Tipsify, Sander et al. 2007). Runs in O(triangles + vertices)
+/// per range; the winding of every triangle is kept
+void dd_optimizeVertexCache(vec3_u* triangles, const unsigned* offsets,
+							const size_t num_ranges, const size_t num_vertices,
+							const unsigned cache_size = k_vertex_cache_size);
+
+/// \brief Renumber vertices in order of first use, range by range, so each
+/// range references one contiguous, sequentially fetched block of vertices.
+/// Vertices used by more than one range are duplicated. Triangles outside
+/// all ranges (before offsets[0] / after offsets[num_ranges]) are remapped
+/// after them.
+///
+/// Indices are rewritten in place. source[i] is set to the old index of new
+/// vertex i; vertices no triangle uses are dropped. Returns the # of
+/// duplicated vertices
+size_t dd_optimizeVertexFetch(vec3_u* triangles, const size_t num_triangles,
+							  const unsigned* offsets, const size_t num_ranges,
+							  const size_t num_vertices,
+							  std::vector<unsigned> &source);
@@ -8,13 +8,16 @@
 #include <cstdint>
 #include <cstdlib>
 #include <cmath>
+#include "DD_Container.h"
 #include "DD_Strings.h"
 
 template<typename T>
 struct dd_vec4
 {
 	T data[4];
-	dd_vec4(T x = 0, T y = 0, T z = 0, T w = 0)
+	// trivial: a plain declaration is left uninitialized, dd_vec4() is 0
+	dd_vec4() = default;
+	dd_vec4(T x, T y = 0, T z = 0, T w = 0)
 	{
 		data[0] = x;
 		data[1] = y;
@@ -30,14 +33,6 @@ struct dd_vec4
 		data[3] = _data[3];
 	}
 
-	void operator=(const dd_vec4 other)
-	{
-		data[0] = other.data[0];
-		data[1] = other.data[1];
-		data[2] = other.data[2];
-		data[3] = other.data[3];
-	}
-
 	dd_vec4 operator-(const dd_vec4 other) const
 	{
 		return dd_vec4(data[0] - other.data[0],
@@ -58,7 +53,8 @@ struct dd_vec4
 
 struct vec3_f : public dd_vec4<float>
 {
-	vec3_f(float x = 0, float y = 0, float z = 0, float w = 0) : 
+	vec3_f() = default;
+	vec3_f(float x, float y = 0, float z = 0, float w = 0) : 
 		dd_vec4(x, y, z, w)
 	{}
 
@@ -80,7 +76,8 @@ struct vec3_f : public dd_vec4<float>
 };
 struct vec3_u : public dd_vec4<unsigned>
 {
-	vec3_u(unsigned x = 0, unsigned y = 0, unsigned z = 0, unsigned w = 0) : 
+	vec3_u() = default;
+	vec3_u(unsigned x, unsigned y = 0, unsigned z = 0, unsigned w = 0) : 
 		dd_vec4(x, y, z, w)
 	{}
 
@@ -101,19 +98,44 @@ struct vec3_u : public dd_vec4<unsigned>
 	}
 };
 
+/// \brief Interleaved vertex. Trivial (so dd_array can skip the zero fill):
+/// Vertex() is all 0, a plain declaration is left uninitialized
 struct Vertex
 {
-	float position[3] = {0, 0, 0};
-	float normal[3] = {0, 0, 0};
-	float texCoords[2] = {0, 0};
-	float tangent[3] = {0, 0, 0};
+	float position[3];
+	float normal[3];
+	float texCoords[2];
+	float tangent[4];	// w: bitangent sign (+1/-1)
 };
 
+/// \brief Structure-of-arrays vertex buffer: one tightly packed, aligned
+/// stream per Vertex attribute (see DD_VertexStreams.h)
+struct VertexStreams
+{
+	dd_array<float>	position;	// xyz
+	dd_array<float>	normal;		// xyz
+	dd_array<float>	texcoord;	// uv
+	dd_array<float>	tangent;	// xyzw (w: bitangent sign)
+
+	inline size_t size() const { return position.size() / 3; }
+	inline bool empty() const { return position.empty(); }
+};
+
+/// \brief Imported mesh: one vertex buffer shared by every ebo (submesh).
+/// The vertices are either interleaved (data) or split (streams), the other
+/// one is empty
 struct MeshContainer
 {
 	dd_array<Vertex>	data;
-	vec3_f				bbox_min;
-	vec3_f				bbox_max;
-	dd_array<unsigned>	indices;
+	VertexStreams		streams;
+	vec3_f				bbox_min = vec3_f();
+	vec3_f				bbox_max = vec3_f();
+	dd_array<vec3_u>	indices;	// triangles (w unused)
+	// ebo e: mesh_idx[e][1] triangles from indices[mesh_idx[e][0]]
 	dd_2Darray<unsigned> mesh_idx;
-};
\ No newline at end of file
+
+	inline size_t numVertices() const
+	{
+		return streams.empty() ? data.size() : streams.size();
+	}
+};
@@ -0,0 +1,54 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "DD_MeshFormat.h"
+#include "DD_MeshUtility.h"
+
+/*-----------------------------------------------------------------------------
+*
+*	Meshlets (triangle clusters) for cluster culling & mesh shaders:
+*		- each draw range [offsets[i], offsets[i + 1]) is split on its own
+*		  (meshlets never mix ebos), ranges are spread over the threads
+*		- triangles are added in index order until the vertex or triangle
+*		  limit is hit, so a vertex cache optimized order gives compact,
+*		  well filled meshlets
+*		- a meshlet lists its unique vertices (global vertex ids) and its
+*		  triangles as 8 bit indices into that list
+*		- bounds: a sphere around the vertices and a cone around the
+*		  triangle normals for backface culling (see DDMMeshlet)
+*
+-----------------------------------------------------------------------------*/
+
+/// \brief Largest meshlet limits (local indices are 8 bit)
+const unsigned k_meshlet_max_vertices = 256;
+const unsigned k_meshlet_max_triangles = 512;
+
+/// \brief Size limits of one meshlet
+struct MeshletLimits
+{
+	unsigned max_vertices = 64;
+	unsigned max_triangles = 124;
+};
+
+/// \brief Meshlets of every range, in range order
+struct MeshletBuild
+{
+	std::vector<DDMMeshlet>	meshlets;
+	std::vector<uint32_t>	vertices;	// DDMMeshlet::first_vertex
+	std::vector<uint8_t>	triangles;	// 3 per triangle
+
+	void clear();
+};
+
+/// \brief Split each range of triangles into meshlets. Runs on num_threads
+/// threads (0 = all), one range at a time per thread
+void dd_buildMeshlets(const Vertex* vertices, const size_t num_vertices,
+					  const vec3_u* triangles, const unsigned* offsets,
+					  const size_t num_ranges, const MeshletLimits &limits,
+					  MeshletBuild &out, const unsigned num_threads);
@@ -0,0 +1,49 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstddef>
+#include "DD_Container.h"
+#include "DD_MeshUtility.h"
+
+/*-----------------------------------------------------------------------------
+*
+*	Smooth normals for polygons w/o normal data:
+*		- a face adds its unit normal weighted by its area and by the angle
+*		  at the corner, so splitting a polygon into triangles barely
+*		  changes the result
+*		- crease angle: the faces around a position are grouped into
+*		  smoothing clusters (a face joins the first cluster whose first
+*		  face is within the angle, at most 16 clusters per position) and
+*		  each cluster gets one normal. Sharper edges get separate normals,
+*		  and the vertex dedup splits the vertices there
+*		- corners of a position w/ identical normals share one normal
+*		- no locks: face normals per face range, position -> corner lists
+*		  w/ atomic counters (sorted afterwards, so results don't depend on
+*		  the thread count), normals per position range. Work is linear in
+*		  the # of corners, whatever the valence
+*
+-----------------------------------------------------------------------------*/
+
+/// \brief Face corners in face order: corner c's position index is
+/// position[c * stride], its normal index normal[c * stride]
+struct NormalCorners
+{
+	const unsigned*	position;
+	unsigned*		normal;
+	size_t			stride;		// in unsigneds
+};
+
+/// \brief Generate normals for every face whose first corner's normal index
+/// is no_normal: the normals are appended to normals and their indices
+/// written to those faces' corners. Corners w/ a position index past
+/// num_positions are left as is. crease_deg >= 180 smooths every edge.
+/// Runs on num_threads threads (0 = all). Returns # of normals added
+size_t dd_generateNormals(const vec3_f* positions, const size_t num_positions,
+						  const unsigned* face_size, const size_t num_faces,
+						  const NormalCorners &corners,
+						  const unsigned no_normal, const float crease_deg,
+						  dd_array<vec3_f> &normals,
+						  const unsigned num_threads);
@@ -0,0 +1,179 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+/*-----------------------------------------------------------------------------
+*
+*	Numeric scanners for obj tokens (not locale aware, not null terminated):
+*		dd_parseFloat:
+*			- [+-]digits[.digits][(e|E)[+-]digits]
+*			- correctly rounded fast path (exact mantissa, |exp10| <= 22)
+*			- anything else (long mantissas, huge exponents, inf/nan, hex)
+*			  falls back to strtod so results always match strtod
+*		dd_parseUnsigned:
+*			- decimal digits only, saturates at UINT32_MAX
+*		dd_parseInt:
+*			- [+-]digits, saturates at +-UINT32_MAX (obj relative indices)
+*	All of them advance str past the characters consumed
+*
+-----------------------------------------------------------------------------*/
+
+namespace dd_numparse
+{
+	inline bool isDigit(const char c) { return c >= '0' && c <= '9'; }
+
+	inline bool isSeparator(const char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\0' ||
+			   c == '/';
+	}
+
+	/// \brief Slow path: strtod on a null terminated copy of the token
+	inline double strtodToken(const char *&str, const char *end)
+	{
+		const char *tok_end = str;
+		while (tok_end < end && !isSeparator(*tok_end)) { tok_end++; }
+		const size_t len = tok_end - str;
+
+		char buff[64];
+		std::string big;
+		char *tok = buff;
+		if (len < sizeof(buff)) {
+			for (size_t i = 0; i < len; i++) { buff[i] = str[i]; }
+			buff[len] = '\0';
+		}
+		else {
+			big.assign(str, len);
+			tok = &big[0];
+		}
+		char *nxt;
+		const double out = std::strtod(tok, &nxt);
+		str += (nxt - tok);
+		return out;
+	}
+}
+
+inline float dd_parseFloat(const char *&str, const char *end)
+{
+	using namespace dd_numparse;
+	// exactly representable powers of 10 in a double
+	static const double k_pow10[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+	const char *p = str;
+	bool neg = false;
+	if (p < end && (*p == '-' || *p == '+')) { neg = (*p == '-'); p++; }
+
+	uint64_t mantissa = 0;
+	int digits = 0;
+	int exp10 = 0;
+	bool any_digit = false;
+	bool truncated = false;
+
+	// integer part
+	while (p < end && isDigit(*p)) {
+		any_digit = true;
+		if (mantissa == 0 && *p == '0') { p++; continue; }
+		if (digits < 19) {
+			mantissa = mantissa * 10 + (*p - '0');
+			digits++;
+		}
+		else {
+			exp10++;
+			truncated = true;
+		}
+		p++;
+	}
+	// fraction
+	if (p < end && *p == '.') {
+		p++;
+		while (p < end && isDigit(*p)) {
+			any_digit = true;
+			if (mantissa == 0 && *p == '0') { exp10--; p++; continue; }
+			if (digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				digits++;
+				exp10--;
+			}
+			else {
+				truncated = true;
+			}
+			p++;
+		}
+	}
+	// exponent (only consumed if followed by digits, like strtod)
+	if (any_digit && p < end && (*p == 'e' || *p == 'E')) {
+		const char *q = p + 1;
+		bool exp_neg = false;
+		if (q < end && (*q == '-' || *q == '+')) { exp_neg = (*q == '-'); q++; }
+		if (q < end && isDigit(*q)) {
+			int exp_val = 0;
+			while (q < end && isDigit(*q)) {
+				if (exp_val < 100000) { exp_val = exp_val * 10 + (*q - '0'); }
+				q++;
+			}
+			exp10 += exp_neg ? -exp_val : exp_val;
+			p = q;
+		}
+	}
+
+	// hard cases: no digits (inf/nan/garbage), token continues (hex, etc),
+	// too many digits or out of fast path range
+	const bool fully_read = (p == end) || isSeparator(*p);
+	if (!any_digit || !fully_read || truncated) {
+		return (float)strtodToken(str, end);
+	}
+	if (mantissa == 0) {
+		str = p;
+		return neg ? -0.f : 0.f;
+	}
+#if FLT_EVAL_METHOD == 0
+	if (mantissa <= (1ull << 53) && exp10 >= -22 && exp10 <= 22) {
+		// both operands are exact, so the single rounding is correct
+		double val = (double)mantissa;
+		val = (exp10 < 0) ? val / k_pow10[-exp10] : val * k_pow10[exp10];
+		str = p;
+		return (float)(neg ? -val : val);
+	}
+#endif
+	return (float)strtodToken(str, end);
+}
+
+/// \brief Returns false (and leaves str) if there are no digits at str
+inline bool dd_parseUnsigned(const char *&str, const char *end, unsigned &out)
+{
+	using namespace dd_numparse;
+	const char *p = str;
+	uint64_t val = 0;
+	while (p < end && isDigit(*p)) {
+		val = val * 10 + (*p - '0');
+		val = (val > 0xFFFFFFFFull) ? 0xFFFFFFFFull : val;
+		p++;
+	}
+	if (p == str) { return false; }
+	out = (unsigned)val;
+	str = p;
+	return true;
+}
+
+/// \brief Returns false (and leaves str) if there are no digits after the
+/// optional sign
+inline bool dd_parseInt(const char *&str, const char *end, int64_t &out)
+{
+	const char *p = str;
+	const bool neg = (p < end && *p == '-');
+	if (p < end && (*p == '-' || *p == '+')) { p++; }
+	unsigned val = 0;
+	if (!dd_parseUnsigned(p, end, val)) { return false; }
+	out = neg ? -(int64_t)val : (int64_t)val;
+	str = p;
+	return true;
+}
@@ -4,7 +4,18 @@
 */
 #pragma once
 
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "DD_Arena.h"
+#include "DD_Bvh.h"
 #include "DD_Container.h"
+#include "DD_IndexMap.h"
+#include "DD_Meshlet.h"
+#include "DD_MeshOptimize.h"
+#include "DD_Profile.h"
+#include "DD_Simplify.h"
+#include "DD_VertexQuantize.h"
 #include "DD_Strings.h"
 #include "DD_MeshUtility.h"
 
@@ -12,12 +23,219 @@ enum ObjImportStatus
 {
 	GOOD,
 	FILE_NOT_FOUND,
-	V_VT_VN_MISSING
+	V_VT_VN_MISSING		// a face refers to a v/vt/vn the file doesn't have
 };
 
+enum class DDMFormat
+{
+	TEXT,		// original text .ddm
+	BINARY		// mappable binary .ddm (see DD_MeshFormat.h)
+};
+
+/// \brief Optional processing & output stages (kept across imports)
+struct ObjConvertOptions
+{
+	// smooth normals for faces w/o vn (area & angle weighted, see
+	// DD_Normals.h). Edges sharper than crease_angle (degrees) keep separate
+	// normals, >= 180 smooths every edge
+	bool generate_normals = true;
+	float crease_angle = 60.f;
+	// reorder each ebo's triangles for post-transform vertex cache hits
+	bool optimize_vertex_cache = false;
+	// renumber vertices in order of use so each ebo's vertices are
+	// contiguous (vertices shared between ebos are duplicated)
+	bool optimize_vertex_fetch = false;
+	// simplified levels to generate (binary output), coarser each level
+	std::vector<SimplifyLevel> lods;
+	// binary output: split each ebo into meshlets w/ culling bounds
+	bool build_meshlets = false;
+	MeshletLimits meshlet_limits;
+	// binary output: SAH bvh over each ebo's triangles
+	bool build_bvh = false;
+	unsigned bvh_max_leaf = 4;
+	// binary output: delta + zigzag + varint coded indices
+	bool compress_indices = false;
+	// binary output: attribute formats (float32 by default)
+	VertexEncoding vertex_encoding;
+	// keep the imported vertices as VertexStreams (MeshContainer::streams)
+	// instead of interleaved. They are split after the other stages
+	bool vertex_streams = false;
+	// binary output: one vertex stream block per attribute instead of
+	// interleaved vertices (written w/o a copy from VertexStreams w/ float32
+	// attributes)
+	bool split_vertex_streams = false;
+	// overlap the conversion stages (see DD_Pipeline.h): file reads w/ the
+	// pre-scan, parsing w/ the vertex dedup, vertex encoding & text
+	// formatting w/ the file writes. Same output, uses extra threads.
+	// pipeline_depth bounds every queue: chunks read or parsed ahead of
+	// their consumer, output blocks in flight
+	bool pipeline = false;
+	unsigned pipeline_depth = 8;
+};
+
+/// \brief Obj lines by record type
+struct ObjLineCounts
+{
+	uint64_t	v = 0;
+	uint64_t	vt = 0;
+	uint64_t	vn = 0;
+	uint64_t	f = 0;
+	uint64_t	usemtl = 0;
+	uint64_t	other = 0;	// comments, groups, unknown records, blank lines
+};
+
+/// \brief Fine grained stages & counters (zero when built w/o DD_PROFILE,
+/// see DD_Profile.h)
+struct ObjConvertProfile
+{
+	bool			enabled = DD_PROFILE != 0;
+	// import (part of import_ms)
+	ProfileStage	read;		// open & map
+	ProfileStage	scan;		// record counting & buffer sizing
+	ProfileStage	parse;		// chunked line parsing
+	ProfileStage	dedup;		// vertex & face dedup
+	// export (part of export_ms)
+	ProfileStage	encode;		// binary: vertex encoding & index packing
+	ProfileStage	format;		// text: formatting, includes its writes
+	ProfileStage	write;		// file writes
+	ObjLineCounts	lines;
+	uint64_t		corners = 0;		// face corners
+	uint64_t		polygons = 0;		// faces w/ more than 3 corners
+	uint64_t		dedup_lookups = 0;	// vertex map lookups
+	uint64_t		dedup_probes = 0;	// slots visited by those lookups
+	uint64_t		dedup_inserts = 0;	// unique vertices
+};
+
+/// \brief Summary of the last import/export
+struct ObjConvertStats
+{
+	uint64_t	bytes_read = 0;
+	uint64_t	bytes_written = 0;
+	uint64_t	index_bytes = 0;	// index data in the binary output
+	uint32_t	vertex_stride = 0;	// bytes per vertex in the binary output
+	uint64_t	arena_bytes = 0;	// import temporaries
+	uint64_t	peak_rss = 0;		// process peak after import & export
+	QuantizeError quantize_error;
+	double		import_ms = 0.0;
+	double		normal_ms = 0.0;	// part of import_ms
+	double		tangent_ms = 0.0;	// part of import_ms
+	double		optimize_ms = 0.0;	// part of import_ms (cache & fetch)
+	double		lod_ms = 0.0;		// part of import_ms
+	double		meshlet_ms = 0.0;	// part of import_ms
+	double		bvh_ms = 0.0;		// part of import_ms
+	double		export_ms = 0.0;
+	unsigned	num_vertices = 0;
+	unsigned	num_triangles = 0;
+	unsigned	num_ebos = 0;
+	unsigned	duplicated_vertices = 0;	// by optimize_vertex_fetch
+	unsigned	generated_normals = 0;		// by generate_normals
+	std::vector<unsigned> lod_triangles;	// per lod level
+	std::vector<float> lod_error;			// per lod level (relative)
+	unsigned	num_meshlets = 0;
+	unsigned	bvh_nodes = 0;
+	unsigned	bvh_depth = 0;		// deepest over all ebos
+	float		bvh_sah_cost = 0.f;	// triangle weighted average
+	unsigned	parse_threads = 1;
+	unsigned	parse_chunks = 1;	// > parse_threads if pipelined
+	// FIFO cache simulation before/after optimize_vertex_cache
+	VertexCacheStats cache_before;
+	VertexCacheStats cache_after;
+	ObjConvertProfile profile;
+};
+
+/// \brief Converts obj files to .ddm. All conversion state is held per
+/// instance, so separate converters can run on separate threads
 struct DD_ObjConverter
 {
-	ObjImportStatus importOBJ(const char* filename);
-	void exportMesh();
+	// num_threads == 0 uses all hardware threads
+	ObjImportStatus importOBJ(const char* filename,
+							  const unsigned num_threads = 1);
+	// import & hand the mesh to the caller (see takeMesh)
+	MeshContainer importOBJ(const char* filename, ObjImportStatus &status,
+							const unsigned num_threads = 1);
+	// writes <out_dir>/<name>.ddm, returns false on failure
+	bool exportMesh(const DDMFormat format = DDMFormat::BINARY,
+					const char* out_dir = nullptr);
 	void printStats();
-};
\ No newline at end of file
+	ObjConvertStats stats() const;
+	// <out_dir>/<name>.ddm
+	std::string outputPath(const char* out_dir = nullptr) const;
+
+	inline void setOptions(const ObjConvertOptions &opts) { options = opts; }
+	inline const ObjConvertOptions &getOptions() const { return options; }
+
+	// imported mesh (what exportMesh writes)
+	inline const MeshContainer &getMesh() const { return mesh; }
+	// move the imported mesh out (no copy) & reset(). Read stats() first
+	MeshContainer takeMesh();
+
+	// mesh & output file name (defaults to "static_mesh", reset on import)
+	void setName(const char* name);
+	inline const char* name() const { return obj_id._str(); }
+
+	// clear imported data, keeps buffer capacity for the next import
+	void reset();
+	// clear imported data and free buffers
+	void releaseMemory();
+
+private:
+	uint64_t exportBinary(const char* filename);
+	uint64_t exportText(const char* filename);
+	// # of ebos (submeshes) imported
+	inline unsigned numEbos() const
+	{
+		return mesh_offset.empty() ? 0 : (unsigned)mesh_offset.size() - 1;
+	}
+	// # of lod levels generated
+	inline unsigned numLods() const
+	{
+		return (unsigned)lod_error.size();
+	}
+	void generateLods(const unsigned num_threads);
+	void optimizeVertexFetch(const unsigned num_threads);
+	void bvhQuality(unsigned &depth, float &sah_cost) const;
+
+	dd_array<vec3_f>		vert;
+	dd_array<vec3_f>		norm;
+	dd_array<vec3_f>		uv;
+	MeshContainer			mesh;
+	// ebo e: mesh.indices[mesh_offset[e] .. mesh_offset[e + 1])
+	std::vector<unsigned>	mesh_offset;
+	// lod level l, ebo e: lod_indices[lod_offset[l * numEbos() + e] ..
+	// lod_offset[l * numEbos() + e + 1])
+	std::vector<vec3_u>		lod_indices;
+	std::vector<unsigned>	lod_offset;
+	std::vector<float>		lod_error;
+	MeshletBuild			meshlets;
+	BvhBuild				bvh;
+	dd_indexmap				meshbin;
+	dd_arena				arena;
+	cbuff<64>				obj_id = cbuff<64>("static_mesh");
+	ObjConvertOptions		options;
+
+	unsigned unique_v = 0;
+	unsigned copied_v = 0;
+	unsigned duplicated_v = 0;
+	unsigned generated_normals = 0;
+
+	size_t bytes_read = 0;
+	uint64_t bytes_written = 0;
+	uint64_t index_bytes = 0;
+	uint32_t vertex_stride = 0;
+	uint64_t arena_bytes = 0;
+	uint64_t peak_rss = 0;
+	QuantizeError quantize_error;
+	double import_ms = 0.0;
+	double normal_ms = 0.0;
+	double tangent_ms = 0.0;
+	double optimize_ms = 0.0;
+	double lod_ms = 0.0;
+	double meshlet_ms = 0.0;
+	double bvh_ms = 0.0;
+	double export_ms = 0.0;
+	unsigned parse_threads = 1;
+	unsigned parse_chunks = 1;
+	VertexCacheStats cache_before;
+	VertexCacheStats cache_after;
+	ObjConvertProfile profile;
+};
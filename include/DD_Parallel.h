@@ -0,0 +1,53 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/*-----------------------------------------------------------------------------
+*
+*	dd_parallel_for:
+*		- splits [0, count) into num_threads contiguous ranges
+*		- calls func(begin, end, range_index) for each range
+*		- the last range runs on the calling thread
+*		- blocks until all ranges are done
+*
+-----------------------------------------------------------------------------*/
+
+/// \brief Number of hardware threads (at least 1)
+inline unsigned dd_hardware_threads()
+{
+	const unsigned n = std::thread::hardware_concurrency();
+	return n == 0 ? 1 : n;
+}
+
+template <typename Func>
+void dd_parallel_for(const size_t count, unsigned num_threads, Func func)
+{
+	if (num_threads == 0) { num_threads = dd_hardware_threads(); }
+	if (num_threads > count) { num_threads = (unsigned)count; }
+	if (num_threads <= 1) {
+		if (count > 0) { func((size_t)0, count, 0u); }
+		return;
+	}
+
+	std::vector<std::thread> workers;
+	workers.reserve(num_threads - 1);
+	for (unsigned i = 0; i < num_threads; i++) {
+		const size_t begin = count * i / num_threads;
+		const size_t end = count * (i + 1) / num_threads;
+		if (i == num_threads - 1) {
+			func(begin, end, i);
+		}
+		else {
+			workers.emplace_back(func, begin, end, i);
+		}
+	}
+	for (auto& worker : workers) {
+		worker.join();
+	}
+}
@@ -0,0 +1,214 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "DD_Profile.h"
+
+/*-----------------------------------------------------------------------------
+*
+*	Pipelined conversion stages:
+*		- dd_spsc_queue: bounded ring between one producer & one consumer
+*		  thread, lock-free unless a side has to sleep. A full queue blocks
+*		  the producer (backpressure), an empty one the consumer, until
+*		  close()
+*		- DD_WriteStage: file output on its own thread. Producers fill
+*		  blocks from a fixed pool & queue them (or queue buffers that
+*		  outlive close()), so formatting/encoding overlaps the writes and
+*		  memory stays at the pool size. 0 blocks: writes inline
+*		- waits spin briefly, then sleep on a condition variable until the
+*		  other side pushes, pops or closes, so a stage blocked on a slow
+*		  one (e.g. the writer on the disk) leaves its core to the others
+*
+-----------------------------------------------------------------------------*/
+
+template <typename T>
+class dd_spsc_queue
+{
+public:
+	// capacity is rounded up to a power of 2
+	dd_spsc_queue(const size_t capacity = 16)
+	{
+		size_t size = 2;
+		while (size < capacity) { size *= 2; }
+		m_items.resize(size);
+		m_mask = size - 1;
+	}
+
+	dd_spsc_queue(const dd_spsc_queue&) = delete;
+	dd_spsc_queue& operator=(const dd_spsc_queue&) = delete;
+
+	// producer: false if full
+	bool tryPush(const T &value)
+	{
+		if (!pushOne(value)) { return false; }
+		wake();
+		return true;
+	}
+
+	// producer: waits while full
+	void push(const T &value)
+	{
+		waitUntil([&]() { return pushOne(value); });
+		wake();
+	}
+
+	// producer: no more values. pop() fails once the queue is drained
+	void close()
+	{
+		m_closed.store(true, std::memory_order_release);
+		wake();
+	}
+
+	// consumer: false if empty
+	bool tryPop(T &value)
+	{
+		if (!popOne(value)) { return false; }
+		wake();
+		return true;
+	}
+
+	// consumer: waits for a value, false if closed & drained
+	bool pop(T &value)
+	{
+		bool got = false;
+		waitUntil([&]() {
+			// closed is checked first: a value pushed before close() is
+			// still seen by the popOne after it
+			const bool closed = m_closed.load(std::memory_order_acquire);
+			got = popOne(value);
+			return got || closed;
+		});
+		if (got) { wake(); }
+		return got;
+	}
+
+private:
+	bool pushOne(const T &value)
+	{
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_head.load(std::memory_order_acquire) > m_mask) {
+			return false;
+		}
+		m_items[tail & m_mask] = value;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool popOne(T &value)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire)) { return false; }
+		value = m_items[head & m_mask];
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/// \brief Spin briefly (the other side is usually about to catch up),
+	/// then sleep until the other side pushes, pops or closes
+	template <typename Func>
+	void waitUntil(Func done)
+	{
+		for (unsigned spins = 0; spins < k_spins; spins++) {
+			if (done()) { return; }
+		}
+		std::unique_lock<std::mutex> lock(m_lock);
+		m_sleepers.fetch_add(1, std::memory_order_seq_cst);
+		// pairs w/ the fence in wake(): either wake() sees the sleeper or
+		// done() sees the state wake() was called for
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		while (!done()) { m_wake.wait(lock); }
+		m_sleepers.fetch_sub(1, std::memory_order_relaxed);
+	}
+
+	/// \brief Wake a sleeping side. Only locks when one is asleep
+	void wake()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (m_sleepers.load(std::memory_order_relaxed) == 0) { return; }
+		// a sleeper holds the lock until it waits, so it can't miss this
+		{ std::lock_guard<std::mutex> lock(m_lock); }
+		m_wake.notify_all();
+	}
+
+	static const unsigned k_spins = 64;
+
+	std::vector<T> m_items;
+	size_t m_mask = 0;
+	// head & tail on separate cache lines: each side writes only its own
+	char m_pad0[64];
+	std::atomic<size_t> m_head{ 0 };	// next pop
+	char m_pad1[64];
+	std::atomic<size_t> m_tail{ 0 };	// next push
+	std::atomic<bool> m_closed{ false };
+	// producer & consumer each sleep here at most (full / empty queue)
+	std::atomic<unsigned> m_sleepers{ 0 };
+	std::mutex m_lock;
+	std::condition_variable m_wake;
+};
+
+class DD_WriteStage
+{
+public:
+	DD_WriteStage() {}
+	~DD_WriteStage() { close(); }
+
+	DD_WriteStage(const DD_WriteStage&) = delete;
+	DD_WriteStage& operator=(const DD_WriteStage&) = delete;
+
+	// open (truncate) filename. num_blocks > 0 starts the writer thread w/
+	// a pool of num_blocks blocks, 0 writes on the calling thread (1 block)
+	bool open(const char* filename, const size_t block_size,
+			  const unsigned num_blocks = 0);
+	// wait for queued writes, close the file & stop the writer. Returns
+	// false if any write failed
+	bool close();
+
+	// a free block of blockSize() bytes (waits while every block is queued)
+	char* acquire();
+	// queue the first len bytes of a block from acquire()
+	void submit(char* block, const size_t len);
+	// queue bytes that stay valid until close() (no copy)
+	void submitExternal(const void* data, const size_t len);
+
+	inline size_t blockSize() const { return m_block_size; }
+	inline bool isOpen() const { return m_file != nullptr; }
+	// bytes queued so far (the file size once closed)
+	inline uint64_t bytesQueued() const { return m_queued; }
+	// bytes handed to the file (complete once closed)
+	inline uint64_t bytesWritten() const { return m_written; }
+	// time & allocations of the file writes (complete once closed)
+	inline const ProfileStage &writeProfile() const { return m_profile; }
+
+private:
+	struct WriteItem
+	{
+		const char*	data;
+		size_t		len;
+		char*		block;	// returned to the pool once written, or null
+	};
+
+	void write(const WriteItem &item);
+	void writerLoop();
+
+	FILE* m_file = nullptr;
+	size_t m_block_size = 0;
+	std::vector<char> m_storage;
+	std::unique_ptr<dd_spsc_queue<WriteItem>> m_pending;
+	std::unique_ptr<dd_spsc_queue<char*>> m_free;
+	std::thread m_writer;
+	uint64_t m_queued = 0;
+	uint64_t m_written = 0;
+	bool m_good = true;
+	ProfileStage m_profile;
+};
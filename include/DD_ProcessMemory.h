@@ -0,0 +1,27 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstdint>
+
+/*-----------------------------------------------------------------------------
+*
+*	Process memory counters (for benchmarks & stats):
+*		- peak resident set size: VmHWM on Linux, ru_maxrss on other unix,
+*		  PeakWorkingSetSize on windows
+*		- only Linux can restart the peak (clear_refs), elsewhere the peak
+*		  covers the whole life of the process
+*
+-----------------------------------------------------------------------------*/
+
+/// \brief Peak resident set size in bytes (0 if unknown)
+uint64_t dd_peakRSS();
+
+/// \brief Current resident set size in bytes (0 if unknown)
+uint64_t dd_currentRSS();
+
+/// \brief Restart peak tracking at the current RSS. Returns false when the
+/// OS doesn't support it
+bool dd_resetPeakRSS();
@@ -0,0 +1,87 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+/*-----------------------------------------------------------------------------
+*
+*	Conversion profiling:
+*		- DD_PROFILE 1 (default) / 0: w/ 0 every DD_PROFILE_* macro expands
+*		  to nothing and profile structs stay zero (cmake -DDD_PROFILE=OFF)
+*		- DD_PROFILE_SCOPE(stage): adds the wall time and the allocations of
+*		  the enclosing scope to a ProfileStage
+*		- DD_PROFILE_COUNT(counter, n): counter += n
+*		- allocations are counted by replacing global operator new (see
+*		  DD_Profile.cpp). The counters are process wide, so stages that
+*		  overlap w/ other threads' work (e.g. batch workers) include it
+*
+-----------------------------------------------------------------------------*/
+
+#ifndef DD_PROFILE
+	#define DD_PROFILE 1
+#endif
+
+/// \brief Time & allocations spent in a stage (summed over its scopes)
+struct ProfileStage
+{
+	double		ms = 0.0;
+	uint64_t	allocs = 0;			// operator new calls
+	uint64_t	alloc_bytes = 0;	// bytes requested
+
+	ProfileStage& operator+=(const ProfileStage &other)
+	{
+		ms += other.ms;
+		allocs += other.allocs;
+		alloc_bytes += other.alloc_bytes;
+		return *this;
+	}
+};
+
+/// \brief Process wide operator new calls & bytes so far (0 w/o DD_PROFILE)
+void dd_allocCounts(uint64_t &allocs, uint64_t &bytes);
+
+/// \brief Adds its lifetime to a ProfileStage (use DD_PROFILE_SCOPE)
+class dd_profilescope
+{
+public:
+	dd_profilescope(ProfileStage &stage) : m_stage(stage)
+	{
+		dd_allocCounts(m_allocs, m_bytes);
+		m_start = std::chrono::high_resolution_clock::now();
+	}
+
+	~dd_profilescope()
+	{
+		m_stage.ms += std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - m_start).count();
+		uint64_t allocs, bytes;
+		dd_allocCounts(allocs, bytes);
+		m_stage.allocs += allocs - m_allocs;
+		m_stage.alloc_bytes += bytes - m_bytes;
+	}
+
+	dd_profilescope(const dd_profilescope&) = delete;
+	dd_profilescope& operator=(const dd_profilescope&) = delete;
+
+private:
+	ProfileStage &m_stage;
+	std::chrono::high_resolution_clock::time_point m_start;
+	uint64_t m_allocs = 0;
+	uint64_t m_bytes = 0;
+};
+
+#define DD_PROFILE_CONCAT_(a, b) a##b
+#define DD_PROFILE_CONCAT(a, b) DD_PROFILE_CONCAT_(a, b)
+
+#if DD_PROFILE
+	#define DD_PROFILE_SCOPE(stage) \
+		dd_profilescope DD_PROFILE_CONCAT(dd_profile_scope_, __LINE__)(stage)
+	#define DD_PROFILE_COUNT(counter, n) ((counter) += (n))
+#else
+	#define DD_PROFILE_SCOPE(stage) ((void)0)
+	#define DD_PROFILE_COUNT(counter, n) ((void)0)
+#endif
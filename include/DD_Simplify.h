@@ -0,0 +1,53 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "DD_MeshUtility.h"
+
+/*-----------------------------------------------------------------------------
+*
+*	Quadric error simplification (Garland & Heckbert), for LOD chains:
+*		- vertices are only collapsed onto existing neighbors, so every
+*		  level keeps using the full resolution vertex buffer
+*		- runs in passes: each pass picks the cheapest collapse per vertex,
+*		  sorts them and applies a non-overlapping set, until the level's
+*		  triangle target or error limit is reached
+*		- vertices on a border of the simplified triangle set (i.e. open
+*		  edges & submesh boundaries) and on uv/normal seams never move;
+*		  other vertices may collapse onto them
+*		- collapses that would flip a triangle are rejected
+*		- a chain continues from the previous level (quadrics included),
+*		  so level n + 1 is always a simplification of level n
+*
+-----------------------------------------------------------------------------*/
+
+/// \brief Target of one LOD level
+struct SimplifyLevel
+{
+	// fraction of the full resolution triangles to keep (0 = error bound)
+	float ratio = 0.5f;
+	// largest allowed error, relative to the mesh extent (bbox diagonal)
+	float max_error = 0.01f;
+};
+
+/// \brief Flag vertices sharing their position w/ another vertex (seams)
+void dd_seamVertices(const Vertex* vertices, const size_t num_vertices,
+					 std::vector<uint8_t> &seam);
+
+/// \brief Bounding box diagonal of the vertex positions
+float dd_meshExtent(const Vertex* vertices, const size_t num_vertices);
+
+/// \brief Simplify one triangle set into a chain of num_levels levels.
+/// out[l] gets the triangles of level l (global vertex indices, input
+/// order kept), error[l] the relative error it reached. locked flags
+/// vertices that must not move (e.g. dd_seamVertices)
+void dd_simplifyChain(const Vertex* vertices, const uint8_t* locked,
+					  const float extent, const vec3_u* triangles,
+					  const size_t num_triangles, const SimplifyLevel* levels,
+					  const size_t num_levels, std::vector<vec3_u>* out,
+					  float* error);
@@ -0,0 +1,40 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+#include "DD_ObjConverter.h"
+
+/*-----------------------------------------------------------------------------
+*
+*	Conversion stats as JSON (obj_to_ddm -J):
+*		- one object per converted file: input, status, sizes, counts, stage
+*		  times & the DD_PROFILE counters ("profile.enabled" is false & the
+*		  counters are 0 when built w/o it)
+*		- batch runs write an array of these in report order
+*		- non-finite numbers are written as null
+*
+-----------------------------------------------------------------------------*/
+
+/// \brief One converted file
+struct StatsJsonEntry
+{
+	std::string		input;
+	const char*		status = "ok";
+	bool			cached = false;
+	double			total_ms = 0.0;
+	ObjConvertStats	stats;
+};
+
+/// \brief Entry as a JSON object, indented by indent tabs
+std::string dd_statsJson(const StatsJsonEntry &entry,
+						 const unsigned indent = 0);
+
+/// \brief Write one entry as an object, or several as an array. Returns false
+/// if the file can't be written
+bool dd_writeStatsJson(const char* filename,
+					   const std::vector<StatsJsonEntry> &entries,
+					   const bool as_array);
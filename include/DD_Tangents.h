@@ -0,0 +1,21 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstddef>
+#include "DD_MeshUtility.h"
+
+/// \brief Generate per-vertex tangents (tangent[0..2]) and bitangent sign
+/// (tangent[3]) from positions, uvs and normals.
+///
+/// Each triangle contributes its uv-space tangent/bitangent weighted by its
+/// area (triangles w/ degenerate uvs are skipped). The sums are then
+/// orthonormalized against the vertex normal (Gram-Schmidt). Per-triangle and
+/// per-vertex work runs on num_threads threads (0 = all hardware threads),
+/// the accumulation too: each vertex gathers the triangles that use it and
+/// sums them in triangle order, so results don't depend on the thread count
+void dd_computeTangents(Vertex* vertices, const size_t num_vertices,
+						const vec3_u* triangles, const size_t num_triangles,
+						const unsigned num_threads);
@@ -0,0 +1,109 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include "DD_Pipeline.h"
+#include "DD_Profile.h"
+
+/*-----------------------------------------------------------------------------
+*
+*	DD_TextWriter:
+*		- buffered text output to a file
+*			- formats into a large block, written w/ one fwrite when full
+*			- pipelined: full blocks go to a writer thread (DD_WriteStage)
+*			  & formatting continues in the next free block
+*			- putUnsigned: same text as printf("%u")
+*			- putFixed: same text as printf("%.Nf") for N <= 9
+*			- tracks bytes written & the time spent writing (DD_PROFILE)
+*
+-----------------------------------------------------------------------------*/
+
+class DD_TextWriter
+{
+public:
+	DD_TextWriter(const size_t block_size = 1 << 20) :
+		m_block_size(block_size) {}
+	~DD_TextWriter() { close(); }
+
+	DD_TextWriter(const DD_TextWriter&) = delete;
+	DD_TextWriter& operator=(const DD_TextWriter&) = delete;
+
+	// open (truncate) output file. pipeline_blocks > 0 writes on a separate
+	// thread w/ at most that many blocks in flight
+	bool open(const char* filename, const unsigned pipeline_blocks = 0);
+	// flush & close. Returns false if any write failed
+	bool close();
+
+	inline void put(const char c)
+	{
+		if (m_pos == m_block_size) { flush(); }
+		m_block[m_pos++] = c;
+	}
+
+	inline void put(const char* str)
+	{
+		put(str, strlen(str));
+	}
+
+	void put(const char* str, size_t len)
+	{
+		// blocks are reused once written, so long strings are copied in
+		// pieces
+		while (m_pos + len > m_block_size) {
+			const size_t part = m_block_size - m_pos;
+			memcpy(m_block + m_pos, str, part);
+			m_pos += part;
+			str += part;
+			len -= part;
+			flush();
+		}
+		memcpy(m_block + m_pos, str, len);
+		m_pos += len;
+	}
+
+	inline void putUnsigned(uint64_t val)
+	{
+		reserve(k_max_number);
+		char digits[20];
+		unsigned n = 0;
+		do {
+			digits[n++] = (char)('0' + val % 10);
+			val /= 10;
+		} while (val);
+		while (n) { m_block[m_pos++] = digits[--n]; }
+	}
+
+	// fixed-point float w/ precision digits after the point
+	void putFixed(const float val, const unsigned precision);
+
+	// bytes handed to the file (complete once closed)
+	inline uint64_t bytesWritten() const { return m_stage.bytesWritten(); }
+	// time & allocations of the file writes (complete once closed)
+	inline const ProfileStage &writeProfile() const
+	{
+		return m_stage.writeProfile();
+	}
+
+private:
+	// longest output of putUnsigned/putFixed fast path
+	static const size_t k_max_number = 48;
+
+	inline void reserve(const size_t bytes)
+	{
+		if (m_pos + bytes > m_block_size) { flush(); }
+	}
+	// queue the current block & continue in a free one
+	void flush();
+
+	DD_WriteStage m_stage;
+	size_t m_block_size;
+	char* m_block = nullptr;
+	size_t m_pos = 0;
+	bool m_good = false;
+};
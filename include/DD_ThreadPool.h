@@ -0,0 +1,113 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*-----------------------------------------------------------------------------
+*
+*	dd_workpool:
+*		- work-stealing pool for a known batch of tasks
+*			- push() deals tasks round-robin onto per-worker queues
+*			- run() starts the workers and blocks until every task is done
+*			- a worker pops from the front of its own queue; when it is
+*			  empty it steals from the back of the fullest other queue
+*			- tasks get the index of the worker running them, so callers can
+*			  keep per-worker state (e.g. one converter per worker)
+*
+-----------------------------------------------------------------------------*/
+
+class dd_workpool
+{
+public:
+	typedef std::function<void(const unsigned worker)> Task;
+
+	dd_workpool(const unsigned num_workers) :
+		m_queues(num_workers == 0 ? 1 : num_workers)
+	{
+		for (auto &queue : m_queues) { queue.reset(new Queue()); }
+	}
+
+	inline unsigned numWorkers() const { return (unsigned)m_queues.size(); }
+
+	// queue a task (call before run())
+	void push(Task task)
+	{
+		Queue &queue = *m_queues[m_next];
+		m_next = (m_next + 1) % m_queues.size();
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		queue.tasks.push_back(std::move(task));
+	}
+
+	// run all queued tasks, returns when they are finished
+	void run()
+	{
+		std::vector<std::thread> workers;
+		for (unsigned i = 1; i < numWorkers(); i++) {
+			workers.emplace_back(&dd_workpool::workerLoop, this, i);
+		}
+		workerLoop(0);
+		for (auto &worker : workers) { worker.join(); }
+	}
+
+private:
+	struct Queue
+	{
+		std::mutex mutex;
+		std::deque<Task> tasks;
+	};
+
+	bool popLocal(const unsigned worker, Task &task)
+	{
+		Queue &queue = *m_queues[worker];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty()) { return false; }
+		task = std::move(queue.tasks.front());
+		queue.tasks.pop_front();
+		return true;
+	}
+
+	bool steal(const unsigned worker, Task &task)
+	{
+		// pick the victim w/ the most work left
+		while (true) {
+			unsigned victim = worker;
+			size_t most = 0;
+			for (unsigned i = 0; i < numWorkers(); i++) {
+				if (i == worker) { continue; }
+				std::lock_guard<std::mutex> lock(m_queues[i]->mutex);
+				if (m_queues[i]->tasks.size() > most) {
+					most = m_queues[i]->tasks.size();
+					victim = i;
+				}
+			}
+			if (victim == worker) { return false; }
+
+			Queue &queue = *m_queues[victim];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.tasks.empty()) { continue; } // lost the race, retry
+			task = std::move(queue.tasks.back());
+			queue.tasks.pop_back();
+			return true;
+		}
+	}
+
+	void workerLoop(const unsigned worker)
+	{
+		Task task;
+		// tasks are only queued before run(), so no work left == done
+		while (popLocal(worker, task) || steal(worker, task)) {
+			task(worker);
+		}
+	}
+
+	std::vector<std::unique_ptr<Queue>> m_queues;
+	size_t m_next = 0;
+};
@@ -0,0 +1,126 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "DD_MeshFormat.h"
+#include "DD_MeshUtility.h"
+
+/*-----------------------------------------------------------------------------
+*
+*	Vertex attribute encodings for the binary .ddm vertex block:
+*		position:	float32 | float16 | unorm16 over the mesh bounding box
+*		normal,
+*		tangent:	float32 | octahedral snorm16 | snorm 10-10-10-2
+*					(tangent w = bitangent sign)
+*		texcoord:	float32 | float16 | unorm16 over the uv bounding box
+*	Attributes the mesh has no data for are left out of the layout.
+*	Ranged (unorm) formats are decoded as min + value * (max - min) with the
+*	attribute's DDMAttribRange.
+*	Split layouts give every attribute its own packed stream; the encoded
+*	buffer holds the streams back to back in attribute order. Vertices can
+*	come interleaved (struct Vertex) or as VertexStreams
+*
+-----------------------------------------------------------------------------*/
+
+enum class PositionEncoding
+{
+	FLOAT32,
+	FLOAT16,
+	UNORM16
+};
+
+enum class DirectionEncoding
+{
+	FLOAT32,
+	OCT_SNORM16,
+	SNORM10
+};
+
+enum class TexCoordEncoding
+{
+	FLOAT32,
+	FLOAT16,
+	UNORM16
+};
+
+struct VertexEncoding
+{
+	PositionEncoding	position = PositionEncoding::FLOAT32;
+	DirectionEncoding	normal = DirectionEncoding::FLOAT32;
+	DirectionEncoding	tangent = DirectionEncoding::FLOAT32;
+	TexCoordEncoding	texcoord = TexCoordEncoding::FLOAT32;
+};
+
+/// \brief Largest error the encoding introduced over all vertices
+struct QuantizeError
+{
+	float position = 0.f;		// object space units, per component
+	float normal_deg = 0.f;		// angle between original & decoded
+	float tangent_deg = 0.f;
+	float texcoord = 0.f;		// per component
+};
+
+/// \brief into = per field max of into & err
+inline void dd_mergeError(QuantizeError &into, const QuantizeError &err)
+{
+	into.position = std::max(into.position, err.position);
+	into.normal_deg = std::max(into.normal_deg, err.normal_deg);
+	into.tangent_deg = std::max(into.tangent_deg, err.tangent_deg);
+	into.texcoord = std::max(into.texcoord, err.texcoord);
+}
+
+/// \brief Attribute layout of an encoded vertex
+struct VertexLayout
+{
+	unsigned		num_attribs = 0;
+	uint32_t		stride = 0;		// over all attributes
+	bool			split = false;	// one stream per attribute
+	DDMVertexAttrib	attribs[4];
+	DDMAttribRange	ranges[4];
+
+	// true if vertices are stored exactly as struct Vertex
+	bool isRawVertex() const;
+	// true if split streams are stored exactly as VertexStreams
+	bool isRawStreams() const;
+	// split: byte offset of attribute a's stream in the encoded buffer
+	uint64_t streamOffset(const unsigned a, const size_t num_vertices) const;
+};
+
+/// \brief Layout for enc. Normals/texcoords are dropped when the mesh has
+/// none; tangents need both
+VertexLayout dd_vertexLayout(const VertexEncoding &enc, const bool has_normals,
+							 const bool has_texcoords,
+							 const bool split = false);
+
+/// \brief Fill in the position & texcoord bounds of layout.ranges
+void dd_vertexRanges(const Vertex* vertices, const size_t num_vertices,
+					 VertexLayout &layout);
+void dd_vertexRanges(const VertexStreams &streams, VertexLayout &layout);
+
+/// \brief Encode vertices into out (num_vertices * layout.stride bytes).
+/// layout.ranges must be filled in (dd_vertexRanges). Runs on num_threads
+/// threads (0 = all)
+void dd_quantizeVertices(const Vertex* vertices, const size_t num_vertices,
+						 const VertexLayout &layout,
+						 std::vector<uint8_t> &out, QuantizeError &error,
+						 const unsigned num_threads);
+void dd_quantizeVertices(const VertexStreams &streams,
+						 const VertexLayout &layout,
+						 std::vector<uint8_t> &out, QuantizeError &error,
+						 const unsigned num_threads);
+/// \brief Same, into num_vertices * layout.stride bytes at out. W/ an
+/// interleaved layout, consecutive slices of the vertices encode to
+/// consecutive slices of the whole buffer (for streamed output)
+void dd_quantizeVertices(const Vertex* vertices, const size_t num_vertices,
+						 const VertexLayout &layout, uint8_t* out,
+						 QuantizeError &error, const unsigned num_threads);
+
+/// \brief IEEE half from float (round to nearest even, overflow -> inf)
+uint16_t dd_floatToHalf(const float val);
+float dd_halfToFloat(const uint16_t val);
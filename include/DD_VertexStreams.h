@@ -0,0 +1,49 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#pragma once
+
+#include <cstddef>
+#include "DD_MeshUtility.h"
+
+/*-----------------------------------------------------------------------------
+*
+*	Structure-of-arrays vertices (VertexStreams):
+*		- each attribute is its own packed stream, so a pass that needs
+*		  only positions (bounds, depth-only rendering) reads nothing else
+*		- streams are k_dd_array_align aligned: bulk loops run w/o strides
+*		  and the binary export can write them as they are
+*		- dd_streamBounds runs 4 lanes at a time w/ SSE when the target has
+*		  it, scalar otherwise (same results)
+*
+-----------------------------------------------------------------------------*/
+
+/// \brief Copy interleaved vertices into streams (resized to num_vertices).
+/// Runs on num_threads threads (0 = all)
+void dd_splitVertices(const Vertex* vertices, const size_t num_vertices,
+					  VertexStreams &streams, const unsigned num_threads);
+
+/// \brief Vertex i of streams as an interleaved record
+inline Vertex dd_gatherVertex(const VertexStreams &streams, const size_t i)
+{
+	Vertex vert;
+	for (int k = 0; k < 3; k++) {
+		vert.position[k] = streams.position.data()[i * 3 + k];
+		vert.normal[k] = streams.normal.data()[i * 3 + k];
+	}
+	for (int k = 0; k < 2; k++) {
+		vert.texCoords[k] = streams.texcoord.data()[i * 2 + k];
+	}
+	for (int k = 0; k < 4; k++) {
+		vert.tangent[k] = streams.tangent.data()[i * 4 + k];
+	}
+	return vert;
+}
+
+/// \brief Per component min/max of count elements of width (1-4) floats,
+/// stride floats apart (stride == width: packed stream, SIMD path).
+/// min & max are 0 when count is 0
+void dd_streamBounds(const float* data, const size_t count,
+					 const unsigned width, const size_t stride,
+					 float* min, float* max);
@@ -0,0 +1,386 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include "DD_Bvh.h"
+#include "DD_Parallel.h"
+#include "DD_ThreadPool.h"
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+
+namespace
+{
+	// SAH cost of visiting a node vs testing a triangle
+	const float k_traversal_cost = 1.f;
+	const float k_intersect_cost = 1.f;
+	// subtrees of at most this many triangles are built by one task
+	const size_t k_min_task_triangles = 4096;
+
+	struct Aabb
+	{
+		float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		void grow(const float* p)
+		{
+			for (int k = 0; k < 3; k++) {
+				lo[k] = std::min(lo[k], p[k]);
+				hi[k] = std::max(hi[k], p[k]);
+			}
+		}
+
+		void grow(const Aabb &box)
+		{
+			for (int k = 0; k < 3; k++) {
+				lo[k] = std::min(lo[k], box.lo[k]);
+				hi[k] = std::max(hi[k], box.hi[k]);
+			}
+		}
+
+		// surface area (0 when empty)
+		float area() const
+		{
+			if (lo[0] > hi[0]) { return 0.f; }
+			const float dx = hi[0] - lo[0];
+			const float dy = hi[1] - lo[1];
+			const float dz = hi[2] - lo[2];
+			return 2.f * (dx * dy + dy * dz + dz * dx);
+		}
+	};
+
+	/// \brief Node while building. Children are indices into the same
+	/// vector; child[0] == 0 marks a leaf (the root is never a child)
+	struct BuildNode
+	{
+		Aabb		box;
+		uint32_t	first = 0;		// into BuildInput::refs
+		uint32_t	count = 0;
+		uint32_t	child[2] = { 0, 0 };
+	};
+
+	/// \brief Per triangle bounds shared by every task. Tasks reorder
+	/// disjoint ranges of refs
+	struct BuildInput
+	{
+		const Aabb*		boxes;
+		const float*	centroids;	// 3 per triangle
+		uint32_t*		refs;		// triangle # (into the index array)
+		unsigned		max_leaf;
+	};
+
+	/// \brief Bounds of the triangles in node's ref range
+	Aabb refBounds(const BuildInput &in, const BuildNode &node)
+	{
+		Aabb box;
+		for (uint32_t i = node.first; i < node.first + node.count; i++) {
+			box.grow(in.boxes[in.refs[i]]);
+		}
+		return box;
+	}
+
+	/// \brief Split nodes[idx] at the cheapest SAH bin boundary (or in the
+	/// middle when every centroid is in one spot). Returns false when it
+	/// should stay a leaf
+	bool splitNode(const BuildInput &in, std::vector<BuildNode> &nodes,
+				   const uint32_t idx)
+	{
+		const BuildNode node = nodes[idx];
+		if (node.count <= 1) { return false; }
+		uint32_t* refs = in.refs + node.first;
+
+		Aabb centers;
+		for (uint32_t i = 0; i < node.count; i++) {
+			centers.grow(in.centroids + refs[i] * 3);
+		}
+		float scale[3];
+		for (int k = 0; k < 3; k++) {
+			const float extent = centers.hi[k] - centers.lo[k];
+			scale[k] = (extent > 0.f) ? k_bvh_bins / extent : 0.f;
+		}
+		/// \brief Lambda to get the bin of a centroid along axis
+		auto binOf = [&](const float* c, const int axis) {
+			const unsigned bin =
+				(unsigned)((c[axis] - centers.lo[axis]) * scale[axis]);
+			return std::min(bin, k_bvh_bins - 1);
+		};
+
+		// bin all three axes in one pass
+		Aabb bins[3][k_bvh_bins];
+		unsigned counts[3][k_bvh_bins] = {};
+		for (uint32_t i = 0; i < node.count; i++) {
+			const float* c = in.centroids + refs[i] * 3;
+			for (int k = 0; k < 3; k++) {
+				if (scale[k] == 0.f) { continue; }
+				const unsigned bin = binOf(c, k);
+				bins[k][bin].grow(in.boxes[refs[i]]);
+				counts[k][bin]++;
+			}
+		}
+
+		int best_axis = -1;
+		unsigned best_bin = 0;
+		float best_cost = FLT_MAX;
+		for (int k = 0; k < 3; k++) {
+			if (scale[k] == 0.f) { continue; }
+			// right side of each boundary, then sweep the left side
+			float right_area[k_bvh_bins];
+			unsigned right_count[k_bvh_bins];
+			Aabb acc;
+			unsigned num = 0;
+			for (unsigned b = k_bvh_bins - 1; b > 0; b--) {
+				acc.grow(bins[k][b]);
+				num += counts[k][b];
+				right_area[b] = acc.area();
+				right_count[b] = num;
+			}
+			acc = Aabb();
+			num = 0;
+			for (unsigned b = 1; b < k_bvh_bins; b++) {
+				acc.grow(bins[k][b - 1]);
+				num += counts[k][b - 1];
+				if (num == 0 || right_count[b] == 0) { continue; }
+				const float cost = acc.area() * num +
+								   right_area[b] * right_count[b];
+				if (cost < best_cost) {
+					best_cost = cost;
+					best_axis = k;
+					best_bin = b;
+				}
+			}
+		}
+
+		BuildNode left, right;
+		uint32_t mid;
+		if (best_axis < 0) {
+			if (node.count <= in.max_leaf) { return false; }
+			mid = node.count / 2;
+			left.first = node.first;
+			left.count = mid;
+			left.box = refBounds(in, left);
+			right.first = node.first + mid;
+			right.count = node.count - mid;
+			right.box = refBounds(in, right);
+		}
+		else {
+			const float area = node.box.area();
+			const float leaf_cost = k_intersect_cost * node.count;
+			const float split_cost = (area > 0.f) ?
+				k_traversal_cost + k_intersect_cost * best_cost / area :
+				leaf_cost;
+			if (split_cost >= leaf_cost && node.count <= in.max_leaf) {
+				return false;
+			}
+			mid = (uint32_t)(std::partition(refs, refs + node.count,
+				[&](const uint32_t t) {
+					return binOf(in.centroids + t * 3, best_axis) < best_bin;
+				}) - refs);
+			// child bounds are the union of their bins
+			left.first = node.first;
+			left.count = mid;
+			right.first = node.first + mid;
+			right.count = node.count - mid;
+			for (unsigned bin = 0; bin < k_bvh_bins; bin++) {
+				(bin < best_bin ? left : right).box.grow(bins[best_axis][bin]);
+			}
+		}
+
+		nodes[idx].child[0] = (uint32_t)nodes.size();
+		nodes[idx].child[1] = (uint32_t)nodes.size() + 1;
+		nodes.push_back(left);
+		nodes.push_back(right);
+		return true;
+	}
+
+	/// \brief Split nodes[root] & its descendants down to the leaves. When
+	/// deferred is set, nodes of <= max_count triangles are left unsplit and
+	/// listed in it instead
+	void buildNodes(const BuildInput &in, std::vector<BuildNode> &nodes,
+					const uint32_t root, const size_t max_count,
+					std::vector<uint32_t>* deferred)
+	{
+		std::vector<uint32_t> stack(1, root);
+		while (!stack.empty()) {
+			const uint32_t idx = stack.back();
+			stack.pop_back();
+			if (deferred && nodes[idx].count <= max_count) {
+				deferred->push_back(idx);
+				continue;
+			}
+			if (splitNode(in, nodes, idx)) {
+				stack.push_back(nodes[idx].child[1]);
+				stack.push_back(nodes[idx].child[0]);
+			}
+		}
+	}
+
+	/// \brief Write tree depth first into out.nodes/triangles and fill in
+	/// the bvh's counts & quality
+	void flatten(const std::vector<BuildNode> &tree, const uint32_t* refs,
+				 const uint32_t range_start, BvhBuild &out, DDMBvh &bvh)
+	{
+		bvh.first_node = (uint32_t)out.nodes.size();
+		bvh.first_triangle = (uint32_t)out.triangles.size();
+		const float root_area = tree[0].box.area();
+		const uint32_t k_no_parent = ~0u;
+
+		struct Item
+		{
+			uint32_t node;
+			uint32_t parent;	// flattened node whose offset points here
+			uint32_t depth;
+		};
+		std::vector<Item> stack(1, Item{ 0, k_no_parent, 1 });
+		float cost = 0.f;
+		while (!stack.empty()) {
+			const Item item = stack.back();
+			stack.pop_back();
+			const BuildNode &node = tree[item.node];
+			const uint32_t flat = (uint32_t)out.nodes.size() - bvh.first_node;
+			if (item.parent != k_no_parent) {
+				out.nodes[bvh.first_node + item.parent].offset = flat;
+			}
+
+			DDMBvhNode dst;
+			for (int k = 0; k < 3; k++) {
+				dst.min[k] = node.box.lo[k];
+				dst.max[k] = node.box.hi[k];
+			}
+			if (node.child[0] == 0) {
+				dst.offset = (uint32_t)out.triangles.size() -
+							 bvh.first_triangle;
+				dst.count = node.count;
+				for (uint32_t i = node.first; i < node.first + node.count;
+					 i++) {
+					out.triangles.push_back(refs[i] - range_start);
+				}
+				cost += k_intersect_cost * node.count * node.box.area();
+				bvh.depth = std::max(bvh.depth, item.depth);
+			}
+			else {
+				dst.offset = 0;
+				dst.count = 0;
+				cost += k_traversal_cost * node.box.area();
+				stack.push_back(Item{ node.child[1], flat, item.depth + 1 });
+				stack.push_back(Item{ node.child[0], k_no_parent,
+									  item.depth + 1 });
+			}
+			out.nodes.push_back(dst);
+		}
+		bvh.num_nodes = (uint32_t)out.nodes.size() - bvh.first_node;
+		bvh.num_triangles = (uint32_t)out.triangles.size() -
+							bvh.first_triangle;
+		bvh.sah_cost = (root_area > 0.f) ? cost / root_area :
+										   (float)bvh.num_triangles;
+	}
+}
+
+void BvhBuild::clear()
+{
+	bvhs.clear();
+	nodes.clear();
+	triangles.clear();
+}
+
+void dd_buildBvh(const Vertex* vertices, const vec3_u* triangles,
+				 const unsigned* offsets, const size_t num_ranges,
+				 const unsigned max_leaf, BvhBuild &out,
+				 const unsigned num_threads)
+{
+	out.clear();
+	const unsigned workers = (num_threads == 0) ? dd_hardware_threads() :
+												  num_threads;
+	const size_t start = offsets[0];
+	const size_t end = offsets[num_ranges];
+
+	// triangle bounds & centroids, indexed by triangle #
+	std::vector<Aabb> boxes(end);
+	std::vector<float> centroids(end * 3);
+	dd_parallel_for(end - start, workers,
+		[&](const size_t begin, const size_t last, const unsigned) {
+			for (size_t t = start + begin; t < start + last; t++) {
+				for (int c = 0; c < 3; c++) {
+					boxes[t].grow(vertices[triangles[t].data[c]].position);
+				}
+				for (int k = 0; k < 3; k++) {
+					centroids[t * 3 + k] =
+						(boxes[t].lo[k] + boxes[t].hi[k]) * 0.5f;
+				}
+			}
+		});
+	std::vector<uint32_t> refs(end);
+	std::iota(refs.begin(), refs.end(), 0u);
+
+	BuildInput in;
+	in.boxes = boxes.data();
+	in.centroids = centroids.data();
+	in.refs = refs.data();
+	in.max_leaf = std::max(1u, std::min(max_leaf, k_bvh_max_leaf));
+
+	// split the top of every tree here, until there's enough tasks to
+	// keep the workers busy
+	const size_t task_size = std::max(k_min_task_triangles,
+									  (end - start) / (workers * 8));
+	struct Task
+	{
+		uint32_t range;
+		uint32_t node;
+	};
+	std::vector<std::vector<BuildNode>> trees(num_ranges);
+	std::vector<Task> tasks;
+	std::vector<uint32_t> deferred;
+	for (size_t r = 0; r < num_ranges; r++) {
+		if (offsets[r] == offsets[r + 1]) { continue; }
+		BuildNode root;
+		root.first = offsets[r];
+		root.count = offsets[r + 1] - offsets[r];
+		root.box = refBounds(in, root);
+		trees[r].push_back(root);
+		deferred.clear();
+		buildNodes(in, trees[r], 0, task_size, &deferred);
+		for (const uint32_t node : deferred) {
+			tasks.push_back(Task{ (uint32_t)r, node });
+		}
+	}
+
+	// largest first, so stealing evens out the tail
+	std::sort(tasks.begin(), tasks.end(),
+		[&](const Task &a, const Task &b) {
+			return trees[a.range][a.node].count >
+				   trees[b.range][b.node].count;
+		});
+	std::vector<std::vector<BuildNode>> subtrees(tasks.size());
+	dd_workpool pool((unsigned)std::min<size_t>(workers, tasks.size()));
+	for (size_t i = 0; i < tasks.size(); i++) {
+		pool.push([&, i](const unsigned) {
+			subtrees[i].push_back(trees[tasks[i].range][tasks[i].node]);
+			buildNodes(in, subtrees[i], 0, 0, nullptr);
+		});
+	}
+	pool.run();
+
+	// graft each subtree in place of its task node
+	for (size_t i = 0; i < tasks.size(); i++) {
+		std::vector<BuildNode> &tree = trees[tasks[i].range];
+		const uint32_t base = (uint32_t)tree.size() - 1;
+		for (BuildNode &node : subtrees[i]) {
+			if (node.child[0] != 0) {
+				node.child[0] += base;
+				node.child[1] += base;
+			}
+		}
+		tree[tasks[i].node] = subtrees[i][0];
+		tree.insert(tree.end(), subtrees[i].begin() + 1, subtrees[i].end());
+	}
+
+	out.bvhs.resize(num_ranges);
+	for (size_t r = 0; r < num_ranges; r++) {
+		DDMBvh &bvh = out.bvhs[r];
+		bvh = DDMBvh();
+		bvh.first_node = (uint32_t)out.nodes.size();
+		bvh.first_triangle = (uint32_t)out.triangles.size();
+		if (!trees[r].empty()) {
+			flatten(trees[r], refs.data(), offsets[r], out, bvh);
+		}
+	}
+}
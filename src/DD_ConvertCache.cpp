@@ -0,0 +1,324 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include "DD_ConvertCache.h"
+#include "DD_MappedFile.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+	#include <direct.h>
+	#include <sys/utime.h>
+#else
+	#include <dirent.h>
+	#include <utime.h>
+#endif
+
+namespace
+{
+	const uint64_t k_prime1 = 11400714785074694791ull;
+	const uint64_t k_prime2 = 14029467366897019727ull;
+	const uint64_t k_prime3 = 1609587929392839161ull;
+	const uint64_t k_prime4 = 9650029242287828579ull;
+	const uint64_t k_prime5 = 2870177450012600261ull;
+
+	inline uint64_t rotl(const uint64_t x, const int r)
+	{
+		return (x << r) | (x >> (64 - r));
+	}
+
+	inline uint64_t read64(const unsigned char* p)
+	{
+		uint64_t val;
+		memcpy(&val, p, sizeof(val));
+		return val;
+	}
+
+	inline uint64_t round64(uint64_t acc, const uint64_t input)
+	{
+		acc += input * k_prime2;
+		acc = rotl(acc, 31);
+		return acc * k_prime1;
+	}
+
+	inline uint64_t merge64(uint64_t acc, const uint64_t val)
+	{
+		acc ^= round64(0, val);
+		return acc * k_prime1 + k_prime4;
+	}
+
+	/// \brief Copy file src to dst. Returns bytes copied (0 on failure)
+	uint64_t copyFile(const char* src, const char* dst)
+	{
+		FILE* in = fopen(src, "rb");
+		if (!in) { return 0; }
+		FILE* out = fopen(dst, "wb");
+		if (!out) {
+			fclose(in);
+			return 0;
+		}
+		std::vector<char> buff(1 << 20);
+		uint64_t total = 0;
+		bool ok = true;
+		size_t bytes;
+		while (ok && (bytes = fread(buff.data(), 1, buff.size(), in)) > 0) {
+			ok = fwrite(buff.data(), 1, bytes, out) == bytes;
+			total += bytes;
+		}
+		ok = !ferror(in) && ok;
+		fclose(in);
+		ok = (fclose(out) == 0) && ok;
+		return ok ? total : 0;
+	}
+
+	bool makeDirectory(const char* dir)
+	{
+		struct stat info;
+		if (stat(dir, &info) == 0) { return (info.st_mode & S_IFDIR) != 0; }
+	#ifdef _WIN32
+		return _mkdir(dir) == 0;
+	#else
+		return mkdir(dir, 0755) == 0;
+	#endif
+	}
+
+	/// \brief Parse "<16 hex digits>.ddm"
+	bool parseEntryName(const char* name, uint64_t &key)
+	{
+		if (strlen(name) != 20 || strcmp(name + 16, ".ddm") != 0) {
+			return false;
+		}
+		key = 0;
+		for (int i = 0; i < 16; i++) {
+			const char c = name[i];
+			unsigned digit;
+			if (c >= '0' && c <= '9') { digit = c - '0'; }
+			else if (c >= 'a' && c <= 'f') { digit = c - 'a' + 10; }
+			else { return false; }
+			key = (key << 4) | digit;
+		}
+		return true;
+	}
+}
+
+uint64_t DD_ConvertCache::hash(const void* data, const size_t bytes,
+							   const uint64_t seed)
+{
+	const unsigned char* p = (const unsigned char*)data;
+	const unsigned char* end = p + bytes;
+	uint64_t h;
+
+	if (bytes >= 32) {
+		uint64_t v1 = seed + k_prime1 + k_prime2;
+		uint64_t v2 = seed + k_prime2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - k_prime1;
+		const unsigned char* limit = end - 32;
+		do {
+			v1 = round64(v1, read64(p));
+			v2 = round64(v2, read64(p + 8));
+			v3 = round64(v3, read64(p + 16));
+			v4 = round64(v4, read64(p + 24));
+			p += 32;
+		} while (p <= limit);
+		h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+		h = merge64(h, v1);
+		h = merge64(h, v2);
+		h = merge64(h, v3);
+		h = merge64(h, v4);
+	}
+	else {
+		h = seed + k_prime5;
+	}
+	h += (uint64_t)bytes;
+
+	for (; p + 8 <= end; p += 8) {
+		h ^= round64(0, read64(p));
+		h = rotl(h, 27) * k_prime1 + k_prime4;
+	}
+	if (p + 4 <= end) {
+		uint32_t val;
+		memcpy(&val, p, sizeof(val));
+		h ^= (uint64_t)val * k_prime1;
+		h = rotl(h, 23) * k_prime2 + k_prime3;
+		p += 4;
+	}
+	for (; p < end; p++) {
+		h ^= (*p) * k_prime5;
+		h = rotl(h, 11) * k_prime1;
+	}
+
+	h ^= h >> 33;
+	h *= k_prime2;
+	h ^= h >> 29;
+	h *= k_prime3;
+	h ^= h >> 32;
+	return h;
+}
+
+bool DD_ConvertCache::makeKey(const char* input, const char* options,
+							  uint64_t &key, uint64_t &input_bytes)
+{
+	DD_MappedFile file;
+	if (!file.open(input)) { return false; }
+	const uint64_t seed = hash(options, strlen(options), 0);
+	key = hash(file.begin(), file.size(), seed);
+	input_bytes = file.size();
+	return true;
+}
+
+/// \brief Index the existing cache entries (age ordered by file mtime)
+bool DD_ConvertCache::open(const char* dir, const uint64_t max_bytes)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if (!makeDirectory(dir)) {
+		printf("Cannot create cache directory %s\n", dir);
+		return false;
+	}
+	m_dir = dir;
+	m_max_bytes = max_bytes;
+	m_total = 0;
+	m_clock = 0;
+	m_entries.clear();
+
+	auto addEntry = [&](const char* name) {
+		uint64_t key;
+		struct stat info;
+		if (!parseEntryName(name, key) ||
+			stat((m_dir + "/" + name).c_str(), &info) != 0) {
+			return;
+		}
+		Entry entry;
+		entry.size = (uint64_t)info.st_size;
+		entry.last_use = (uint64_t)info.st_mtime;
+		m_clock = (entry.last_use > m_clock) ? entry.last_use : m_clock;
+		m_total += entry.size;
+		m_entries[key] = entry;
+	};
+
+#ifdef _WIN32
+	WIN32_FIND_DATAA data;
+	HANDLE find = FindFirstFileA((m_dir + "\\*.ddm").c_str(), &data);
+	if (find != INVALID_HANDLE_VALUE) {
+		do { addEntry(data.cFileName); } while (FindNextFileA(find, &data));
+		FindClose(find);
+	}
+#else
+	DIR* handle = opendir(dir);
+	if (handle) {
+		while (dirent* entry = readdir(handle)) { addEntry(entry->d_name); }
+		closedir(handle);
+	}
+#endif
+	evict();
+	return true;
+}
+
+std::string DD_ConvertCache::entryPath(const uint64_t key) const
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016" PRIx64 ".ddm", key);
+	return m_dir + "/" + name;
+}
+
+bool DD_ConvertCache::fetch(const uint64_t key, const uint64_t input_bytes,
+							const char* out_path)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto found = m_entries.find(key);
+	if (found == m_entries.end()) {
+		m_stats.misses++;
+		return false;
+	}
+	const std::string path = entryPath(key);
+	found->second.last_use = ++m_clock;
+	lock.unlock();
+
+	const uint64_t bytes = copyFile(path.c_str(), out_path);
+
+	lock.lock();
+	if (bytes == 0) {
+		// entry vanished or is unreadable, treat as a miss
+		found = m_entries.find(key);
+		if (found != m_entries.end()) {
+			m_total -= found->second.size;
+			m_entries.erase(found);
+		}
+		m_stats.misses++;
+		return false;
+	}
+	utime(path.c_str(), nullptr);	// keep LRU order across runs
+	m_stats.hits++;
+	m_stats.bytes_saved += input_bytes;
+	m_stats.bytes_reused += bytes;
+	return true;
+}
+
+bool DD_ConvertCache::store(const uint64_t key, const char* ddm_path)
+{
+	const std::string path = entryPath(key);
+	// write under a unique temp name, then rename so readers never see a
+	// partial entry
+	char suffix[64];
+	snprintf(suffix, sizeof(suffix), ".%zu.tmp",
+			 std::hash<std::thread::id>()(std::this_thread::get_id()));
+	const std::string tmp = path + suffix;
+
+	const uint64_t bytes = copyFile(ddm_path, tmp.c_str());
+	remove(path.c_str());	// rename won't replace on windows
+	if (bytes == 0 || rename(tmp.c_str(), path.c_str()) != 0) {
+		remove(tmp.c_str());
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+	auto found = m_entries.find(key);
+	if (found != m_entries.end()) { m_total -= found->second.size; }
+	Entry entry;
+	entry.size = bytes;
+	entry.last_use = ++m_clock;
+	m_entries[key] = entry;
+	m_total += bytes;
+	evict();
+	return true;
+}
+
+/// \brief Remove least recently used entries until under m_max_bytes
+/// (m_mutex must be held)
+void DD_ConvertCache::evict()
+{
+	if (m_total <= m_max_bytes) { return; }
+
+	std::vector<std::pair<uint64_t, uint64_t>> by_age;	// (last_use, key)
+	by_age.reserve(m_entries.size());
+	for (const auto &entry : m_entries) {
+		by_age.push_back(std::make_pair(entry.second.last_use, entry.first));
+	}
+	std::sort(by_age.begin(), by_age.end());
+
+	for (size_t i = 0; i < by_age.size() && m_total > m_max_bytes; i++) {
+		auto oldest = m_entries.find(by_age[i].second);
+		remove(entryPath(oldest->first).c_str());
+		m_total -= oldest->second.size;
+		m_stats.evictions++;
+		m_stats.bytes_evicted += oldest->second.size;
+		m_entries.erase(oldest);
+	}
+}
+
+ConvertCacheStats DD_ConvertCache::stats() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_stats;
+}
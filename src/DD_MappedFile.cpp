@@ -0,0 +1,154 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include "DD_MappedFile.h"
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+namespace
+{
+	// returned for empty files so begin()/end() are always dereferenceable
+	const char empty_file[1] = { '\0' };
+}
+
+/// \brief Map file into memory. The mapping is only used if the OS guarantees
+/// a zero byte after the last byte of the file (i.e. the file does not end on
+/// a page boundary); otherwise the file is read into a padded heap buffer
+bool DD_MappedFile::open(const char* filename)
+{
+	close();
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+							  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER f_size;
+	SYSTEM_INFO sys_info;
+	GetSystemInfo(&sys_info);
+	if (!GetFileSizeEx(file, &f_size)) {
+		CloseHandle(file);
+		return false;
+	}
+	m_size = (size_t)f_size.QuadPart;
+	if (m_size == 0) {
+		CloseHandle(file);
+		m_data = empty_file;
+		return true;
+	}
+	if (m_size % sys_info.dwPageSize != 0) {
+		HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0,
+											NULL);
+		if (mapping != NULL) {
+			void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+			if (view != NULL) {
+				m_file = file;
+				m_mapping = mapping;
+				m_data = (const char*)view;
+				m_mapped = true;
+				return true;
+			}
+			CloseHandle(mapping);
+		}
+	}
+	CloseHandle(file);
+#else
+	int fd = ::open(filename, O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat f_stat;
+	if (fstat(fd, &f_stat) != 0 || !S_ISREG(f_stat.st_mode)) {
+		::close(fd);
+		return false;
+	}
+	m_size = (size_t)f_stat.st_size;
+	if (m_size == 0) {
+		::close(fd);
+		m_data = empty_file;
+		return true;
+	}
+	const size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	if (m_size % page_size != 0) {
+		void* view = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (view != MAP_FAILED) {
+		#ifdef MADV_SEQUENTIAL
+			madvise(view, m_size, MADV_SEQUENTIAL);
+		#endif
+			::close(fd); // mapping stays valid after close
+			m_data = (const char*)view;
+			m_mapped = true;
+			return true;
+		}
+	}
+	::close(fd);
+#endif
+	return readToHeap(filename);
+}
+
+/// \brief Fallback for files that can't be mapped (or end on a page boundary)
+bool DD_MappedFile::readToHeap(const char* filename)
+{
+	FILE* file = fopen(filename, "rb");
+	if (!file) {
+		m_size = 0;
+		return false;
+	}
+	m_heap = (char*)malloc(m_size + 1);
+	if (!m_heap) {
+		fclose(file);
+		m_size = 0;
+		return false;
+	}
+	const size_t bytes = fread(m_heap, 1, m_size, file);
+	fclose(file);
+	m_size = bytes;
+	m_heap[m_size] = '\0';
+	m_data = m_heap;
+	return true;
+}
+
+void DD_MappedFile::prefetch(const size_t offset, const size_t len) const
+{
+	if (!m_mapped || offset >= m_size || len == 0) { return; }
+	const size_t end = (len < m_size - offset) ? offset + len : m_size;
+	const size_t k_page = 4096;	// smallest page size in use
+	volatile char sink = 0;
+	for (size_t i = offset; i < end; i += k_page) { sink = m_data[i]; }
+	sink = m_data[end - 1];
+	(void)sink;
+}
+
+void DD_MappedFile::close()
+{
+	if (m_mapped) {
+	#ifdef _WIN32
+		UnmapViewOfFile(m_data);
+		CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		m_mapping = nullptr;
+		m_file = nullptr;
+	#else
+		munmap((void*)m_data, m_size);
+	#endif
+	}
+	if (m_heap) {
+		free(m_heap);
+		m_heap = nullptr;
+	}
+	m_data = nullptr;
+	m_size = 0;
+	m_mapped = false;
+}
@@ -0,0 +1,207 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include "DD_MeshOptimize.h"
+#include <vector>
+
+namespace
+{
+	const unsigned k_no_vertex = (unsigned)-1;
+
+	/// \brief Tipsify working state for one range (local vertex ids)
+	struct TipsifyState
+	{
+		std::vector<unsigned>	adj_start;	// vertex -> first adj entry
+		std::vector<unsigned>	adj;		// triangles using each vertex
+		std::vector<unsigned>	live;		// unemitted triangles per vertex
+		std::vector<unsigned>	cache_time;
+		std::vector<uint8_t>	emitted;
+		std::vector<unsigned>	dead_end;
+		std::vector<unsigned>	candidates;
+	};
+}
+
+VertexCacheStats dd_analyzeVertexCache(const vec3_u* triangles,
+									   const unsigned* offsets,
+									   const size_t num_ranges,
+									   const size_t num_vertices,
+									   const unsigned cache_size)
+{
+	VertexCacheStats stats;
+	// v is cached while fewer than cache_size misses happened since its own
+	std::vector<uint64_t> inserted_at(num_vertices, 0);
+	std::vector<unsigned> seen_in(num_vertices, k_no_vertex);
+	uint64_t misses = cache_size;
+
+	for (size_t r = 0; r < num_ranges; r++) {
+		misses += cache_size;	// draw calls start w/ an empty cache
+		for (unsigned t = offsets[r]; t < offsets[r + 1]; t++) {
+			for (int c = 0; c < 3; c++) {
+				const unsigned v = triangles[t].data[c];
+				if (seen_in[v] != (unsigned)r) {
+					seen_in[v] = (unsigned)r;
+					stats.vertices++;
+				}
+				if (misses - inserted_at[v] >= cache_size) {
+					inserted_at[v] = ++misses;
+					stats.transforms++;
+				}
+			}
+		}
+		stats.triangles += offsets[r + 1] - offsets[r];
+	}
+	return stats;
+}
+
+void dd_optimizeVertexCache(vec3_u* triangles, const unsigned* offsets,
+							const size_t num_ranges, const size_t num_vertices,
+							const unsigned cache_size)
+{
+	std::vector<unsigned> to_local(num_vertices, k_no_vertex);
+	std::vector<unsigned> to_global;
+	std::vector<unsigned> local_tris;
+	std::vector<vec3_u> reordered;
+	TipsifyState st;
+
+	for (size_t r = 0; r < num_ranges; r++) {
+		vec3_u* tris = triangles + offsets[r];
+		const unsigned num_tris = offsets[r + 1] - offsets[r];
+		if (num_tris < 2) { continue; }
+
+		// compact vertex ids (in order of first use) so the working arrays
+		// are sized by the range, not the whole vertex buffer
+		to_global.clear();
+		local_tris.resize(num_tris * 3);
+		for (unsigned t = 0; t < num_tris; t++) {
+			for (int c = 0; c < 3; c++) {
+				const unsigned v = tris[t].data[c];
+				if (to_local[v] == k_no_vertex) {
+					to_local[v] = (unsigned)to_global.size();
+					to_global.push_back(v);
+				}
+				local_tris[t * 3 + c] = to_local[v];
+			}
+		}
+		const unsigned num_verts = (unsigned)to_global.size();
+		for (const unsigned v : to_global) { to_local[v] = k_no_vertex; }
+
+		// vertex -> triangle adjacency
+		st.live.assign(num_verts, 0);
+		for (const unsigned v : local_tris) { st.live[v]++; }
+		st.adj_start.resize(num_verts + 1);
+		st.adj_start[0] = 0;
+		for (unsigned v = 0; v < num_verts; v++) {
+			st.adj_start[v + 1] = st.adj_start[v] + st.live[v];
+		}
+		st.adj.resize(num_tris * 3);
+		st.cache_time.assign(num_verts, 0);	// reused as fill cursor
+		for (unsigned t = 0; t < num_tris; t++) {
+			for (int c = 0; c < 3; c++) {
+				const unsigned v = local_tris[t * 3 + c];
+				st.adj[st.adj_start[v] + st.cache_time[v]++] = t;
+			}
+		}
+
+		st.cache_time.assign(num_verts, 0);
+		st.emitted.assign(num_tris, 0);
+		st.dead_end.clear();
+		reordered.clear();
+
+		unsigned stamp = cache_size + 1;
+		unsigned cursor = 0;		// next vertex for the dead-end scan
+		unsigned fan = 0;
+		while (fan != k_no_vertex) {
+			// emit every remaining triangle around the fanning vertex
+			st.candidates.clear();
+			for (unsigned a = st.adj_start[fan]; a < st.adj_start[fan + 1];
+				 a++) {
+				const unsigned t = st.adj[a];
+				if (st.emitted[t]) { continue; }
+				st.emitted[t] = 1;
+				reordered.push_back(tris[t]);
+				for (int c = 0; c < 3; c++) {
+					const unsigned v = local_tris[t * 3 + c];
+					st.dead_end.push_back(v);
+					st.candidates.push_back(v);
+					st.live[v]--;
+					if (stamp - st.cache_time[v] > cache_size) {
+						st.cache_time[v] = stamp++;
+					}
+				}
+			}
+
+			// next fan: the candidate that stays cached the longest while
+			// its remaining triangles are emitted
+			fan = k_no_vertex;
+			int best = -1;
+			for (const unsigned v : st.candidates) {
+				if (st.live[v] == 0) { continue; }
+				int priority = 0;
+				const unsigned age = stamp - st.cache_time[v];
+				if (age + 2 * st.live[v] <= cache_size) { priority = age; }
+				if (priority > best) {
+					best = priority;
+					fan = v;
+				}
+			}
+
+			// dead end: back up to a recently used vertex, else scan input
+			// order for any vertex w/ triangles left
+			while (fan == k_no_vertex && !st.dead_end.empty()) {
+				const unsigned v = st.dead_end.back();
+				st.dead_end.pop_back();
+				if (st.live[v] > 0) { fan = v; }
+			}
+			while (fan == k_no_vertex && cursor < num_verts) {
+				if (st.live[cursor] > 0) { fan = cursor; }
+				cursor++;
+			}
+		}
+
+		for (unsigned t = 0; t < num_tris; t++) { tris[t] = reordered[t]; }
+	}
+}
+
+size_t dd_optimizeVertexFetch(vec3_u* triangles, const size_t num_triangles,
+							  const unsigned* offsets, const size_t num_ranges,
+							  const size_t num_vertices,
+							  std::vector<unsigned> &source)
+{
+	source.clear();
+	source.reserve(num_vertices);
+	std::vector<unsigned> new_index(num_vertices, k_no_vertex);
+	std::vector<unsigned> used_in(num_vertices, k_no_vertex);
+	size_t duplicates = 0;
+
+	/// \brief Lambda to renumber triangles [begin, end) of one group
+	auto remapRange = [&](const size_t begin, const size_t end,
+						  const unsigned group) {
+		for (size_t t = begin; t < end; t++) {
+			for (int c = 0; c < 3; c++) {
+				unsigned &v = triangles[t].data[c];
+				if (used_in[v] != group) {
+					// first use in this group: new copy at the end
+					duplicates += (used_in[v] != k_no_vertex) ? 1 : 0;
+					used_in[v] = group;
+					new_index[v] = (unsigned)source.size();
+					source.push_back(v);
+				}
+				v = new_index[v];
+			}
+		}
+	};
+
+	if (num_ranges == 0) {
+		remapRange(0, num_triangles, 0);
+		return duplicates;
+	}
+	for (size_t r = 0; r < num_ranges; r++) {
+		remapRange(offsets[r], offsets[r + 1], (unsigned)r);
+	}
+	// left over triangles share one group
+	const unsigned rest = (unsigned)num_ranges;
+	remapRange(0, offsets[0], rest);
+	remapRange(offsets[num_ranges], num_triangles, rest);
+	return duplicates;
+}
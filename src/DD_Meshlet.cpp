@@ -0,0 +1,217 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include "DD_Meshlet.h"
+#include "DD_Parallel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	/// \brief Cones whose normals spread past ~84 degrees from the axis
+	/// can't reject anything useful, so they're stored as never culled
+	const float k_min_cone_dot = 0.1f;
+
+	/// \brief Fill in the sphere & normal cone of m from its vertices and
+	/// triangles
+	void meshletBounds(const Vertex* vertices, const uint32_t* ids,
+					   const uint8_t* tris, DDMMeshlet &m)
+	{
+		// sphere: bounding box center to the farthest vertex
+		float lo[3], hi[3];
+		for (int k = 0; k < 3; k++) {
+			lo[k] = hi[k] = vertices[ids[0]].position[k];
+		}
+		for (uint32_t i = 1; i < m.num_vertices; i++) {
+			const float* p = vertices[ids[i]].position;
+			for (int k = 0; k < 3; k++) {
+				lo[k] = std::min(lo[k], p[k]);
+				hi[k] = std::max(hi[k], p[k]);
+			}
+		}
+		float radius2 = 0.f;
+		for (int k = 0; k < 3; k++) { m.center[k] = (lo[k] + hi[k]) * 0.5f; }
+		for (uint32_t i = 0; i < m.num_vertices; i++) {
+			const float* p = vertices[ids[i]].position;
+			const float d[3] = { p[0] - m.center[0], p[1] - m.center[1],
+								 p[2] - m.center[2] };
+			radius2 = std::max(radius2, d[0] * d[0] + d[1] * d[1] +
+										d[2] * d[2]);
+		}
+		m.radius = std::sqrt(radius2);
+
+		// cone: axis = average triangle normal, cutoff from the normal
+		// farthest from it
+		float normals[k_meshlet_max_triangles][3];
+		const float* corner0[k_meshlet_max_triangles];
+		unsigned num_normals = 0;
+		float axis[3] = { 0.f, 0.f, 0.f };
+		for (uint32_t t = 0; t < m.num_triangles; t++) {
+			const float* p0 = vertices[ids[tris[t * 3 + 0]]].position;
+			const float* p1 = vertices[ids[tris[t * 3 + 1]]].position;
+			const float* p2 = vertices[ids[tris[t * 3 + 2]]].position;
+			const float e1[3] = { p1[0] - p0[0], p1[1] - p0[1],
+								  p1[2] - p0[2] };
+			const float e2[3] = { p2[0] - p0[0], p2[1] - p0[1],
+								  p2[2] - p0[2] };
+			float* n = normals[num_normals];
+			n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+			n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+			n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+			const float len = std::sqrt(n[0] * n[0] + n[1] * n[1] +
+										n[2] * n[2]);
+			if (!(len > 0.f)) { continue; }	// degenerate
+			for (int k = 0; k < 3; k++) {
+				n[k] /= len;
+				axis[k] += n[k];
+			}
+			corner0[num_normals++] = p0;
+		}
+
+		// default: never backfacing
+		memcpy(m.cone_apex, m.center, sizeof(m.cone_apex));
+		memset(m.cone_axis, 0, sizeof(m.cone_axis));
+		m.cone_cutoff = 1.f;
+
+		const float len = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] +
+									axis[2] * axis[2]);
+		if (!(len > 0.f)) { return; }
+		for (int k = 0; k < 3; k++) {
+			axis[k] /= len;
+			m.cone_axis[k] = axis[k];
+		}
+
+		float min_dot = 1.f;
+		for (unsigned i = 0; i < num_normals; i++) {
+			const float* n = normals[i];
+			min_dot = std::min(min_dot, n[0] * axis[0] + n[1] * axis[1] +
+										n[2] * axis[2]);
+		}
+		if (min_dot <= k_min_cone_dot) { return; }
+
+		// apex: moved back along the axis until every triangle plane is in
+		// front of it
+		float max_t = 0.f;
+		for (unsigned i = 0; i < num_normals; i++) {
+			const float* n = normals[i];
+			const float* p = corner0[i];
+			const float dc = (m.center[0] - p[0]) * n[0] +
+							 (m.center[1] - p[1]) * n[1] +
+							 (m.center[2] - p[2]) * n[2];
+			const float dn = n[0] * axis[0] + n[1] * axis[1] + n[2] * axis[2];
+			max_t = std::max(max_t, dc / dn);
+		}
+		for (int k = 0; k < 3; k++) {
+			m.cone_apex[k] = m.center[k] - axis[k] * max_t;
+		}
+		m.cone_cutoff = std::sqrt(1.f - min_dot * min_dot);
+	}
+
+	/// \brief Greedily split one range into meshlets. local maps a global
+	/// vertex to its slot in the current meshlet (-1 = not in it) and is
+	/// left all -1
+	void buildRange(const Vertex* vertices, const vec3_u* tris,
+					const size_t num_tris, const uint32_t ebo,
+					const MeshletLimits &limits, std::vector<int> &local,
+					MeshletBuild &out)
+	{
+		DDMMeshlet m;
+
+		/// \brief Lambda to start an empty meshlet at the end of out
+		auto start = [&]() {
+			memset(&m, 0, sizeof(DDMMeshlet));
+			m.first_vertex = (uint32_t)out.vertices.size();
+			m.first_triangle = (uint32_t)(out.triangles.size() / 3);
+			m.ebo = ebo;
+		};
+		/// \brief Lambda to close the current meshlet
+		auto finish = [&]() {
+			const uint32_t* ids = out.vertices.data() + m.first_vertex;
+			meshletBounds(vertices, ids,
+						  out.triangles.data() + m.first_triangle * 3, m);
+			for (uint32_t i = 0; i < m.num_vertices; i++) {
+				local[ids[i]] = -1;
+			}
+			out.meshlets.push_back(m);
+			start();
+		};
+
+		start();
+		for (size_t t = 0; t < num_tris; t++) {
+			const unsigned* v = tris[t].data;
+			const unsigned added = (local[v[0]] < 0 ? 1 : 0) +
+				(local[v[1]] < 0 && v[1] != v[0] ? 1 : 0) +
+				(local[v[2]] < 0 && v[2] != v[0] && v[2] != v[1] ? 1 : 0);
+			if (m.num_vertices + added > limits.max_vertices ||
+				m.num_triangles + 1 > limits.max_triangles) {
+				finish();
+			}
+			for (int c = 0; c < 3; c++) {
+				if (local[v[c]] < 0) {
+					local[v[c]] = (int)m.num_vertices++;
+					out.vertices.push_back(v[c]);
+				}
+				out.triangles.push_back((uint8_t)local[v[c]]);
+			}
+			m.num_triangles++;
+		}
+		if (m.num_triangles > 0) { finish(); }
+	}
+}
+
+void MeshletBuild::clear()
+{
+	meshlets.clear();
+	vertices.clear();
+	triangles.clear();
+}
+
+void dd_buildMeshlets(const Vertex* vertices, const size_t num_vertices,
+					  const vec3_u* triangles, const unsigned* offsets,
+					  const size_t num_ranges, const MeshletLimits &limits,
+					  MeshletBuild &out, const unsigned num_threads)
+{
+	out.clear();
+	MeshletLimits clamped = limits;
+	clamped.max_vertices = std::max(3u, std::min(clamped.max_vertices,
+												 k_meshlet_max_vertices));
+	clamped.max_triangles = std::max(1u, std::min(clamped.max_triangles,
+												  k_meshlet_max_triangles));
+
+	std::vector<MeshletBuild> parts(num_ranges);
+	dd_parallel_for(num_ranges, num_threads,
+		[&](const size_t begin, const size_t end, const unsigned) {
+			std::vector<int> local(num_vertices, -1);
+			for (size_t r = begin; r < end; r++) {
+				buildRange(vertices, triangles + offsets[r],
+						   offsets[r + 1] - offsets[r], (uint32_t)r,
+						   clamped, local, parts[r]);
+			}
+		});
+
+	// concatenate in range order
+	size_t num_meshlets = 0, num_ids = 0, num_bytes = 0;
+	for (const MeshletBuild &part : parts) {
+		num_meshlets += part.meshlets.size();
+		num_ids += part.vertices.size();
+		num_bytes += part.triangles.size();
+	}
+	out.meshlets.reserve(num_meshlets);
+	out.vertices.reserve(num_ids);
+	out.triangles.reserve(num_bytes);
+	for (const MeshletBuild &part : parts) {
+		const uint32_t first_vertex = (uint32_t)out.vertices.size();
+		const uint32_t first_triangle = (uint32_t)(out.triangles.size() / 3);
+		for (DDMMeshlet m : part.meshlets) {
+			m.first_vertex += first_vertex;
+			m.first_triangle += first_triangle;
+			out.meshlets.push_back(m);
+		}
+		out.vertices.insert(out.vertices.end(), part.vertices.begin(),
+							part.vertices.end());
+		out.triangles.insert(out.triangles.end(), part.triangles.begin(),
+							 part.triangles.end());
+	}
+}
@@ -3,132 +3,381 @@
 * All rights reserved.
 */
 #include "DD_ObjConverter.h"
-#include <fstream>
+#include "DD_IndexCodec.h"
+#include "DD_MappedFile.h"
+#include "DD_MeshFormat.h"
+#include "DD_Normals.h"
+#include "DD_NumParse.h"
+#include "DD_Parallel.h"
+#include "DD_Pipeline.h"
+#include "DD_ProcessMemory.h"
+#include "DD_Tangents.h"
+#include "DD_TextWriter.h"
+#include "DD_VertexQuantize.h"
+#include "DD_VertexStreams.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
 #include <vector>
-#include <map>
 
 namespace
 {
-	std::vector<vec3_f>		vert;
-	std::vector<vec3_f>		norm;
-	std::vector<vec3_f>		tang;
-	std::vector<vec3_f>		uv;
-	std::vector<Vertex>		vertices;
-	std::vector<vec3_u>		indices;
-	std::vector<unsigned>	mesh_offset;
-	std::map<cbuff<16>, unsigned> meshbin;
-	cbuff<16> 				vertex_id;
-	cbuff<32>				obj_id;
-
-	bool v_vt_vn[] = { false, false, false };
-
-	unsigned unique_v = 0;
-	unsigned copied_v = 0;
+	/// \brief Attribute index of a corner whose token has none ("v//vn")
+	const unsigned k_no_index = 0xFFFFFFFFu;
+	/// \brief Index that refers to no record (0, too far back, not a number)
+	const unsigned k_bad_index = 0xFFFFFFFEu;
+
+	/// \brief Face corner as parsed from a face token: 0-based v/vt/vn
+	/// indices, k_no_index for attributes the token doesn't have
+	struct ObjCorner
+	{
+		unsigned idx[3];
+	};
+
+	/// \brief # of v/vt/vn records before a face (relative indices count
+	/// back from these)
+	struct ObjRecordCounts
+	{
+		unsigned v;
+		unsigned vt;
+		unsigned vn;
+	};
+
+	/// \brief Corner token forms. Every corner of a face has the same one,
+	/// faces of a file can differ
+	enum class ObjFaceLayout
+	{
+		V,			// "v"
+		V_VT,		// "v/vt"
+		V_VN,		// "v//vn"
+		V_VT_VN		// "v/vt/vn"
+	};
+
+	inline bool isSpace(const char c)
+	{
+		return c == ' ' || c == '\t' || c == '\r';
+	}
+
+	/// \brief Move str past leading whitespace
+	inline void skipSpace(const char *&str, const char *end)
+	{
+		while (str < end && isSpace(*str)) { str++; }
+	}
+
+	/// \brief Move str to the end of the current token
+	inline void skipToken(const char *&str, const char *end)
+	{
+		while (str < end && !isSpace(*str)) { str++; }
+	}
+
+	/// \brief Layout of a face from its first corner token
+	inline ObjFaceLayout faceLayout(const char *token, const char *end)
+	{
+		unsigned slashes = 0;
+		bool empty_vt = false;
+		for (const char *str = token; str < end && !isSpace(*str); str++) {
+			if (*str == '/') {
+				empty_vt |= slashes == 0 && str + 1 < end && str[1] == '/';
+				slashes++;
+			}
+		}
+		if (slashes == 0) { return ObjFaceLayout::V; }
+		if (empty_vt) { return ObjFaceLayout::V_VN; }
+		return (slashes == 1) ? ObjFaceLayout::V_VT : ObjFaceLayout::V_VT_VN;
+	}
+
+	/// \brief 1-based or relative (negative: count back from the records
+	/// read so far) obj index as 0-based. k_bad_index if it refers to no
+	/// record
+	inline unsigned parseIndex(const char *&str, const char *end,
+							   const unsigned count)
+	{
+		int64_t idx = 0;
+		if (!dd_parseInt(str, end, idx)) { return k_bad_index; }
+		if (idx > 0) {
+			return (idx < (int64_t)k_bad_index) ? (unsigned)(idx - 1) :
+												  k_bad_index;
+		}
+		return (idx < 0 && -idx <= (int64_t)count) ?
+			(unsigned)(count + idx) : k_bad_index;
+	}
+
+	/// \brief Parses the corners of faces in one layout. The layout is a
+	/// template parameter, so the corner loop has no format branches
+	template <ObjFaceLayout L>
+	struct ObjFaceParser
+	{
+		static const bool k_vt = L == ObjFaceLayout::V_VT ||
+								 L == ObjFaceLayout::V_VT_VN;
+		static const bool k_vn = L == ObjFaceLayout::V_VN ||
+								 L == ObjFaceLayout::V_VT_VN;
+
+		/// \brief Corner tokens of [str, end) into corners, returns their #.
+		/// Token text past the layout's indices is ignored
+		static unsigned parse(const char *str, const char *end,
+							  const ObjRecordCounts &counts,
+							  ObjCorner *corners)
+		{
+			unsigned count = 0;
+			skipSpace(str, end);
+			while (str < end) {
+				ObjCorner &corner = corners[count++];
+				corner.idx[0] = parseIndex(str, end, counts.v);
+				corner.idx[1] = k_no_index;
+				corner.idx[2] = k_no_index;
+				if (k_vt) {
+					str += (str < end && *str == '/') ? 1 : 0;
+					corner.idx[1] = parseIndex(str, end, counts.vt);
+				}
+				if (k_vn) {
+					// "//" when there is no vt
+					str += (str < end && *str == '/') ? 1 : 0;
+					str += (!k_vt && str < end && *str == '/') ? 1 : 0;
+					corner.idx[2] = parseIndex(str, end, counts.vn);
+				}
+				skipToken(str, end);
+				skipSpace(str, end);
+			}
+			return count;
+		}
+	};
+
+	/// \brief Parse a face line's corners w/ the parser of its layout
+	inline unsigned parseFace(const char *str, const char *end,
+							  const ObjRecordCounts &counts,
+							  ObjCorner *corners)
+	{
+		skipSpace(str, end);
+		switch (faceLayout(str, end)) {
+			case ObjFaceLayout::V:
+				return ObjFaceParser<ObjFaceLayout::V>::parse(
+					str, end, counts, corners);
+			case ObjFaceLayout::V_VT:
+				return ObjFaceParser<ObjFaceLayout::V_VT>::parse(
+					str, end, counts, corners);
+			case ObjFaceLayout::V_VN:
+				return ObjFaceParser<ObjFaceLayout::V_VN>::parse(
+					str, end, counts, corners);
+			case ObjFaceLayout::V_VT_VN:
+				return ObjFaceParser<ObjFaceLayout::V_VT_VN>::parse(
+					str, end, counts, corners);
+		}
+		return 0;
+	}
+
+	/// \brief Obj line types the parser handles
+	enum class ObjRecord
+	{
+		V,
+		VT,
+		VN,
+		F,
+		USEMTL,
+		OTHER
+	};
+
+	/// \brief Type of a line (len excludes the '\n')
+	inline ObjRecord recordType(const char* line, const size_t len)
+	{
+		if (len < 2) { return ObjRecord::OTHER; }
+		if (line[0] == 'v') {
+			return (line[1] == ' ') ? ObjRecord::V :
+				   (line[1] == 'n') ? ObjRecord::VN :
+				   (line[1] == 't') ? ObjRecord::VT : ObjRecord::OTHER;
+		}
+		if (line[0] == 'u' && line[1] == 's') { return ObjRecord::USEMTL; }
+		if (line[0] == 'f' && line[1] == ' ') { return ObjRecord::F; }
+		return ObjRecord::OTHER;
+	}
+
+	/// \brief One newline-aligned block of the obj file. The pre-scan
+	/// counts its records, then it is parsed straight into the merged
+	/// attribute streams & arena buffers sized from those counts
+	struct ObjChunk
+	{
+		const char*		begin = nullptr;
+		const char*		end = nullptr;
+		// pre-scan
+		ObjLineCounts	lines;
+		size_t			num_corners = 0;
+		size_t			num_triangles = 0;	// after fan triangulation
+		size_t			num_polygons = 0;	// faces w/ more than 3 corners
+		// parse output: first v/vn/vt in the merged streams & arena arrays
+		// (corners & face_size are slices of arrays for the whole file)
+		size_t			first_vert = 0;
+		size_t			first_norm = 0;
+		size_t			first_uv = 0;
+		ObjCorner*		corners = nullptr;
+		unsigned*		face_size = nullptr;	// corners per face
+		unsigned*		mesh_start = nullptr;	// face # of each usemtl
+		size_t			num_unlit = 0;			// faces w/o vn
+	};
+
+	/// \brief Smallest block of the file handed to a parse thread
+	const size_t k_min_chunk_bytes = 256 * 1024;
+	/// \brief Chunk size of a pipelined import: small enough that the
+	/// stages start on a chunk while the next ones are still being read
+	const size_t k_pipeline_chunk_bytes = 1024 * 1024;
 }
 
-/// \brief Read in obj file and parse to get MeshContainer
-ObjImportStatus DD_ObjConverter::importOBJ(const char* filename)
+/// \brief Clear mesh data from the last import. Buffers keep their capacity
+/// so converting another file of similar size doesn't reallocate
+void DD_ObjConverter::reset()
 {
 	vert.clear();
 	norm.clear();
 	uv.clear();
-	vertices.clear();
-	indices.clear();
+	mesh.data.clear();
+	mesh.streams.position.clear();
+	mesh.streams.normal.clear();
+	mesh.streams.texcoord.clear();
+	mesh.streams.tangent.clear();
+	mesh.indices.clear();
+	mesh.mesh_idx.resize(0, 2);
+	mesh.bbox_min = vec3_f();
+	mesh.bbox_max = vec3_f();
+	mesh_offset.clear();
+	lod_indices.clear();
+	lod_offset.clear();
+	lod_error.clear();
+	meshlets.clear();
+	bvh.clear();
 	meshbin.clear();
-	tang.clear();
 	unique_v = 0;
 	copied_v = 0;
+	duplicated_v = 0;
+	bytes_read = 0;
+	import_ms = 0.0;
+	normal_ms = 0.0;
+	generated_normals = 0;
+	tangent_ms = 0.0;
+	optimize_ms = 0.0;
+	lod_ms = 0.0;
+	meshlet_ms = 0.0;
+	bvh_ms = 0.0;
+	export_ms = 0.0;
+	bytes_written = 0;
+	index_bytes = 0;
+	vertex_stride = 0;
+	arena_bytes = 0;
+	peak_rss = 0;
+	quantize_error = QuantizeError();
+	parse_threads = 1;
+	parse_chunks = 1;
+	cache_before = VertexCacheStats();
+	cache_after = VertexCacheStats();
+	profile = ObjConvertProfile();
 	obj_id.set("static_mesh");
+}
 
-	/// \brief Lambda to move c string past next space
-	auto skipPastDelim = [&](char *&str, const char delim = ' ')
-	{
-		while (*str != delim && *str) { str++; } str++;
-	};
+/// \brief Clear mesh data and free all buffers
+void DD_ObjConverter::releaseMemory()
+{
+	reset();
+	vert.release();
+	norm.release();
+	uv.release();
+	mesh = MeshContainer();
+	std::vector<unsigned>().swap(mesh_offset);
+	std::vector<vec3_u>().swap(lod_indices);
+	std::vector<unsigned>().swap(lod_offset);
+	meshlets = MeshletBuild();
+	bvh = BvhBuild();
+	meshbin = dd_indexmap();
+	arena.release();
+}
 
-	/// \brief Lambda to get line id from obj file
-	auto getLineId = [&](char *str, char *buff, const unsigned count)
-	{
-		for(unsigned i = 0; i < count; ++i) {
-			buff[i] = str[i];
-		}
-		buff[count] = '\0';
-	};
+/// \brief Read in obj file and parse to get MeshContainer. The file is split
+/// into newline-aligned chunks that are parsed on num_threads threads; the
+/// records are then merged in file order so output matches a serial parse.
+/// With options.pipeline the read, scan, parse & dedup of chunks overlap
+ObjImportStatus DD_ObjConverter::importOBJ(const char* filename,
+										   const unsigned num_threads)
+{
+	reset();
 
-	/// \brief Lambda to get vec3_f from c string
-	auto getVec3 = [&](char *str, const unsigned count)
+	const auto import_start = std::chrono::high_resolution_clock::now();
+
+	/// \brief Lambda to get vec3_f from c string (line w/ identifier)
+	auto getVec3 = [&](const char *str, const char *end, const unsigned count)
 	{
-		vec3_f output;
-		char buff[32];
-		uint8_t idx = 0;
+		vec3_f output = vec3_f();
 
-		skipPastDelim(str); // skip identifier
+		skipToken(str, end); // skip identifier
 		for(unsigned i = 0; i < count && i < 4; i++) {
-			idx = 0;
-		    while (*str != ' ' && *str) {
-				buff[idx] = *str;
-				idx++; str++;
-			}
-			buff[idx] = '\0';
-			skipPastDelim(str);
-			output.data[i] = std::strtod(buff, nullptr);
+			skipSpace(str, end);
+			if (str == end) { break; }
+			output.data[i] = dd_parseFloat(str, end);
+			skipToken(str, end);
 		}
 		return output;
 	};
 
-	/// \brief Lambda to translate face index string to vec3_u
-	auto faceToVec3 = [&](char* str)
-	{
-		vec3_u out;
-		unsigned start = 0;
-		// replace all '/' with ' '
-		while (*str) { *str = (*str == '/') ? ' ' : *str; str++; start++; }
-		str -= start; // set string back to [0] index
-		char *nxt;
-		out.x() = std::strtoul(str, &nxt, 10) - 1; nxt++;
-		out.y() = std::strtoul(nxt, &nxt, 10) - 1; nxt++;
-		out.z() = std::strtoul(nxt, nullptr, 10) - 1;
-
-		return out;
-	};
+	// v/vt/vn records parsed so far. A pipelined parse runs alongside the
+	// dedup: a corner that refers ahead (obj allows forward indices) waits
+	// for parseMore() to hand over the next chunk
+	size_t parsed_vert = SIZE_MAX, parsed_uv = SIZE_MAX, parsed_norm = SIZE_MAX;
+	std::function<void()> parseMore;
 
-	/// \brief Lambda to get Vertex object from c string
-	auto getVertex = [&](char *&str)
+	/// \brief Lambda to get Vertex object from parsed face corner. Sets
+	/// bad_index (w/o adding a key) if the corner refers to a record the
+	/// file doesn't have
+	bool bad_index = false;
+	auto getVertex = [&](const ObjCorner &corner)
 	{
-		Vertex output;
-		char buff[64];
-		uint8_t idx = 0;
-		if (*str == ' ') { str++; } // remove space at head
-
-		while (*str != ' ' && *str) {
-			buff[idx] = *str;
-			idx++; str++;
+		const unsigned *info_idx = corner.idx;
+		// vt & vn are optional (left 0)
+		const bool has_uv = info_idx[1] != k_no_index;
+		const bool has_norm = info_idx[2] != k_no_index;
+		while ((info_idx[0] >= parsed_vert && info_idx[0] < vert.size()) ||
+			   (has_uv && info_idx[1] >= parsed_uv &&
+				info_idx[1] < uv.size()) ||
+			   (has_norm && info_idx[2] >= parsed_norm &&
+				info_idx[2] < norm.size())) {
+			parseMore();
+		}
+		if (info_idx[0] >= vert.size() ||
+			(has_uv && info_idx[1] >= uv.size()) ||
+			(has_norm && info_idx[2] >= norm.size())) {
+			bad_index = true;
+			return 0u;
 		}
-		buff[idx] = '\0';
-		vec3_u info_idx = faceToVec3(buff);
-		vertex_id.set(buff);
 
-		if (meshbin.count(vertex_id)) {
+		bool inserted = false;
+		const unsigned v_idx = meshbin.findOrInsert(
+			info_idx[0], info_idx[1], info_idx[2], (unsigned)mesh.data.size(),
+			inserted);
+
+		if (!inserted) {
 			copied_v += 1;
 			//printf("Bang!!!\t");
-			return meshbin[vertex_id];
+			return v_idx;
 		}
 		else {
-			//printf("Miss: %s\n", vertex_id._str());
-			meshbin[vertex_id] = vertices.size();
-
-			//printf("%u/%u/%u\t", info_idx.x(), info_idx.y(), info_idx.z());
+			//printf("%u/%u/%u\t", info_idx[0], info_idx[1], info_idx[2]);
+			Vertex output = Vertex();
 			// position
-			output.position[0] = vert[info_idx.x()].x();
-			output.position[1] = vert[info_idx.x()].y();
-			output.position[2] = vert[info_idx.x()].z();
+			output.position[0] = vert[info_idx[0]].x();
+			output.position[1] = vert[info_idx[0]].y();
+			output.position[2] = vert[info_idx[0]].z();
 			// texture coords
-			output.texCoords[0] = uv[info_idx.y()].x();
-			output.texCoords[1] = uv[info_idx.y()].y();
+			if (has_uv) {
+				output.texCoords[0] = uv[info_idx[1]].x();
+				output.texCoords[1] = uv[info_idx[1]].y();
+			}
 			// normal
-			output.normal[0] = norm[info_idx.z()].x();
-			output.normal[1] = norm[info_idx.z()].y();
-			output.normal[2] = norm[info_idx.z()].z();
+			if (has_norm) {
+				output.normal[0] = norm[info_idx[2]].x();
+				output.normal[1] = norm[info_idx[2]].y();
+				output.normal[2] = norm[info_idx[2]].z();
+			}
 
 			// printf("v->\t %.3f %.3f %.3f\n",
 			// 		output.position[0], output.position[1], output.position[2]);
@@ -137,228 +386,1232 @@ ObjImportStatus DD_ObjConverter::importOBJ(const char* filename)
 			// printf("uv->\t %.3f %.3f",
 			// 		output.texCoords[0], output.texCoords[1]);
 
-			vertices.push_back(output);
+			mesh.data.push_back(output);
 			unique_v += 1;
-			return (unsigned)vertices.size() - 1;
+			return (unsigned)mesh.data.size() - 1;
 		}
 	};
 
-	/// \brief Lambda to calculate tangent space for face
-	auto getTanSpaceVector = [&](const vec3_u idxs)
+	/// \brief Lambda to count the corners of a face line: starts of
+	/// tokens, the same ones parseChunk reads
+	auto countCorners = [&](const char *line, const char *line_end)
 	{
-		vec3_f out;
-		float factor = 0.f;
-
-		// get uv and position info
-		Vertex &v1 = vertices[idxs.x()];
-		Vertex &v2 = vertices[idxs.y()];
-		Vertex &v3 = vertices[idxs.z()];
-		vec3_f vert_1 = vec3_f(v1.position);
-		vec3_f vert_2 = vec3_f(v2.position);
-		vec3_f vert_3 = vec3_f(v3.position);
-		vec3_f uv_1 = vec3_f(v1.texCoords[0], v1.texCoords[1]);
-		vec3_f uv_2 = vec3_f(v2.texCoords[0], v2.texCoords[1]);
-		vec3_f uv_3 = vec3_f(v3.texCoords[0], v3.texCoords[1]);
-
-		// get edge and uv (direction) info
-		vec3_f edge_1 = vert_2 - vert_1;
-		vec3_f edge_2 = vert_3 - vert_1;
-		vec3_f del_uv1 = uv_2 - uv_1;
-		vec3_f del_uv2 = uv_3 - uv_1;
-
-		// calculate the inverse of the UV matrix and multiply by edge 1 & 2
-		factor = 1.f / (del_uv1.x() * del_uv2.y() - del_uv2.x() * del_uv1.y());
-		out.x() = factor * (del_uv2.y() * edge_1.x() - del_uv1.y() * edge_2.x());
-		out.y() = factor * (del_uv2.y() * edge_1.y() - del_uv1.y() * edge_2.y());
-		out.z() = factor * (del_uv2.y() * edge_1.z() - del_uv1.y() * edge_2.z());
-		// normalize
-		float mag = std::sqrt(out.x() * out.x() + out.y() * out.y() + out.z() *
-							  out.z());
-		out = vec3_f( out.x()/mag, out.y()/mag, out.z()/mag );
-		// printf("tan -> %.3f %.3f %.3f\n", out.x(), out.y(), out.z());
-		// printf("-----------------------------------------\n");
-		for (int i = 0; i < 3; i++) {
-			v1.tangent[i] = out.data[i];
-			v2.tangent[i] = out.data[i];
-			v3.tangent[i] = out.data[i];
+		unsigned count = 0;
+		bool in_token = false;
+		for (const char *str = line + 1; str < line_end; str++) {
+			const bool token = !isSpace(*str);
+			count += (token && !in_token) ? 1 : 0;
+			in_token = token;
 		}
+		return count;
 	};
 
-	// get file contents
-	std::ifstream file(filename);
-	if (file.good()) {
-		char line[256];
-		char lineId[4];
-
-		while (file.getline(line, sizeof(line))) {
-			getLineId(line, lineId, 2);
-			if(strcmp(lineId, "v ") == 0) {
-				if (!v_vt_vn[0]) { v_vt_vn[0] = true; }
-				vert.push_back(getVec3(line, 3));
+	/// \brief Lambda to count the records of a chunk (sizes every buffer)
+	auto scanChunk = [&](ObjChunk &chunk)
+	{
+		const char *line = chunk.begin;
+		const char *chunk_end = chunk.end;
+
+		while (line < chunk_end) {
+			const char *line_end = (const char*)memchr(line, '\n',
+													   chunk_end - line);
+			line_end = line_end ? line_end : chunk_end;
+
+			switch (recordType(line, line_end - line)) {
+				case ObjRecord::V:
+					chunk.lines.v++;
+					break;
+				case ObjRecord::VT:
+					chunk.lines.vt++;
+					break;
+				case ObjRecord::VN:
+					chunk.lines.vn++;
+					break;
+				case ObjRecord::USEMTL:
+					chunk.lines.usemtl++;
+					break;
+				case ObjRecord::F: {
+					const unsigned count = countCorners(line, line_end);
+					chunk.lines.f++;
+					chunk.num_corners += count;
+					chunk.num_triangles += (count > 2) ? count - 2 : 0;
+					chunk.num_polygons += (count > 3) ? 1 : 0;
+					break;
+				}
+				case ObjRecord::OTHER:
+					chunk.lines.other++;
+					break;
 			}
-			if(strcmp(lineId, "vn") == 0) {
-				if (!v_vt_vn[2]) { v_vt_vn[2] = true; }
-				norm.push_back(getVec3(line, 3));
+			line = line_end + 1;
+		}
+	};
+
+	/// \brief Lambda to parse all records of a chunk into the buffers the
+	/// pre-scan sized
+	auto parseChunk = [&](ObjChunk &chunk)
+	{
+		const char *line = chunk.begin;
+		const char *chunk_end = chunk.end;
+		vec3_f *chunk_vert = vert.data() + chunk.first_vert;
+		vec3_f *chunk_norm = norm.data() + chunk.first_norm;
+		vec3_f *chunk_uv = uv.data() + chunk.first_uv;
+		ObjCorner *corner = chunk.corners;
+		unsigned num_faces = 0;
+		unsigned num_meshes = 0;
+
+		while (line < chunk_end) {
+			const char *line_end = (const char*)memchr(line, '\n',
+													   chunk_end - line);
+			line_end = line_end ? line_end : chunk_end;
+
+			switch (recordType(line, line_end - line)) {
+				case ObjRecord::V:
+					*chunk_vert++ = getVec3(line, line_end, 3);
+					break;
+				case ObjRecord::VT:
+					*chunk_uv++ = getVec3(line, line_end, 2);
+					break;
+				case ObjRecord::VN:
+					*chunk_norm++ = getVec3(line, line_end, 3);
+					break;
+				case ObjRecord::USEMTL:
+					chunk.mesh_start[num_meshes++] = num_faces;
+					break;
+				case ObjRecord::F: {
+					const char* str = line + 1; // skip identifier
+					const char* end = line_end;
+					// ignore trailing whitespace (and '\r')
+					while (end > str && isSpace(*(end - 1))) { end--; }
+
+					// records so far in the file (the chunk's streams start
+					// at its prefix offsets)
+					const ObjRecordCounts counts = {
+						(unsigned)(chunk_vert - vert.data()),
+						(unsigned)(chunk_uv - uv.data()),
+						(unsigned)(chunk_norm - norm.data())
+					};
+					const unsigned count = parseFace(str, end, counts, corner);
+					chunk.num_unlit += (count > 0 &&
+										corner->idx[2] == k_no_index) ? 1 : 0;
+					corner += count;
+					chunk.face_size[num_faces++] = count;
+					break;
+				}
+				case ObjRecord::OTHER:
+					break;
 			}
-			if(strcmp(lineId, "vt") == 0) {
-				if (!v_vt_vn[1]) { v_vt_vn[1] = true; }
-				uv.push_back(getVec3(line, 2));
+			line = line_end + 1;
+		}
+	};
+
+	// get file contents. Lines are tokenized in place from the mapped file
+	DD_MappedFile file;
+	{
+		DD_PROFILE_SCOPE(profile.read);
+		if (!file.open(filename)) {
+			printf("Cannot open %s\n", filename);
+			return ObjImportStatus::FILE_NOT_FOUND;
+		}
+	}
+	bytes_read = file.size();
+
+	// split file into chunks at newline boundaries. A pipelined import cuts
+	// more chunks than threads, so each stage hands chunks on as it goes
+	unsigned threads = (num_threads == 0) ? dd_hardware_threads() : num_threads;
+	const size_t max_chunks = bytes_read / k_min_chunk_bytes + 1;
+	threads = (threads > max_chunks) ? (unsigned)max_chunks : threads;
+	const bool pipelined = options.pipeline;
+	const size_t depth = std::max(options.pipeline_depth, 1u);
+	size_t num_chunks = threads;
+	if (pipelined) {
+		num_chunks = std::max(num_chunks,
+							  bytes_read / k_pipeline_chunk_bytes + 1);
+	}
+	parse_threads = threads;
+	parse_chunks = (unsigned)num_chunks;
+
+	/// \brief Lambda to make the queues between a stage & its workers.
+	/// Worker w gets chunks w, w + threads, .. in order through queue w
+	auto makeQueues = [&]() {
+		std::vector<std::unique_ptr<dd_spsc_queue<size_t>>> queues(threads);
+		for (auto &queue : queues) {
+			queue.reset(new dd_spsc_queue<size_t>(depth));
+		}
+		return queues;
+	};
+
+	// temporaries of this import come from the arena (dropped after dedup)
+	arena.reset();
+	ObjChunk *chunks = arena.allocArray<ObjChunk>(num_chunks);
+	size_t num_corners = 0, num_triangles = 0, num_meshes = 0, num_faces = 0;
+	ObjCorner *corners = nullptr;
+	unsigned *face_sizes = nullptr;
+	{
+		DD_PROFILE_SCOPE(profile.scan);
+		const char *chunk_start = file.begin();
+		for (size_t i = 0; i < num_chunks; i++) {
+			const char *chunk_end = file.begin() +
+									bytes_read * (i + 1) / num_chunks;
+			if (chunk_end < chunk_start) { chunk_end = chunk_start; }
+			if (chunk_end < file.end()) {
+				const char *nl = (const char*)memchr(chunk_end, '\n',
+													 file.end() - chunk_end);
+				chunk_end = nl ? nl + 1 : file.end();
 			}
-			if(strcmp(lineId, "us") == 0) {
-				mesh_offset.push_back(indices.size());
+			chunks[i].begin = chunk_start;
+			chunks[i].end = chunk_end;
+			chunk_start = chunk_end;
+		}
+
+		if (!pipelined) {
+			dd_parallel_for(threads, threads,
+				[&](const size_t begin, const size_t end, const unsigned) {
+					for (size_t i = begin; i < end; i++) {
+						scanChunk(chunks[i]);
+					}
+				});
+		}
+		else {
+			// a reader thread faults the mapped chunks in ahead of the scan
+			auto read = makeQueues();
+			std::thread reader([&]() {
+				for (size_t c = 0; c < num_chunks; c++) {
+					file.prefetch(chunks[c].begin - file.begin(),
+								  chunks[c].end - chunks[c].begin);
+					read[c % threads]->push(c);
+				}
+				for (auto &queue : read) { queue->close(); }
+			});
+			dd_parallel_for(threads, threads,
+				[&](const size_t, const size_t, const unsigned w) {
+					size_t c;
+					while (read[w]->pop(c)) { scanChunk(chunks[c]); }
+				});
+			reader.join();
+		}
+
+		// every buffer gets its final size once: chunk offsets are prefix
+		// sums of the record counts
+		size_t num_vert = 0, num_norm = 0, num_uv = 0;
+		for (size_t i = 0; i < num_chunks; i++) {
+			num_corners += chunks[i].num_corners;
+			num_faces += chunks[i].lines.f;
+		}
+		corners = arena.allocArray<ObjCorner>(num_corners);
+		face_sizes = arena.allocArray<unsigned>(num_faces);
+		size_t first_corner = 0, first_face = 0;
+		for (size_t i = 0; i < num_chunks; i++) {
+			ObjChunk &chunk = chunks[i];
+			chunk.first_vert = num_vert;
+			chunk.first_norm = num_norm;
+			chunk.first_uv = num_uv;
+			chunk.corners = corners + first_corner;
+			chunk.face_size = face_sizes + first_face;
+			chunk.mesh_start = arena.allocArray<unsigned>(chunk.lines.usemtl);
+			num_vert += chunk.lines.v;
+			num_norm += chunk.lines.vn;
+			num_uv += chunk.lines.vt;
+			first_corner += chunk.num_corners;
+			first_face += chunk.lines.f;
+			num_triangles += chunk.num_triangles;
+			num_meshes += chunk.lines.usemtl;
+		}
+		// filled by the chunk parsers: no zero fill
+		static_assert(std::is_trivial<vec3_f>::value,
+					  "vec3_f buffers would be zero filled");
+		vert.resizeUninitialized(num_vert);
+		norm.resizeUninitialized(num_norm);
+		uv.resizeUninitialized(num_uv);
+	}
+#if DD_PROFILE
+	for (size_t i = 0; i < num_chunks; i++) {
+		const ObjChunk &chunk = chunks[i];
+		profile.lines.v += chunk.lines.v;
+		profile.lines.vt += chunk.lines.vt;
+		profile.lines.vn += chunk.lines.vn;
+		profile.lines.f += chunk.lines.f;
+		profile.lines.usemtl += chunk.lines.usemtl;
+		profile.lines.other += chunk.lines.other;
+		profile.corners += chunk.num_corners;
+		profile.polygons += chunk.num_polygons;
+	}
+#endif
+
+	/// \brief Lambda to give faces w/o vn smooth normals, before the dedup
+	/// so vertices split where the normals do (creases). Needs every chunk
+	/// parsed
+	bool normals_done = false;
+	auto generateNormals = [&]() {
+		normals_done = true;
+		const auto normal_start = std::chrono::high_resolution_clock::now();
+		const NormalCorners normal_corners = {
+			&corners[0].idx[0], &corners[0].idx[2],
+			sizeof(ObjCorner) / sizeof(unsigned) };
+		generated_normals = (unsigned)dd_generateNormals(
+			vert.data(), vert.size(), face_sizes, num_faces, normal_corners,
+			k_no_index, options.crease_angle, norm, threads);
+		normal_ms = std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - normal_start).count();
+	};
+
+	/// \brief Lambda to reserve the dedup output. Unique vertices are
+	/// bounded by the # of corners. Reserving that only maps address space,
+	/// pages are touched as vertices are added. The dedup table is filled on
+	/// reserve, so it gets the usual size: close to the largest attribute
+	/// stream
+	auto reserveMesh = [&]() {
+		mesh.data.reserve(num_corners);
+		mesh.indices.reserve(num_triangles);
+		mesh_offset.reserve(num_meshes + 2);	// + implicit first ebo
+		const size_t max_attrib = std::max(vert.size(),
+										   std::max(norm.size(), uv.size()));
+		meshbin.reserve(std::min(num_corners, max_attrib + max_attrib / 4));
+	};
+
+	/// \brief Lambda to build the vertices & triangles of a chunk. Chunks
+	/// go in file order. Stops at the first face w/ a bad index (false)
+	auto dedupChunk = [&](const ObjChunk &chunk) {
+		size_t corner_idx = 0;
+		size_t mesh_idx = 0;
+		// faces before the first usemtl (or in a file w/o any) go in an
+		// implicit first ebo (default material)
+		if (mesh_offset.empty() && chunk.lines.f > 0 &&
+			(chunk.lines.usemtl == 0 || chunk.mesh_start[0] > 0)) {
+			mesh_offset.push_back(0);
+		}
+		for (size_t f = 0; f < chunk.lines.f; f++) {
+			while (mesh_idx < chunk.lines.usemtl &&
+				   chunk.mesh_start[mesh_idx] == f) {
+				mesh_offset.push_back(mesh.indices.size());
+				mesh_idx++;
 			}
-			if(strcmp(lineId, "f ") == 0) {
-				if (!v_vt_vn[0] || !v_vt_vn[1] || !v_vt_vn[2]) {
-					return ObjImportStatus::V_VT_VN_MISSING;
+			const unsigned start_idx = mesh.indices.size();
+			vec3_u idxs = vec3_u();
+			for (unsigned count = 0; count < chunk.face_size[f]; count++) {
+				const ObjCorner &corner = chunk.corners[corner_idx++];
+				if (count < 3) {
+					idxs.data[count] = getVertex(corner);
+					if (count == 2) {
+						mesh.indices.push_back(idxs);
+					}
+				}
+				else {
+					// triengle fan
+					idxs.x() = mesh.indices[start_idx].x();
+					idxs.y() = mesh.indices[mesh.indices.size() - 1].z();
+					idxs.z() = getVertex(corner);
+					mesh.indices.push_back(idxs);
 				}
+			}
+			if (bad_index) { return false; }
+		}
+		// usemtl after the last face of the chunk
+		for (; mesh_idx < chunk.lines.usemtl; mesh_idx++) {
+			mesh_offset.push_back(mesh.indices.size());
+		}
+		return true;
+	};
 
-				char* str = line;
-				skipPastDelim(str); // skip identifier
-				const unsigned start_idx = indices.size();
-				vec3_u idxs;
-				unsigned count = 0;
-				while(*str) {		// null terminate evaluates to false
-					if (count < 3) {
-						idxs.data[count] = getVertex(str);
-						// calc tangent on third vertex
-						if (count == 2) {
-							indices.push_back(idxs);
-							getTanSpaceVector(idxs);
-						}
+	if (!pipelined) {
+		{
+			DD_PROFILE_SCOPE(profile.parse);
+			dd_parallel_for(threads, threads,
+				[&](const size_t begin, const size_t end, const unsigned) {
+					for (size_t i = begin; i < end; i++) {
+						parseChunk(chunks[i]);
 					}
-					else {
-						// triengle fan
-						idxs.x() = indices[start_idx].x();
-						idxs.y() = indices[indices.size() - 1].z();
-						idxs.z() = getVertex(str);
-						indices.push_back(idxs);
-						// calc tangent after every extra face
-						getTanSpaceVector(idxs);
+				});
+		}
+
+		size_t num_unlit = 0;
+		for (size_t i = 0; i < num_chunks; i++) {
+			num_unlit += chunks[i].num_unlit;
+		}
+		if (options.generate_normals && num_unlit > 0) { generateNormals(); }
+
+		DD_PROFILE_SCOPE(profile.dedup);
+		reserveMesh();
+		for (size_t i = 0; i < num_chunks; i++) {
+			if (!dedupChunk(chunks[i])) { break; }
+		}
+		mesh_offset.push_back(mesh.indices.size());
+	}
+	else {
+		// parse threads run ahead of the dedup by up to depth chunks each
+		// (the dedup stage's time includes the parse it waits for)
+		DD_PROFILE_SCOPE(profile.dedup);
+		reserveMesh();
+		auto parsed = makeQueues();
+		// set when the dedup stops at a bad index: the rest is skipped
+		std::atomic<bool> stop(false);
+		std::vector<std::thread> parsers;
+		for (unsigned w = 0; w < threads; w++) {
+			parsers.emplace_back([&, w]() {
+				for (size_t c = w; c < num_chunks; c += threads) {
+					if (!stop.load(std::memory_order_relaxed)) {
+						parseChunk(chunks[c]);
 					}
-					count += 1;
+					parsed[w]->push(c);
 				}
+			});
+		}
+		// chunks [0, num_parsed) are parsed, their records readable
+		size_t num_parsed = 0;
+		parseMore = [&]() {
+			size_t c;
+			parsed[num_parsed % threads]->pop(c);
+			num_parsed++;
+			const bool all = num_parsed == num_chunks;
+			parsed_vert = all ? SIZE_MAX : chunks[num_parsed].first_vert;
+			parsed_uv = all ? SIZE_MAX : chunks[num_parsed].first_uv;
+			parsed_norm = all ? SIZE_MAX : chunks[num_parsed].first_norm;
+		};
+		parsed_vert = parsed_uv = parsed_norm = 0;
+		for (size_t c = 0; c < num_chunks; c++) {
+			while (num_parsed <= c) { parseMore(); }
+			// normals need the whole file: the first chunk w/ faces w/o vn
+			// waits for the parse to finish
+			if (options.generate_normals && chunks[c].num_unlit > 0 &&
+				!normals_done) {
+				while (num_parsed < num_chunks) { parseMore(); }
+				generateNormals();
+			}
+			if (!dedupChunk(chunks[c])) {
+				// let the parsers run out (they block on full queues)
+				stop.store(true, std::memory_order_relaxed);
+				while (num_parsed < num_chunks) { parseMore(); }
+				break;
 			}
 		}
-		mesh_offset.push_back(indices.size());
-		return ObjImportStatus::GOOD;
+		for (auto &parser : parsers) { parser.join(); }
+		parseMore = nullptr;
+		mesh_offset.push_back(mesh.indices.size());
+	}
+	if (bad_index) {
+		return ObjImportStatus::V_VT_VN_MISSING;
+	}
+	DD_PROFILE_COUNT(profile.dedup_lookups, meshbin.lookups());
+	DD_PROFILE_COUNT(profile.dedup_probes, meshbin.probes());
+	DD_PROFILE_COUNT(profile.dedup_inserts, meshbin.size());
+	arena_bytes = arena.bytesAllocated();
+	arena.reset();
+
+	// tangent frames need every face touching a vertex, so they're a
+	// separate pass over the finished triangles (w/o uvs or normals there
+	// is no frame, tangents stay 0)
+	if (!uv.empty() && !norm.empty()) {
+		const auto tangent_start = std::chrono::high_resolution_clock::now();
+		dd_computeTangents(mesh.data.data(), mesh.data.size(),
+						   mesh.indices.data(), mesh.indices.size(), threads);
+		tangent_ms = std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - tangent_start).count();
+	}
+
+	if (!options.lods.empty() && numEbos() > 0) {
+		const auto lod_start = std::chrono::high_resolution_clock::now();
+		generateLods(threads);
+		lod_ms = std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - lod_start).count();
+	}
+
+	// triangle order within an ebo doesn't change shading, only how often
+	// the gpu re-runs the vertex shader (after tangents so they stay the
+	// same w/ or w/o this stage)
+	const auto optimize_start = std::chrono::high_resolution_clock::now();
+	if (options.optimize_vertex_cache) {
+		cache_before = dd_analyzeVertexCache(mesh.indices.data(),
+			mesh_offset.data(), numEbos(), mesh.data.size());
+		dd_optimizeVertexCache(mesh.indices.data(), mesh_offset.data(),
+							   numEbos(), mesh.data.size());
+		cache_after = dd_analyzeVertexCache(mesh.indices.data(),
+			mesh_offset.data(), numEbos(), mesh.data.size());
+		dd_optimizeVertexCache(lod_indices.data(), lod_offset.data(),
+							   numLods() * numEbos(), mesh.data.size());
+	}
+	// then lay the vertex buffer out in the order the indices fetch it
+	if (options.optimize_vertex_fetch) {
+		optimizeVertexFetch(threads);
+	}
+	optimize_ms = std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - optimize_start).count();
+
+	// meshlets last, they capture the final triangle & vertex order
+	if (options.build_meshlets) {
+		const auto meshlet_start = std::chrono::high_resolution_clock::now();
+		dd_buildMeshlets(mesh.data.data(), mesh.data.size(),
+						 mesh.indices.data(), mesh_offset.data(), numEbos(),
+						 options.meshlet_limits, meshlets, threads);
+		meshlet_ms = std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - meshlet_start).count();
+	}
+	if (options.build_bvh && numEbos() > 0) {
+		const auto bvh_start = std::chrono::high_resolution_clock::now();
+		dd_buildBvh(mesh.data.data(), mesh.indices.data(), mesh_offset.data(),
+					numEbos(), options.bvh_max_leaf, bvh, threads);
+		bvh_ms = std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - bvh_start).count();
+	}
+
+	// structure-of-arrays storage once the vertex order is final. The stages
+	// above gather whole vertices by index, which suits interleaved records
+	if (options.vertex_streams) {
+		dd_splitVertices(mesh.data.data(), mesh.data.size(), mesh.streams,
+						 threads);
+		mesh.data.release();
+	}
+
+	// ebo table & bounds of the final mesh
+	for (unsigned e = 0; e < numEbos(); e++) {
+		const unsigned range[2] = {
+			mesh_offset[e], mesh_offset[e + 1] - mesh_offset[e] };
+		mesh.mesh_idx.appendRow(range);
+	}
+	if (options.vertex_streams) {
+		dd_streamBounds(mesh.streams.position.data(), mesh.streams.size(), 3,
+						3, mesh.bbox_min.data, mesh.bbox_max.data);
+	}
+	else {
+		dd_streamBounds(mesh.data.empty() ? nullptr : mesh.data[0].position,
+						mesh.data.size(), 3, sizeof(Vertex) / sizeof(float),
+						mesh.bbox_min.data, mesh.bbox_max.data);
+	}
+
+	import_ms = std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - import_start).count();
+	peak_rss = dd_peakRSS();
+	return ObjImportStatus::GOOD;
+}
+
+/// \brief importOBJ, then move the mesh out to the caller
+MeshContainer DD_ObjConverter::importOBJ(const char* filename,
+										 ObjImportStatus &status,
+										 const unsigned num_threads)
+{
+	status = importOBJ(filename, num_threads);
+	return takeMesh();
+}
+
+/// \brief Hand the imported mesh over w/o copying. The converter is left
+/// as after reset()
+MeshContainer DD_ObjConverter::takeMesh()
+{
+	MeshContainer out = std::move(mesh);
+	reset();
+	return out;
+}
+
+/// \brief Simplify every ebo into options.lods.size() levels. Ebos are
+/// independent, so they're spread over num_threads threads
+void DD_ObjConverter::generateLods(const unsigned num_threads)
+{
+	const unsigned num_ebos = numEbos();
+	const size_t num_levels = options.lods.size();
+	std::vector<uint8_t> seam;
+	dd_seamVertices(mesh.data.data(), mesh.data.size(), seam);
+	const float extent = dd_meshExtent(mesh.data.data(), mesh.data.size());
+
+	// [ebo * num_levels + level]
+	std::vector<std::vector<vec3_u>> levels(num_ebos * num_levels);
+	std::vector<float> errors(num_ebos * num_levels, 0.f);
+	dd_parallel_for(num_ebos, num_threads,
+		[&](const size_t begin, const size_t end, const unsigned) {
+			for (size_t e = begin; e < end; e++) {
+				dd_simplifyChain(mesh.data.data(), seam.data(), extent,
+								 mesh.indices.data() + mesh_offset[e],
+								 mesh_offset[e + 1] - mesh_offset[e],
+								 options.lods.data(), num_levels,
+								 &levels[e * num_levels],
+								 &errors[e * num_levels]);
+			}
+		});
+
+	lod_offset.assign(1, 0);
+	lod_error.assign(num_levels, 0.f);
+	for (size_t l = 0; l < num_levels; l++) {
+		for (unsigned e = 0; e < num_ebos; e++) {
+			const std::vector<vec3_u> &tris = levels[e * num_levels + l];
+			lod_indices.insert(lod_indices.end(), tris.begin(), tris.end());
+			lod_offset.push_back((unsigned)lod_indices.size());
+			lod_error[l] = std::max(lod_error[l], errors[e * num_levels + l]);
+		}
+	}
+}
+
+/// \brief Deepest leaf and triangle weighted sah cost over all ebo bvhs
+void DD_ObjConverter::bvhQuality(unsigned &depth, float &sah_cost) const
+{
+	depth = 0;
+	double cost = 0.0;
+	uint64_t num_triangles = 0;
+	for (const DDMBvh &tree : bvh.bvhs) {
+		depth = std::max(depth, tree.depth);
+		cost += (double)tree.sah_cost * tree.num_triangles;
+		num_triangles += tree.num_triangles;
+	}
+	sah_cost = num_triangles ? (float)(cost / num_triangles) : 0.f;
+}
+
+/// \brief Renumber vertices in fetch order w/ one vertex range per ebo. An
+/// ebo's lod levels are grouped w/ it so they share its range
+void DD_ObjConverter::optimizeVertexFetch(const unsigned num_threads)
+{
+	const unsigned num_ebos = numEbos();
+	const unsigned num_lods = numLods();
+	std::vector<unsigned> source;
+
+	if (num_lods == 0) {
+		duplicated_v = (unsigned)dd_optimizeVertexFetch(mesh.indices.data(),
+			mesh.indices.size(), mesh_offset.data(), num_ebos, mesh.data.size(),
+			source);
 	}
 	else {
-		printf("Cannot open %s\n", filename);
-		return ObjImportStatus::FILE_NOT_FOUND;
+		// [tris before ebo 0][ebo 0 & its lods][ebo 1 & its lods]...
+		// [tris after the last ebo]
+		std::vector<vec3_u> grouped(mesh.indices.begin(),
+									mesh.indices.begin() + mesh_offset[0]);
+		grouped.reserve(mesh.indices.size() + lod_indices.size());
+		std::vector<unsigned> group_offset;
+		/// \brief Lambda to get the triangles of ebo e at level l (0 = full
+		/// resolution)
+		auto levelTris = [&](const unsigned e, const unsigned l,
+							 unsigned &count) {
+			const unsigned* offs = (l == 0) ? &mesh_offset[e] :
+				&lod_offset[(l - 1) * num_ebos + e];
+			count = offs[1] - offs[0];
+			return ((l == 0) ? mesh.indices.data() : lod_indices.data()) +
+				   offs[0];
+		};
+		for (unsigned e = 0; e < num_ebos; e++) {
+			group_offset.push_back((unsigned)grouped.size());
+			for (unsigned l = 0; l <= num_lods; l++) {
+				unsigned count;
+				const vec3_u* tris = levelTris(e, l, count);
+				grouped.insert(grouped.end(), tris, tris + count);
+			}
+		}
+		group_offset.push_back((unsigned)grouped.size());
+		grouped.insert(grouped.end(),
+					   mesh.indices.begin() + mesh_offset[num_ebos],
+					   mesh.indices.end());
+
+		duplicated_v = (unsigned)dd_optimizeVertexFetch(grouped.data(),
+			grouped.size(), group_offset.data(), num_ebos, mesh.data.size(),
+			source);
+
+		// scatter the remapped triangles back
+		std::copy(grouped.begin(), grouped.begin() + mesh_offset[0],
+				  mesh.indices.begin());
+		for (unsigned e = 0; e < num_ebos; e++) {
+			const vec3_u* src = grouped.data() + group_offset[e];
+			for (unsigned l = 0; l <= num_lods; l++) {
+				unsigned count;
+				vec3_u* dst = levelTris(e, l, count);
+				std::copy(src, src + count, dst);
+				src += count;
+			}
+		}
+		std::copy(grouped.begin() + group_offset[num_ebos], grouped.end(),
+				  mesh.indices.begin() + mesh_offset[num_ebos]);
 	}
+
+	static_assert(std::is_trivial<Vertex>::value,
+				  "reordered vertices would be zero filled");
+	dd_array<Vertex> reordered;
+	reordered.resizeUninitialized(source.size());
+	dd_parallel_for(source.size(), num_threads,
+		[&](const size_t begin, const size_t end, const unsigned) {
+			for (size_t i = begin; i < end; i++) {
+				reordered[i] = mesh.data[source[i]];
+			}
+		});
+	mesh.data.swap(reordered);
 }
 
 void DD_ObjConverter::printStats()
 {
 	printf("OBJ Stats \n");
 	printf("\tPositions read:  %lu\n", vert.size());
-	printf("\tNormals read:    %lu\n", norm.size());
+	printf("\tNormals read:    %lu\n", norm.size() - generated_normals);
+	if (generated_normals > 0) {
+		printf("\tNormals made:    %u (crease %.1f deg)\n", generated_normals,
+			   options.crease_angle);
+	}
 	printf("\tUVs read:        %lu\n", uv.size());
 	printf("\n");
+	printf("\tInput\n");
+	printf("\t  bytes:         %lu\n", bytes_read);
+	printf("\t  parse threads: %u\n", parse_threads);
+	if (options.pipeline) {
+		printf("\t  pipelined:     %u chunks, depth %u\n", parse_chunks,
+			   options.pipeline_depth);
+	}
+	printf("\t  import time:   %.3f ms\n", import_ms);
+	if (generated_normals > 0) {
+		printf("\t  (normals:      %.3f ms)\n", normal_ms);
+	}
+	printf("\t  (tangents:     %.3f ms)\n", tangent_ms);
+	if (options.optimize_vertex_cache || options.optimize_vertex_fetch) {
+		printf("\t  (optimize:     %.3f ms)\n", optimize_ms);
+	}
+	if (!options.lods.empty()) {
+		printf("\t  (lods:         %.3f ms)\n", lod_ms);
+	}
+	if (options.build_meshlets) {
+		printf("\t  (meshlets:     %.3f ms)\n", meshlet_ms);
+	}
+	if (options.build_bvh) {
+		printf("\t  (bvh:          %.3f ms)\n", bvh_ms);
+	}
+	printf("\t  throughput:    %.2f MB/s\n",
+		   (import_ms > 0.0) ? (bytes_read / (1024.0 * 1024.0)) /
+							   (import_ms / 1000.0) : 0.0);
+	printf("\t  temporaries:   %.1f KB (arena)\n", arena_bytes / 1024.0);
+	printf("\t  peak RSS:      %.1f MB\n", peak_rss / (1024.0 * 1024.0));
+	printf("\n");
 	printf("\tVertices\n");
 	printf("\t  total:         %u\n", unique_v);
 	printf("\t  re-referenced: %u\n", copied_v);
+	if (options.optimize_vertex_fetch) {
+		printf("\t  split by ebo:  %u\n", duplicated_v);
+	}
+	printf("\t  dedup probes:  %.3f per lookup\n", meshbin.avgProbes());
 	printf("\n");
 	printf("\tTriangles\n");
-	printf("\t  total:         %lu\n", indices.size());
+	printf("\t  total:         %lu\n", mesh.indices.size());
+	for (unsigned l = 0; l < numLods(); l++) {
+		const unsigned tris = lod_offset[(l + 1) * numEbos()] -
+							  lod_offset[l * numEbos()];
+		printf("\t  lod %u:         %u (%.1f%%, error %.5f)\n", l + 1, tris,
+			   mesh.indices.empty() ? 0.0 : 100.0 * tris / mesh.indices.size(),
+			   lod_error[l]);
+	}
+	if (options.build_meshlets) {
+		const size_t num = meshlets.meshlets.size();
+		printf("\t  meshlets:      %lu (%.1f vertices, %.1f triangles avg)\n",
+			   (unsigned long)num,
+			   num ? (double)meshlets.vertices.size() / num : 0.0,
+			   num ? (double)meshlets.triangles.size() / 3 / num : 0.0);
+	}
+	if (options.build_bvh) {
+		unsigned depth;
+		float sah_cost;
+		bvhQuality(depth, sah_cost);
+		printf("\t  bvh:           %lu nodes (depth %u, sah cost %.2f)\n",
+			   (unsigned long)bvh.nodes.size(), depth, sah_cost);
+	}
+	if (options.optimize_vertex_cache) {
+		printf("\t  ACMR:          %.3f -> %.3f (fifo %u)\n",
+			   cache_before.acmr(), cache_after.acmr(), k_vertex_cache_size);
+		printf("\t  ATVR:          %.3f -> %.3f\n", cache_before.atvr(),
+			   cache_after.atvr());
+	}
+	if (profile.enabled) {
+		/// \brief Lambda to print one stage: time & allocations
+		auto printStage = [](const char* name, const ProfileStage &stage)
+		{
+			printf("\t  %-14s %9.3f ms  %8llu allocs  %10.1f KB\n", name,
+				   stage.ms, (unsigned long long)stage.allocs,
+				   stage.alloc_bytes / 1024.0);
+		};
+		const ObjLineCounts &lines = profile.lines;
+		printf("\n");
+		printf("\tProfile\n");
+		printStage("read:", profile.read);
+		printStage("scan:", profile.scan);
+		printStage("parse:", profile.parse);
+		printStage("dedup:", profile.dedup);
+		printStage("encode:", profile.encode);
+		printStage("format:", profile.format);
+		printStage("write:", profile.write);
+		printf("\t  lines:         v %llu, vt %llu, vn %llu, f %llu, "
+			   "usemtl %llu, other %llu\n",
+			   (unsigned long long)lines.v, (unsigned long long)lines.vt,
+			   (unsigned long long)lines.vn, (unsigned long long)lines.f,
+			   (unsigned long long)lines.usemtl,
+			   (unsigned long long)lines.other);
+		printf("\t  corners:       %llu (%llu polygons > 3)\n",
+			   (unsigned long long)profile.corners,
+			   (unsigned long long)profile.polygons);
+		printf("\t  dedup:         %llu lookups, %llu probes, "
+			   "%llu inserts\n",
+			   (unsigned long long)profile.dedup_lookups,
+			   (unsigned long long)profile.dedup_probes,
+			   (unsigned long long)profile.dedup_inserts);
+	}
 	printf("\n");
 	printf("\tMesh offsets\n");
-	for (unsigned i = 0; i < mesh_offset.size() - 1; i++) {
-		printf("\t  mesh #%u:\t%u\n", i, mesh_offset[i]);
+	for (unsigned i = 0; i < numEbos(); i++) {
+		printf("\t  mesh #%u:\t%u\t(%u indices)\n", i, mesh_offset[i],
+			   (mesh_offset[i + 1] - mesh_offset[i]) * 3);
 	}
 }
 
-/// \brief Export mesh to format specified by dd_entity_map.txt
-void DD_ObjConverter::exportMesh()
+namespace
 {
-	char lineBuff[256];
-	snprintf(lineBuff, sizeof(lineBuff), "%s.ddm", obj_id._str());
-	std::fstream outfile;
-	outfile.open(lineBuff, std::ios::out);
+	/// \brief Round offset up to the next block boundary
+	inline uint64_t alignBlock(const uint64_t offset)
+	{
+		return (offset + k_ddm_align - 1) & ~(uint64_t)(k_ddm_align - 1);
+	}
 
-	// check file is open
-	if (outfile.bad()) {
+	/// \brief Output block size (text formatting, streamed vertex encoding)
+	const size_t k_write_block_bytes = 1 << 20;
+
+	/// \brief Queue zeros until the output reaches offset
+	void padTo(DD_WriteStage &out, const uint64_t offset)
+	{
+		static const char zeros[k_ddm_align] = {};
+		while (out.bytesQueued() < offset) {
+			out.submitExternal(zeros, (size_t)std::min<uint64_t>(
+				offset - out.bytesQueued(), sizeof(zeros)));
+		}
+	}
+}
+
+/// \brief Export mesh in the binary .ddm layout (see DD_MeshFormat.h).
+/// Returns bytes written (0 on failure)
+uint64_t DD_ObjConverter::exportBinary(const char* filename)
+{
+	const uint32_t num_ebos = numEbos();
+
+	// vertex layout. Float32 w/ every attribute is the mesh's vertex storage
+	// as is (struct Vertex interleaved, VertexStreams split), anything else
+	// is encoded into a separate buffer
+	const bool soa = !mesh.streams.empty();
+	const size_t num_vertices = mesh.numVertices();
+	VertexLayout layout = dd_vertexLayout(options.vertex_encoding,
+										  !norm.empty(), !uv.empty(),
+										  options.split_vertex_streams);
+	if (soa) {
+		dd_vertexRanges(mesh.streams, layout);
+	}
+	else {
+		dd_vertexRanges(mesh.data.data(), mesh.data.size(), layout);
+	}
+	const bool raw_vertices = soa ? layout.isRawStreams() :
+									layout.isRawVertex();
+	// interleaved records are encoded a block at a time as the vertex block
+	// is written (no copy of the whole block, and w/ the pipeline the writes
+	// overlap the encoding). Split streams are encoded up front
+	const bool stream_vertices = !raw_vertices && !soa && !layout.split;
+	std::vector<uint8_t> encoded_vertices;
+	quantize_error = QuantizeError();
+	if (!raw_vertices && !stream_vertices) {
+		DD_PROFILE_SCOPE(profile.encode);
+		if (soa) {
+			dd_quantizeVertices(mesh.streams, layout, encoded_vertices,
+								quantize_error, parse_threads);
+		}
+		else {
+			dd_quantizeVertices(mesh.data.data(), mesh.data.size(), layout,
+								encoded_vertices, quantize_error,
+								parse_threads);
+		}
+	}
+	vertex_stride = layout.stride;
+
+	DDMMaterial material;
+	memset(&material, 0, sizeof(material));
+	snprintf(material.name, sizeof(material.name), "%s", "default");
+	for (int i = 0; i < 3; i++) {
+		material.diffuse[i] = 0.5f;
+		material.specular[i] = 0.5f;
+	}
+
+	// vertices each ebo references
+	std::vector<DDMVertexRange> ranges(num_ebos);
+	for (uint32_t i = 0; i < num_ebos; i++) {
+		unsigned lo = (unsigned)-1, hi = 0;
+		for (unsigned t = mesh_offset[i]; t < mesh_offset[i + 1]; t++) {
+			for (int c = 0; c < 3; c++) {
+				lo = std::min(lo, mesh.indices[t].data[c]);
+				hi = std::max(hi, mesh.indices[t].data[c]);
+			}
+		}
+		ranges[i].first_vertex = (lo <= hi) ? lo : 0;
+		ranges[i].num_vertices = (lo <= hi) ? hi - lo + 1 : 0;
+	}
+
+	// every ebo: full resolution first, then each lod level's
+	struct EboSource
+	{
+		const vec3_u*	tris;
+		unsigned		num_tris;
+		uint32_t		range;		// full resolution ebo it belongs to
+	};
+	std::vector<EboSource> sources;
+	for (uint32_t i = 0; i < num_ebos; i++) {
+		sources.push_back({ mesh.indices.data() + mesh_offset[i],
+							mesh_offset[i + 1] - mesh_offset[i], i });
+	}
+	for (uint32_t l = 0; l < numLods(); l++) {
+		for (uint32_t i = 0; i < num_ebos; i++) {
+			const unsigned* offs = &lod_offset[l * num_ebos + i];
+			sources.push_back({ lod_indices.data() + offs[0],
+								offs[1] - offs[0], i });
+		}
+	}
+
+	// index data, each ebo aligned & relative to its first vertex: 16 bit
+	// when the vertex range fits, optionally varint coded
+	const bool varint = options.compress_indices;
+	std::vector<DDMEbo> ebos(sources.size());
+	std::vector<uint8_t> index_data;
+	std::vector<uint32_t> packed;
+	uint32_t num_indices = 0;
+	index_bytes = 0;
+	{
+		DD_PROFILE_SCOPE(profile.encode);
+		for (size_t i = 0; i < sources.size(); i++) {
+			const EboSource &src = sources[i];
+			const DDMVertexRange &range = ranges[src.range];
+			index_data.resize(alignBlock(index_data.size()));
+
+			DDMEbo &ebo = ebos[i];
+			memset(&ebo, 0, sizeof(DDMEbo));
+			ebo.offset = index_data.size();	// relative to the block for now
+			ebo.num_indices = src.num_tris * 3;
+			ebo.index_size = (range.num_vertices <= 0x10000) ?
+				sizeof(uint16_t) : sizeof(uint32_t);
+			ebo.material = 0;
+			ebo.base_vertex = range.first_vertex;
+			num_indices += ebo.num_indices;
+
+			// indices are stored as vec3_u (w unused)
+			packed.resize(ebo.num_indices);
+			for (unsigned t = 0; t < src.num_tris; t++) {
+				for (int c = 0; c < 3; c++) {
+					packed[t * 3 + c] = src.tris[t].data[c] - ebo.base_vertex;
+				}
+			}
+			if (varint) {
+				dd_encodeIndices(packed.data(), packed.size(), 0, index_data);
+			}
+			else if (ebo.index_size == sizeof(uint16_t)) {
+				const size_t start = index_data.size();
+				index_data.resize(start + packed.size() * sizeof(uint16_t));
+				uint16_t* dst = (uint16_t*)(index_data.data() + start);
+				for (size_t j = 0; j < packed.size(); j++) {
+					dst[j] = (uint16_t)packed[j];
+				}
+			}
+			else {
+				const size_t start = index_data.size();
+				index_data.resize(start + packed.size() * sizeof(uint32_t));
+				memcpy(index_data.data() + start, packed.data(),
+					   packed.size() * sizeof(uint32_t));
+			}
+			index_bytes += index_data.size() - ebo.offset;
+		}
+	}
+
+	std::vector<DDMLod> lods(numLods());
+	for (uint32_t l = 0; l < numLods(); l++) {
+		memset(&lods[l], 0, sizeof(DDMLod));
+		lods[l].first_ebo = l * num_ebos;
+		lods[l].num_triangles = lod_offset[(l + 1) * num_ebos] -
+								lod_offset[l * num_ebos];
+		lods[l].error = lod_error[l];
+	}
+
+	// block table, in file order
+	std::vector<DDMBlock> blocks;
+	std::vector<const void*> block_data;
+	auto addBlock = [&](const uint32_t type, const uint32_t count,
+						const void* data, const uint64_t size) {
+		DDMBlock block;
+		block.type = type;
+		block.count = count;
+		block.offset = 0;
+		block.size = size;
+		blocks.push_back(block);
+		block_data.push_back(data);
+	};
+	addBlock(DDM_BLOCK_ATTRIBS, layout.num_attribs, layout.attribs,
+			 layout.num_attribs * sizeof(DDMVertexAttrib));
+	addBlock(DDM_BLOCK_MATERIALS, 1, &material, sizeof(DDMMaterial));
+	addBlock(DDM_BLOCK_EBOS, num_ebos, ebos.data(),
+			 num_ebos * sizeof(DDMEbo));
+	if (layout.split) {
+		// raw streams by DDMAttribSemantic
+		const float* raw_streams[4] = {
+			mesh.streams.position.data(), mesh.streams.normal.data(),
+			mesh.streams.texcoord.data(), mesh.streams.tangent.data()
+		};
+		for (unsigned a = 0; a < layout.num_attribs; a++) {
+			const DDMVertexAttrib &attrib = layout.attribs[a];
+			addBlock(DDM_BLOCK_VERTEX_STREAM, (uint32_t)num_vertices,
+					 raw_vertices ? (const void*)raw_streams[attrib.semantic] :
+						(const void*)(encoded_vertices.data() +
+									  layout.streamOffset(a, num_vertices)),
+					 (uint64_t)num_vertices * attrib.stride);
+		}
+	}
+	else {
+		// no data: encoded while writing
+		addBlock(DDM_BLOCK_VERTICES, (uint32_t)num_vertices,
+				 raw_vertices ? (const void*)mesh.data.data() : nullptr,
+				 (uint64_t)num_vertices * layout.stride);
+	}
+	const size_t index_block = blocks.size();
+	addBlock(varint ? DDM_BLOCK_INDICES_VARINT : DDM_BLOCK_INDICES,
+			 num_indices, index_data.data(), index_data.size());
+	addBlock(DDM_BLOCK_VERTEX_RANGES, num_ebos, ranges.data(),
+			 num_ebos * sizeof(DDMVertexRange));
+	addBlock(DDM_BLOCK_ATTRIB_RANGES, layout.num_attribs, layout.ranges,
+			 layout.num_attribs * sizeof(DDMAttribRange));
+	if (!lods.empty()) {
+		addBlock(DDM_BLOCK_LODS, (uint32_t)lods.size(), lods.data(),
+				 lods.size() * sizeof(DDMLod));
+		addBlock(DDM_BLOCK_LOD_EBOS, (uint32_t)(ebos.size() - num_ebos),
+				 ebos.data() + num_ebos,
+				 (ebos.size() - num_ebos) * sizeof(DDMEbo));
+	}
+	if (!meshlets.meshlets.empty()) {
+		addBlock(DDM_BLOCK_MESHLETS, (uint32_t)meshlets.meshlets.size(),
+				 meshlets.meshlets.data(),
+				 meshlets.meshlets.size() * sizeof(DDMMeshlet));
+		addBlock(DDM_BLOCK_MESHLET_VERTICES,
+				 (uint32_t)meshlets.vertices.size(), meshlets.vertices.data(),
+				 meshlets.vertices.size() * sizeof(uint32_t));
+		addBlock(DDM_BLOCK_MESHLET_TRIANGLES,
+				 (uint32_t)(meshlets.triangles.size() / 3),
+				 meshlets.triangles.data(), meshlets.triangles.size());
+	}
+	if (!bvh.bvhs.empty()) {
+		addBlock(DDM_BLOCK_BVHS, (uint32_t)bvh.bvhs.size(), bvh.bvhs.data(),
+				 bvh.bvhs.size() * sizeof(DDMBvh));
+		addBlock(DDM_BLOCK_BVH_NODES, (uint32_t)bvh.nodes.size(),
+				 bvh.nodes.data(), bvh.nodes.size() * sizeof(DDMBvhNode));
+		addBlock(DDM_BLOCK_BVH_TRIANGLES, (uint32_t)bvh.triangles.size(),
+				 bvh.triangles.data(),
+				 bvh.triangles.size() * sizeof(uint32_t));
+	}
+
+	uint64_t offset = sizeof(DDMHeader) + blocks.size() * sizeof(DDMBlock);
+	for (DDMBlock &block : blocks) {
+		block.offset = alignBlock(offset);
+		offset = block.offset + block.size;
+	}
+	for (DDMEbo &ebo : ebos) { ebo.offset += blocks[index_block].offset; }
+
+	DDMHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, k_ddm_magic, sizeof(header.magic));
+	header.endian = k_ddm_endian_tag;
+	header.version_major = k_ddm_version_major;
+	header.version_minor = k_ddm_version_minor;
+	header.header_size = sizeof(DDMHeader);
+	header.file_size = offset;
+	snprintf(header.name, sizeof(header.name), "%s", obj_id._str());
+	header.num_vertices = (uint32_t)num_vertices;
+	header.num_ebos = num_ebos;
+	header.num_materials = 1;
+	header.vertex_stride = layout.stride;
+	header.num_blocks = (uint32_t)blocks.size();
+	header.block_offset = sizeof(DDMHeader);
+
+	// everything queued stays alive until out.close()
+	DD_WriteStage out;
+	if (!out.open(filename, k_write_block_bytes,
+				  options.pipeline ? options.pipeline_depth : 0)) {
 		printf("Could not open mesh output file\n" );
-		return;
+		return 0;
+	}
+	out.submitExternal(&header, sizeof(header));
+	out.submitExternal(blocks.data(), blocks.size() * sizeof(DDMBlock));
+	for (size_t i = 0; i < blocks.size(); i++) {
+		padTo(out, blocks[i].offset);
+		if (block_data[i] || blocks[i].size == 0) {
+			out.submitExternal(block_data[i], blocks[i].size);
+			continue;
+		}
+		const size_t block_vertices = out.blockSize() / layout.stride;
+		for (size_t first = 0; first < num_vertices; first += block_vertices) {
+			const size_t count = std::min(block_vertices, num_vertices - first);
+			char* block = out.acquire();
+			QuantizeError error;
+			{
+				DD_PROFILE_SCOPE(profile.encode);
+				dd_quantizeVertices(mesh.data.data() + first, count, layout,
+									(uint8_t*)block, error, parse_threads);
+			}
+			dd_mergeError(quantize_error, error);
+			out.submit(block, count * layout.stride);
+		}
+	}
+	const bool ok = out.close();
+	DD_PROFILE_COUNT(profile.write, out.writeProfile());
+	if (!ok) {
+		printf("Failed writing %s\n", filename);
+		return 0;
+	}
+	return out.bytesWritten();
+}
+
+/// \brief Export mesh in the text .ddm layout. Returns bytes written
+/// (0 on failure)
+uint64_t DD_ObjConverter::exportText(const char* filename)
+{
+	DD_PROFILE_SCOPE(profile.format);
+	DD_TextWriter out(k_write_block_bytes);
+	if (!out.open(filename, options.pipeline ? options.pipeline_depth : 0)) {
+		printf("Could not open mesh output file\n" );
+		return 0;
 	}
 
 	// name
-	snprintf(lineBuff, sizeof(lineBuff), "%s", obj_id._str());
-	outfile << "<name>\n" << lineBuff << "\n</name>\n";
+	out.put("<name>\n");
+	out.put(obj_id._str());
+	out.put("\n</name>\n");
 	// buffer sizes
-	outfile << "<buffer>\n";
-	snprintf(lineBuff, sizeof(lineBuff), "v %lu", vertices.size());
-	outfile << lineBuff << "\n";
-	snprintf(lineBuff, sizeof(lineBuff), "e %lu", mesh_offset.size() - 1);
-	outfile << lineBuff << "\n";
-	snprintf(lineBuff, sizeof(lineBuff), "m 1");
-	outfile << lineBuff << "\n";
-	outfile << "</buffer>\n";
+	out.put("<buffer>\n");
+	out.put("v ");
+	out.putUnsigned(mesh.numVertices());
+	out.put("\ne ");
+	out.putUnsigned(numEbos());
+	out.put("\nm 1\n");
+	out.put("</buffer>\n");
 
 	// material data
-	outfile << "<material>\n";
-	snprintf(lineBuff, sizeof(lineBuff), "n %s", "default");
-	outfile << lineBuff << "\n";
+	out.put("<material>\n");
+	out.put("n default\n");
 	// vector properties
-	snprintf(lineBuff, sizeof(lineBuff), "d 0.500 0.500 0.500");
-	outfile << lineBuff << "\n";
-	snprintf(lineBuff, sizeof(lineBuff), "s 0.500 0.500 0.500");
-	outfile << lineBuff << "\n";
+	out.put("d 0.500 0.500 0.500\n");
+	out.put("s 0.500 0.500 0.500\n");
+	out.put("</material>\n");
 
-	outfile << "</material>\n";
+	/// \brief Lambda to write " %.3f" for each float
+	auto putFloats = [&](const float *vals, const unsigned count)
+	{
+		for (unsigned i = 0; i < count; i++) {
+			out.put(' ');
+			out.putFixed(vals[i], 3);
+		}
+		out.put('\n');
+	};
 
 	// vertex data
-	outfile << "<vertex>\n";
-	for (size_t i = 0; i < vertices.size(); i++) {
-		snprintf(lineBuff, sizeof(lineBuff), "v %.3f %.3f %.3f",
-				 vertices[i].position[0],
-				 vertices[i].position[1],
-				 vertices[i].position[2]);
-		outfile << lineBuff << "\n";
-		snprintf(lineBuff, sizeof(lineBuff), "n %.3f %.3f %.3f",
-				 vertices[i].normal[0],
-				 vertices[i].normal[1],
-				 vertices[i].normal[2]);
-		outfile << lineBuff << "\n";
-		snprintf(lineBuff, sizeof(lineBuff), "t %.3f %.3f %.3f",
-				 vertices[i].tangent[0],
-				 vertices[i].tangent[1],
-				 vertices[i].tangent[2]);
-		outfile << lineBuff << "\n";
-		snprintf(lineBuff, sizeof(lineBuff), "u %.3f %.3f",
-				 vertices[i].texCoords[0],
-				 vertices[i].texCoords[1]);
-		outfile << lineBuff << "\n";
-		snprintf(lineBuff, sizeof(lineBuff), "j 0 0 0 0");
-		outfile << lineBuff << "\n";
-		snprintf(lineBuff, sizeof(lineBuff), "b 0.000 0.000 0.000 0.000");
-		outfile << lineBuff << "\n";
-	}
-	outfile << "</vertex>\n";
+	out.put("<vertex>\n");
+	const bool soa = !mesh.streams.empty();
+	for (size_t i = 0; i < mesh.numVertices(); i++) {
+		const Vertex vert = soa ? dd_gatherVertex(mesh.streams, i) :
+								  mesh.data[i];
+		out.put('v');
+		putFloats(vert.position, 3);
+		out.put('n');
+		putFloats(vert.normal, 3);
+		out.put('t');
+		putFloats(vert.tangent, 3);
+		out.put('u');
+		putFloats(vert.texCoords, 2);
+		out.put("j 0 0 0 0\n");
+		out.put("b 0.000 0.000 0.000 0.000\n");
+	}
+	out.put("</vertex>\n");
 
 	// ebo data
-	unsigned idx_offset = 0;
-	for (size_t i = 0; i < mesh_offset.size() - 1; i++) {
-		outfile << "<ebo>\n";
-		unsigned e_size = mesh_offset[i + 1] - mesh_offset[i];
-		snprintf(lineBuff, sizeof(lineBuff), "s %u", e_size * 3);
-		outfile << lineBuff << "\n";
-		outfile << "m " << 0 << "\n"; // material index
-
-		printf("\nStart idx:\t%u\nEnd idx:\t%u\nSize:\t\t%u\n",
-			   mesh_offset[i],
-			   mesh_offset[i + 1],
-			   e_size * 3);
-		for (size_t j = 0; j < e_size; j++) {
-			snprintf(lineBuff, sizeof(lineBuff), "- %u %u %u",
-					 indices[j + idx_offset].data[0],
-					 indices[j + idx_offset].data[1],
-					 indices[j + idx_offset].data[2]);
-			outfile << lineBuff << "\n";
-		}
-		outfile << "</ebo>\n";
-		idx_offset += e_size;
-	}
-
-	outfile.close();
+	for (size_t i = 0; i < numEbos(); i++) {
+		out.put("<ebo>\n");
+		const unsigned e_size = mesh_offset[i + 1] - mesh_offset[i];
+		out.put("s ");
+		out.putUnsigned(e_size * 3);
+		out.put("\nm 0\n"); // material index
+
+		for (size_t j = mesh_offset[i]; j < mesh_offset[i + 1]; j++) {
+			out.put("- ");
+			out.putUnsigned(mesh.indices[j].data[0]);
+			out.put(' ');
+			out.putUnsigned(mesh.indices[j].data[1]);
+			out.put(' ');
+			out.putUnsigned(mesh.indices[j].data[2]);
+			out.put('\n');
+		}
+		out.put("</ebo>\n");
+	}
+
+	const bool ok = out.close();
+	DD_PROFILE_COUNT(profile.write, out.writeProfile());
+	if (!ok) {
+		printf("Failed writing %s\n", filename);
+		return 0;
+	}
+	return out.bytesWritten();
+}
+
+/// \brief Export mesh to format specified by dd_entity_map.txt. Writes
+/// <out_dir>/<name>.ddm (current directory if out_dir is null)
+bool DD_ObjConverter::exportMesh(const DDMFormat format, const char* out_dir)
+{
+	const auto export_start = std::chrono::high_resolution_clock::now();
+	const std::string filename = outputPath(out_dir);
+	profile.encode = ProfileStage();
+	profile.format = ProfileStage();
+	profile.write = ProfileStage();
+
+	bytes_written = (format == DDMFormat::BINARY) ?
+		exportBinary(filename.c_str()) : exportText(filename.c_str());
+
+	export_ms = std::chrono::duration<double, std::milli>(
+		std::chrono::high_resolution_clock::now() - export_start).count();
+	peak_rss = std::max<uint64_t>(peak_rss, dd_peakRSS());
+	return bytes_written > 0;
+}
+
+/// \brief Path exportMesh writes to for out_dir
+std::string DD_ObjConverter::outputPath(const char* out_dir) const
+{
+	std::string filename = out_dir ? out_dir : "";
+	if (!filename.empty() && filename.back() != '/' &&
+		filename.back() != '\\') {
+		filename += '/';
+	}
+	filename += obj_id._str();
+	filename += ".ddm";
+	return filename;
+}
+
+/// \brief Set mesh name (also the output file name)
+void DD_ObjConverter::setName(const char* name)
+{
+	obj_id.set(name);
+}
+
+ObjConvertStats DD_ObjConverter::stats() const
+{
+	ObjConvertStats out;
+	out.bytes_read = bytes_read;
+	out.bytes_written = bytes_written;
+	out.index_bytes = index_bytes;
+	out.vertex_stride = vertex_stride;
+	out.arena_bytes = arena_bytes;
+	out.peak_rss = peak_rss;
+	out.quantize_error = quantize_error;
+	out.import_ms = import_ms;
+	out.normal_ms = normal_ms;
+	out.tangent_ms = tangent_ms;
+	out.optimize_ms = optimize_ms;
+	out.export_ms = export_ms;
+	out.num_vertices = (unsigned)mesh.numVertices();
+	out.num_triangles = (unsigned)mesh.indices.size();
+	out.num_ebos = numEbos();
+	out.duplicated_vertices = duplicated_v;
+	out.generated_normals = generated_normals;
+	out.lod_error = lod_error;
+	out.lod_ms = lod_ms;
+	out.meshlet_ms = meshlet_ms;
+	out.num_meshlets = (unsigned)meshlets.meshlets.size();
+	out.bvh_ms = bvh_ms;
+	out.bvh_nodes = (unsigned)bvh.nodes.size();
+	bvhQuality(out.bvh_depth, out.bvh_sah_cost);
+	for (unsigned l = 0; l < numLods(); l++) {
+		out.lod_triangles.push_back(lod_offset[(l + 1) * numEbos()] -
+									lod_offset[l * numEbos()]);
+	}
+	out.parse_threads = parse_threads;
+	out.parse_chunks = parse_chunks;
+	out.cache_before = cache_before;
+	out.cache_after = cache_after;
+	out.profile = profile;
+	return out;
 }
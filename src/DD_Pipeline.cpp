@@ -0,0 +1,97 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include "DD_Pipeline.h"
+
+bool DD_WriteStage::open(const char* filename, const size_t block_size,
+						 const unsigned num_blocks)
+{
+	close();
+	m_file = fopen(filename, "wb");
+	m_block_size = block_size;
+	m_queued = 0;
+	m_written = 0;
+	m_good = (m_file != nullptr);
+	m_profile = ProfileStage();
+	if (!m_file) { return false; }
+
+	const unsigned blocks = (num_blocks == 0) ? 1 : num_blocks;
+	m_storage.resize(block_size * blocks);
+	m_free.reset(new dd_spsc_queue<char*>(blocks));
+	for (unsigned i = 0; i < blocks; i++) {
+		m_free->push(m_storage.data() + i * block_size);
+	}
+	if (num_blocks > 0) {
+		// external buffers queue up behind the blocks
+		m_pending.reset(new dd_spsc_queue<WriteItem>(2 * blocks + 16));
+		m_writer = std::thread(&DD_WriteStage::writerLoop, this);
+	}
+	return true;
+}
+
+bool DD_WriteStage::close()
+{
+	if (!m_file) { return m_good; }
+	if (m_writer.joinable()) {
+		m_pending->close();
+		m_writer.join();
+	}
+	m_pending.reset();
+	m_free.reset();
+	m_good = (fclose(m_file) == 0) && m_good;
+	m_file = nullptr;
+	return m_good;
+}
+
+char* DD_WriteStage::acquire()
+{
+	char* block = nullptr;
+	m_free->pop(block);
+	return block;
+}
+
+void DD_WriteStage::submit(char* block, const size_t len)
+{
+	const WriteItem item = { block, len, block };
+	m_queued += len;
+	if (m_pending) {
+		m_pending->push(item);
+	}
+	else {
+		write(item);
+	}
+}
+
+void DD_WriteStage::submitExternal(const void* data, const size_t len)
+{
+	if (len == 0) { return; }
+	const WriteItem item = { (const char*)data, len, nullptr };
+	m_queued += len;
+	if (m_pending) {
+		m_pending->push(item);
+	}
+	else {
+		write(item);
+	}
+}
+
+void DD_WriteStage::write(const WriteItem &item)
+{
+	if (item.len > 0 && m_good) {
+		DD_PROFILE_SCOPE(m_profile);
+		if (fwrite(item.data, 1, item.len, m_file) == item.len) {
+			m_written += item.len;
+		}
+		else {
+			m_good = false;
+		}
+	}
+	if (item.block) { m_free->push(item.block); }
+}
+
+void DD_WriteStage::writerLoop()
+{
+	WriteItem item;
+	while (m_pending->pop(item)) { write(item); }
+}
@@ -0,0 +1,91 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include "DD_ProcessMemory.h"
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+	#include <unistd.h>
+#endif
+
+namespace
+{
+#ifdef __linux__
+	/// \brief Value of a "<key>: <n> kB" line of /proc/self/status in bytes
+	uint64_t procStatus(const char* key)
+	{
+		FILE* file = fopen("/proc/self/status", "r");
+		if (!file) { return 0; }
+		const size_t key_len = strlen(key);
+		char line[256];
+		unsigned long long kb = 0;
+		while (fgets(line, sizeof(line), file)) {
+			if (strncmp(line, key, key_len) == 0 && line[key_len] == ':') {
+				sscanf(line + key_len + 1, "%llu", &kb);
+				break;
+			}
+		}
+		fclose(file);
+		return (uint64_t)kb * 1024;
+	}
+#endif
+}
+
+uint64_t dd_peakRSS()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+							  sizeof(counters))) {
+		return 0;
+	}
+	return (uint64_t)counters.PeakWorkingSetSize;
+#elif defined(__linux__)
+	return procStatus("VmHWM");
+#else
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+	#ifdef __APPLE__
+	return (uint64_t)usage.ru_maxrss;			// bytes
+	#else
+	return (uint64_t)usage.ru_maxrss * 1024;	// kB
+	#endif
+#endif
+}
+
+uint64_t dd_currentRSS()
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters,
+							  sizeof(counters))) {
+		return 0;
+	}
+	return (uint64_t)counters.WorkingSetSize;
+#elif defined(__linux__)
+	return procStatus("VmRSS");
+#else
+	return 0;
+#endif
+}
+
+bool dd_resetPeakRSS()
+{
+#ifdef __linux__
+	// "5" resets the peak RSS counter (Linux 4.0+)
+	FILE* file = fopen("/proc/self/clear_refs", "w");
+	if (!file) { return false; }
+	const bool ok = fputs("5", file) >= 0;
+	return (fclose(file) == 0) && ok;
+#else
+	return false;
+#endif
+}
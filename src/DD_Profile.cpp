@@ -0,0 +1,55 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include "DD_Profile.h"
+
+#if DD_PROFILE
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<uint64_t> g_allocs(0);
+	std::atomic<uint64_t> g_alloc_bytes(0);
+}
+
+void dd_allocCounts(uint64_t &allocs, uint64_t &bytes)
+{
+	allocs = g_allocs.load(std::memory_order_relaxed);
+	bytes = g_alloc_bytes.load(std::memory_order_relaxed);
+}
+
+// counting replacements of the global allocation functions. The array &
+// nothrow forms of the standard library forward to these
+void* operator new(std::size_t size)
+{
+	g_allocs.fetch_add(1, std::memory_order_relaxed);
+	g_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+	void* ptr = std::malloc(size ? size : 1);
+	if (!ptr) { throw std::bad_alloc(); }
+	return ptr;
+}
+
+void* operator new[](std::size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+	std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+	std::free(ptr);
+}
+#else
+void dd_allocCounts(uint64_t &allocs, uint64_t &bytes)
+{
+	allocs = 0;
+	bytes = 0;
+}
+#endif
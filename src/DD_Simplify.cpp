@@ -0,0 +1,345 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include "DD_Simplify.h"
+#include "DD_IndexMap.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	/// \brief Symmetric 4x4 error quadric (area weighted sum of planes)
+	struct Quadric
+	{
+		double a00 = 0, a01 = 0, a02 = 0, a11 = 0, a12 = 0, a22 = 0;
+		double b0 = 0, b1 = 0, b2 = 0;
+		double c = 0;
+		double weight = 0;
+
+		void add(const Quadric &q)
+		{
+			a00 += q.a00; a01 += q.a01; a02 += q.a02;
+			a11 += q.a11; a12 += q.a12; a22 += q.a22;
+			b0 += q.b0; b1 += q.b1; b2 += q.b2;
+			c += q.c;
+			weight += q.weight;
+		}
+
+		// weighted squared distance of p to the planes
+		double eval(const float* p) const
+		{
+			const double x = p[0], y = p[1], z = p[2];
+			return a00 * x * x + a11 * y * y + a22 * z * z +
+				   2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+				   2.0 * (b0 * x + b1 * y + b2 * z) + c;
+		}
+	};
+
+	/// \brief Quadric of the plane through a triangle, weighted by its area
+	Quadric planeQuadric(const float* p0, const float* p1, const float* p2)
+	{
+		const double e1[3] = { (double)p1[0] - p0[0], (double)p1[1] - p0[1],
+							   (double)p1[2] - p0[2] };
+		const double e2[3] = { (double)p2[0] - p0[0], (double)p2[1] - p0[1],
+							   (double)p2[2] - p0[2] };
+		double n[3] = { e1[1] * e2[2] - e1[2] * e2[1],
+						e1[2] * e2[0] - e1[0] * e2[2],
+						e1[0] * e2[1] - e1[1] * e2[0] };
+		const double len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		Quadric q;
+		if (!(len > 0.0)) { return q; }
+		n[0] /= len;
+		n[1] /= len;
+		n[2] /= len;
+		const double d = -(n[0] * p0[0] + n[1] * p0[1] + n[2] * p0[2]);
+		const double w = len * 0.5;
+		q.a00 = w * n[0] * n[0]; q.a01 = w * n[0] * n[1];
+		q.a02 = w * n[0] * n[2]; q.a11 = w * n[1] * n[1];
+		q.a12 = w * n[1] * n[2]; q.a22 = w * n[2] * n[2];
+		q.b0 = w * n[0] * d; q.b1 = w * n[1] * d; q.b2 = w * n[2] * d;
+		q.c = w * d * d;
+		q.weight = w;
+		return q;
+	}
+
+	struct Collapse
+	{
+		float cost;
+		unsigned from;
+		unsigned to;
+	};
+
+	/// \brief Working state of one triangle set (compact vertex ids)
+	struct SimplifyState
+	{
+		std::vector<unsigned>	global;		// local -> global vertex
+		std::vector<float>		pos;		// xyz per local vertex
+		std::vector<uint8_t>	locked;
+		std::vector<Quadric>	quadrics;
+		std::vector<unsigned>	tris;		// 3 per triangle
+		std::vector<unsigned>	adj_start;
+		std::vector<unsigned>	adj;
+		std::vector<Collapse>	collapses;
+		std::vector<unsigned>	collapse_to;
+		std::vector<uint8_t>	touched;
+		double					max_cost = 0.0;
+
+		inline const float* p(const unsigned v) const
+		{
+			return pos.data() + v * 3;
+		}
+
+		void buildAdjacency()
+		{
+			const unsigned nv = (unsigned)global.size();
+			adj_start.assign(nv + 1, 0);
+			for (const unsigned v : tris) { adj_start[v + 1]++; }
+			for (unsigned v = 0; v < nv; v++) {
+				adj_start[v + 1] += adj_start[v];
+			}
+			adj.resize(tris.size());
+			std::vector<unsigned> fill(adj_start.begin(), adj_start.end() - 1);
+			for (size_t i = 0; i < tris.size(); i++) {
+				adj[fill[tris[i]]++] = (unsigned)(i / 3);
+			}
+		}
+
+		/// \brief Would moving from onto to flip (or collapse to a line)
+		/// any triangle of from that survives?
+		bool flips(const unsigned from, const unsigned to) const
+		{
+			for (unsigned a = adj_start[from]; a < adj_start[from + 1]; a++) {
+				const unsigned* t = tris.data() + adj[a] * 3;
+				if (t[0] == to || t[1] == to || t[2] == to) { continue; }
+				const int k = (t[0] == from) ? 0 : ((t[1] == from) ? 1 : 2);
+				const float* pa = p(t[(k + 1) % 3]);
+				const float* pb = p(t[(k + 2) % 3]);
+				double n_old[3], n_new[3];
+				normal(p(from), pa, pb, n_old);
+				normal(p(to), pa, pb, n_new);
+				const double dot = n_old[0] * n_new[0] + n_old[1] * n_new[1] +
+								   n_old[2] * n_new[2];
+				if (!(dot > 0.0)) { return true; }
+			}
+			return false;
+		}
+
+		static void normal(const float* p0, const float* p1, const float* p2,
+						   double* n)
+		{
+			const double e1[3] = { (double)p1[0] - p0[0],
+								   (double)p1[1] - p0[1],
+								   (double)p1[2] - p0[2] };
+			const double e2[3] = { (double)p2[0] - p0[0],
+								   (double)p2[1] - p0[1],
+								   (double)p2[2] - p0[2] };
+			n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+			n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+			n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		}
+
+		/// \brief One pass of non-overlapping collapses. Returns triangles
+		/// removed
+		size_t pass(const size_t target, const double cost_limit)
+		{
+			const unsigned nv = (unsigned)global.size();
+			const size_t num_tris = tris.size() / 3;
+			buildAdjacency();
+
+			// cheapest valid collapse of each free vertex
+			collapses.clear();
+			for (unsigned v = 0; v < nv; v++) {
+				if (locked[v] || adj_start[v] == adj_start[v + 1]) {
+					continue;
+				}
+				Collapse best = { 0.f, v, v };
+				double best_cost = cost_limit;
+				for (unsigned a = adj_start[v]; a < adj_start[v + 1]; a++) {
+					const unsigned* t = tris.data() + adj[a] * 3;
+					for (int c = 0; c < 3; c++) {
+						const unsigned to = t[c];
+						if (to == v || to == best.to) { continue; }
+						Quadric q = quadrics[v];
+						q.add(quadrics[to]);
+						double cost = std::max(q.eval(p(to)), 0.0);
+						cost = (q.weight > 0.0) ? cost / q.weight : 0.0;
+						if (cost <= best_cost && !flips(v, to)) {
+							best_cost = cost;
+							best.to = to;
+							best.cost = (float)cost;
+						}
+					}
+				}
+				if (best.to != v) { collapses.push_back(best); }
+			}
+			std::sort(collapses.begin(), collapses.end(),
+				[](const Collapse &a, const Collapse &b) {
+					return a.cost < b.cost ||
+						   (a.cost == b.cost && a.from < b.from);
+				});
+
+			// apply the cheapest ones whose triangles don't overlap
+			touched.assign(nv, 0);
+			collapse_to.resize(nv);
+			for (unsigned v = 0; v < nv; v++) { collapse_to[v] = v; }
+			const size_t needed = num_tris - target;
+			size_t removed = 0;
+			for (const Collapse &col : collapses) {
+				if (removed >= needed) { break; }
+				if (touched[col.from] || touched[col.to]) { continue; }
+				bool free = true;
+				size_t dropped = 0;
+				for (unsigned a = adj_start[col.from];
+					 free && a < adj_start[col.from + 1]; a++) {
+					const unsigned* t = tris.data() + adj[a] * 3;
+					for (int c = 0; c < 3; c++) {
+						free = free && !touched[t[c]];
+						dropped += (t[c] == col.to) ? 1 : 0;
+					}
+				}
+				if (!free) { continue; }
+				for (unsigned a = adj_start[col.from];
+					 a < adj_start[col.from + 1]; a++) {
+					const unsigned* t = tris.data() + adj[a] * 3;
+					touched[t[0]] = touched[t[1]] = touched[t[2]] = 1;
+				}
+				collapse_to[col.from] = col.to;
+				quadrics[col.to].add(quadrics[col.from]);
+				max_cost = std::max(max_cost, (double)col.cost);
+				removed += dropped;
+			}
+			if (removed == 0) { return 0; }
+
+			// remap & drop triangles that became degenerate
+			size_t out = 0;
+			for (size_t t = 0; t < num_tris; t++) {
+				const unsigned a = collapse_to[tris[t * 3 + 0]];
+				const unsigned b = collapse_to[tris[t * 3 + 1]];
+				const unsigned c = collapse_to[tris[t * 3 + 2]];
+				if (a == b || b == c || a == c) { continue; }
+				tris[out * 3 + 0] = a;
+				tris[out * 3 + 1] = b;
+				tris[out * 3 + 2] = c;
+				out++;
+			}
+			tris.resize(out * 3);
+			return num_tris - out;
+		}
+	};
+}
+
+void dd_seamVertices(const Vertex* vertices, const size_t num_vertices,
+					 std::vector<uint8_t> &seam)
+{
+	seam.assign(num_vertices, 0);
+	dd_indexmap first;
+	first.reserve(num_vertices);
+	for (size_t v = 0; v < num_vertices; v++) {
+		unsigned key[3];
+		memcpy(key, vertices[v].position, sizeof(key));
+		bool inserted = false;
+		const unsigned other = first.findOrInsert(key[0], key[1], key[2],
+												  (unsigned)v, inserted);
+		if (!inserted) {
+			seam[v] = 1;
+			seam[other] = 1;
+		}
+	}
+}
+
+float dd_meshExtent(const Vertex* vertices, const size_t num_vertices)
+{
+	if (num_vertices == 0) { return 0.f; }
+	float lo[3], hi[3];
+	for (int i = 0; i < 3; i++) {
+		lo[i] = hi[i] = vertices[0].position[i];
+	}
+	for (size_t v = 1; v < num_vertices; v++) {
+		for (int i = 0; i < 3; i++) {
+			lo[i] = std::min(lo[i], vertices[v].position[i]);
+			hi[i] = std::max(hi[i], vertices[v].position[i]);
+		}
+	}
+	const float dx = hi[0] - lo[0], dy = hi[1] - lo[1], dz = hi[2] - lo[2];
+	return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+void dd_simplifyChain(const Vertex* vertices, const uint8_t* locked,
+					  const float extent, const vec3_u* triangles,
+					  const size_t num_triangles, const SimplifyLevel* levels,
+					  const size_t num_levels, std::vector<vec3_u>* out,
+					  float* error)
+{
+	SimplifyState st;
+
+	// compact vertex ids, skip degenerate input triangles
+	dd_indexmap ids;
+	ids.reserve(num_triangles);
+	st.tris.reserve(num_triangles * 3);
+	for (size_t t = 0; t < num_triangles; t++) {
+		const unsigned* v = triangles[t].data;
+		if (v[0] == v[1] || v[1] == v[2] || v[0] == v[2]) { continue; }
+		for (int c = 0; c < 3; c++) {
+			bool inserted = false;
+			const unsigned id = ids.findOrInsert(v[c], 0, 0,
+				(unsigned)st.global.size(), inserted);
+			if (inserted) { st.global.push_back(v[c]); }
+			st.tris.push_back(id);
+		}
+	}
+	const unsigned nv = (unsigned)st.global.size();
+	st.pos.resize(nv * 3);
+	st.locked.resize(nv);
+	for (unsigned v = 0; v < nv; v++) {
+		memcpy(&st.pos[v * 3], vertices[st.global[v]].position,
+			   3 * sizeof(float));
+		st.locked[v] = locked ? locked[st.global[v]] : 0;
+	}
+
+	// lock border & non-manifold edges (used by != 2 triangles)
+	std::vector<uint64_t> edges;
+	edges.reserve(st.tris.size());
+	for (size_t t = 0; t < st.tris.size(); t += 3) {
+		for (int c = 0; c < 3; c++) {
+			const uint64_t a = st.tris[t + c], b = st.tris[t + (c + 1) % 3];
+			edges.push_back(a < b ? (a << 32) | b : (b << 32) | a);
+		}
+	}
+	std::sort(edges.begin(), edges.end());
+	for (size_t i = 0; i < edges.size(); ) {
+		size_t j = i + 1;
+		while (j < edges.size() && edges[j] == edges[i]) { j++; }
+		if (j - i != 2) {
+			st.locked[(unsigned)(edges[i] >> 32)] = 1;
+			st.locked[(unsigned)(edges[i] & 0xFFFFFFFF)] = 1;
+		}
+		i = j;
+	}
+	std::vector<uint64_t>().swap(edges);
+
+	st.quadrics.resize(nv);
+	for (size_t t = 0; t < st.tris.size(); t += 3) {
+		const Quadric q = planeQuadric(st.p(st.tris[t]), st.p(st.tris[t + 1]),
+									   st.p(st.tris[t + 2]));
+		for (int c = 0; c < 3; c++) { st.quadrics[st.tris[t + c]].add(q); }
+	}
+
+	const size_t full = st.tris.size() / 3;
+	for (size_t l = 0; l < num_levels; l++) {
+		const size_t target = (size_t)(levels[l].ratio * full);
+		const double limit = (double)levels[l].max_error * extent;
+		while (st.tris.size() / 3 > target &&
+			   st.pass(target, limit * limit) > 0) {}
+
+		out[l].resize(st.tris.size() / 3);
+		for (size_t t = 0; t < out[l].size(); t++) {
+			for (int c = 0; c < 3; c++) {
+				out[l][t].data[c] = st.global[st.tris[t * 3 + c]];
+			}
+		}
+		error[l] = (extent > 0.f) ?
+			(float)(std::sqrt(st.max_cost) / extent) : 0.f;
+	}
+}
@@ -0,0 +1,250 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include "DD_StatsJson.h"
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+	/// \brief Minimal JSON output: nested objects/arrays, one value per
+	/// line. The first bracket is written as is (no indentation)
+	class JsonOut
+	{
+	public:
+		JsonOut(std::string &out, const unsigned indent) :
+			m_out(out), m_depth(indent) {}
+
+		// key is null inside arrays
+		void begin(const char* key, const char bracket)
+		{
+			item(key);
+			m_out += bracket;
+			m_depth++;
+			m_open++;
+			m_first = true;
+		}
+
+		void end(const char bracket)
+		{
+			m_depth--;
+			m_open--;
+			if (!m_first) { newline(); }
+			m_out += bracket;
+			m_first = false;
+		}
+
+		void number(const char* key, const double val)
+		{
+			item(key);
+			if (!std::isfinite(val)) {
+				m_out += "null";
+				return;
+			}
+			char buff[32];
+			snprintf(buff, sizeof(buff), "%.9g", val);
+			m_out += buff;
+		}
+
+		void integer(const char* key, const uint64_t val)
+		{
+			item(key);
+			char buff[24];
+			snprintf(buff, sizeof(buff), "%llu", (unsigned long long)val);
+			m_out += buff;
+		}
+
+		void boolean(const char* key, const bool val)
+		{
+			item(key);
+			m_out += val ? "true" : "false";
+		}
+
+		void string(const char* key, const char* val)
+		{
+			item(key);
+			quote(val);
+		}
+
+		void stage(const char* key, const ProfileStage &stage)
+		{
+			begin(key, '{');
+			number("ms", stage.ms);
+			integer("allocs", stage.allocs);
+			integer("alloc_bytes", stage.alloc_bytes);
+			end('}');
+		}
+
+	private:
+		void newline()
+		{
+			m_out += '\n';
+			m_out.append(m_depth, '\t');
+		}
+
+		void item(const char* key)
+		{
+			if (!m_first) { m_out += ','; }
+			if (m_open > 0) { newline(); }
+			m_first = false;
+			if (key) {
+				quote(key);
+				m_out += ": ";
+			}
+		}
+
+		void quote(const char* str)
+		{
+			m_out += '"';
+			for (; *str; str++) {
+				const unsigned char c = (unsigned char)*str;
+				if (c == '"' || c == '\\') {
+					m_out += '\\';
+					m_out += (char)c;
+				}
+				else if (c < 0x20) {
+					char buff[8];
+					snprintf(buff, sizeof(buff), "\\u%04x", c);
+					m_out += buff;
+				}
+				else {
+					m_out += (char)c;
+				}
+			}
+			m_out += '"';
+		}
+
+		std::string &m_out;
+		unsigned m_depth;		// indentation
+		unsigned m_open = 0;	// unclosed objects & arrays
+		bool m_first = true;
+	};
+}
+
+std::string dd_statsJson(const StatsJsonEntry &entry, const unsigned indent)
+{
+	const ObjConvertStats &stats = entry.stats;
+	const ObjConvertProfile &profile = stats.profile;
+
+	std::string text;
+	JsonOut json(text, indent);
+	json.begin(nullptr, '{');
+	json.string("input", entry.input.c_str());
+	json.string("status", entry.status);
+	json.boolean("cached", entry.cached);
+	json.number("total_ms", entry.total_ms);
+	json.integer("bytes_read", stats.bytes_read);
+	json.integer("bytes_written", stats.bytes_written);
+	json.integer("index_bytes", stats.index_bytes);
+	json.integer("vertex_stride", stats.vertex_stride);
+	json.integer("arena_bytes", stats.arena_bytes);
+	json.integer("peak_rss", stats.peak_rss);
+	json.integer("parse_threads", stats.parse_threads);
+	json.integer("parse_chunks", stats.parse_chunks);
+	json.integer("num_vertices", stats.num_vertices);
+	json.integer("num_triangles", stats.num_triangles);
+	json.integer("num_ebos", stats.num_ebos);
+	json.integer("duplicated_vertices", stats.duplicated_vertices);
+	json.integer("generated_normals", stats.generated_normals);
+	json.integer("num_meshlets", stats.num_meshlets);
+	json.integer("bvh_nodes", stats.bvh_nodes);
+	json.integer("bvh_depth", stats.bvh_depth);
+	json.number("bvh_sah_cost", stats.bvh_sah_cost);
+
+	json.begin("lods", '[');
+	for (size_t l = 0; l < stats.lod_triangles.size(); l++) {
+		json.begin(nullptr, '{');
+		json.integer("triangles", stats.lod_triangles[l]);
+		json.number("error", (l < stats.lod_error.size()) ?
+							 stats.lod_error[l] : 0.0);
+		json.end('}');
+	}
+	json.end(']');
+
+	json.begin("times_ms", '{');
+	json.number("import", stats.import_ms);
+	json.number("normal", stats.normal_ms);
+	json.number("tangent", stats.tangent_ms);
+	json.number("optimize", stats.optimize_ms);
+	json.number("lod", stats.lod_ms);
+	json.number("meshlet", stats.meshlet_ms);
+	json.number("bvh", stats.bvh_ms);
+	json.number("export", stats.export_ms);
+	json.end('}');
+
+	json.begin("quantize_error", '{');
+	json.number("position", stats.quantize_error.position);
+	json.number("normal_deg", stats.quantize_error.normal_deg);
+	json.number("tangent_deg", stats.quantize_error.tangent_deg);
+	json.number("texcoord", stats.quantize_error.texcoord);
+	json.end('}');
+
+	json.begin("vertex_cache", '{');
+	json.number("acmr_before", stats.cache_before.acmr());
+	json.number("acmr_after", stats.cache_after.acmr());
+	json.number("atvr_before", stats.cache_before.atvr());
+	json.number("atvr_after", stats.cache_after.atvr());
+	json.end('}');
+
+	json.begin("profile", '{');
+	json.boolean("enabled", profile.enabled);
+	json.begin("stages", '{');
+	json.stage("read", profile.read);
+	json.stage("scan", profile.scan);
+	json.stage("parse", profile.parse);
+	json.stage("dedup", profile.dedup);
+	json.stage("encode", profile.encode);
+	json.stage("format", profile.format);
+	json.stage("write", profile.write);
+	json.end('}');
+	json.begin("lines", '{');
+	json.integer("v", profile.lines.v);
+	json.integer("vt", profile.lines.vt);
+	json.integer("vn", profile.lines.vn);
+	json.integer("f", profile.lines.f);
+	json.integer("usemtl", profile.lines.usemtl);
+	json.integer("other", profile.lines.other);
+	json.end('}');
+	json.integer("corners", profile.corners);
+	json.integer("polygons", profile.polygons);
+	json.begin("dedup", '{');
+	json.integer("lookups", profile.dedup_lookups);
+	json.integer("probes", profile.dedup_probes);
+	json.integer("inserts", profile.dedup_inserts);
+	json.end('}');
+	json.end('}');
+
+	json.end('}');
+	return text;
+}
+
+bool dd_writeStatsJson(const char* filename,
+					   const std::vector<StatsJsonEntry> &entries,
+					   const bool as_array)
+{
+	std::string text;
+	if (as_array) {
+		text += "[";
+		for (size_t i = 0; i < entries.size(); i++) {
+			text += i ? ",\n\t" : "\n\t";
+			text += dd_statsJson(entries[i], 1);
+		}
+		text += entries.empty() ? "]\n" : "\n]\n";
+	}
+	else if (!entries.empty()) {
+		text = dd_statsJson(entries[0]) + "\n";
+	}
+
+	FILE* file = fopen(filename, "w");
+	if (!file) {
+		printf("Cannot open %s\n", filename);
+		return false;
+	}
+	const bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+	if ((fclose(file) != 0) || !ok) {
+		printf("Failed writing %s\n", filename);
+		return false;
+	}
+	return true;
+}
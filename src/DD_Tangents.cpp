@@ -0,0 +1,215 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include "DD_Tangents.h"
+#include "DD_Parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+namespace
+{
+	// triangles w/ smaller uv area than this have no usable tangent frame
+	const float k_min_uv_det = 1e-12f;
+
+	/// \brief Structure-of-arrays xyz stream
+	struct Stream3
+	{
+		std::vector<float> x, y, z;
+		void resize(const size_t n)
+		{
+			x.assign(n, 0.f);
+			y.assign(n, 0.f);
+			z.assign(n, 0.f);
+		}
+	};
+}
+
+void dd_computeTangents(Vertex* vertices, const size_t num_vertices,
+						const vec3_u* triangles, const size_t num_triangles,
+						const unsigned num_threads)
+{
+	// per-triangle area weighted tangent & bitangent directions
+	Stream3 face_t, face_b;
+	face_t.resize(num_triangles);
+	face_b.resize(num_triangles);
+
+	dd_parallel_for(num_triangles, num_threads,
+		[&](const size_t begin, const size_t end, const unsigned) {
+			float *ftx = face_t.x.data(), *fty = face_t.y.data(),
+				  *ftz = face_t.z.data();
+			float *fbx = face_b.x.data(), *fby = face_b.y.data(),
+				  *fbz = face_b.z.data();
+			for (size_t i = begin; i < end; i++) {
+				const Vertex &v1 = vertices[triangles[i].data[0]];
+				const Vertex &v2 = vertices[triangles[i].data[1]];
+				const Vertex &v3 = vertices[triangles[i].data[2]];
+
+				// edge and uv (direction) info
+				const float e1x = v2.position[0] - v1.position[0];
+				const float e1y = v2.position[1] - v1.position[1];
+				const float e1z = v2.position[2] - v1.position[2];
+				const float e2x = v3.position[0] - v1.position[0];
+				const float e2y = v3.position[1] - v1.position[1];
+				const float e2z = v3.position[2] - v1.position[2];
+				const float du1 = v2.texCoords[0] - v1.texCoords[0];
+				const float dv1 = v2.texCoords[1] - v1.texCoords[1];
+				const float du2 = v3.texCoords[0] - v1.texCoords[0];
+				const float dv2 = v3.texCoords[1] - v1.texCoords[1];
+
+				// tangent = (e1 * dv2 - e2 * dv1) / det,
+				// bitangent = (e2 * du1 - e1 * du2) / det
+				const float det = du1 * dv2 - du2 * dv1;
+				const float sign = (det < 0.f) ? -1.f : 1.f;
+				const float tx = (e1x * dv2 - e2x * dv1) * sign;
+				const float ty = (e1y * dv2 - e2y * dv1) * sign;
+				const float tz = (e1z * dv2 - e2z * dv1) * sign;
+				const float bx = (e2x * du1 - e1x * du2) * sign;
+				const float by = (e2y * du1 - e1y * du2) * sign;
+				const float bz = (e2z * du1 - e1z * du2) * sign;
+
+				// weight unit directions by triangle area
+				const float cx = e1y * e2z - e1z * e2y;
+				const float cy = e1z * e2x - e1x * e2z;
+				const float cz = e1x * e2y - e1y * e2x;
+				const float area =
+					0.5f * std::sqrt(cx * cx + cy * cy + cz * cz);
+				const float t_len = std::sqrt(tx * tx + ty * ty + tz * tz);
+				const float b_len = std::sqrt(bx * bx + by * by + bz * bz);
+				const bool valid = std::fabs(det) > k_min_uv_det &&
+								   t_len > 0.f && b_len > 0.f;
+				const float t_w = valid ? area / t_len : 0.f;
+				const float b_w = valid ? area / b_len : 0.f;
+
+				ftx[i] = tx * t_w;
+				fty[i] = ty * t_w;
+				ftz[i] = tz * t_w;
+				fbx[i] = bx * b_w;
+				fby[i] = by * b_w;
+				fbz[i] = bz * b_w;
+			}
+		});
+
+	// accumulate per vertex, each vertex summing its triangles in triangle
+	// order so results don't depend on the thread count. 1 thread adds
+	// triangle by triangle. Otherwise every vertex gathers its own
+	// triangles, in parallel: lists of each vertex's triangles (count,
+	// offsets, scatter w/ atomic cursors), sorted, then summed
+	const unsigned threads = num_threads ? num_threads : dd_hardware_threads();
+	Stream3 acc_t, acc_b;
+	acc_t.resize(num_vertices);
+	acc_b.resize(num_vertices);
+	if (threads == 1 || num_triangles < 2) {
+		for (size_t i = 0; i < num_triangles; i++) {
+			for (int c = 0; c < 3; c++) {
+				const unsigned v = triangles[i].data[c];
+				acc_t.x[v] += face_t.x[i];
+				acc_t.y[v] += face_t.y[i];
+				acc_t.z[v] += face_t.z[i];
+				acc_b.x[v] += face_b.x[i];
+				acc_b.y[v] += face_b.y[i];
+				acc_b.z[v] += face_b.z[i];
+			}
+		}
+	}
+	else {
+		std::unique_ptr<std::atomic<unsigned>[]> cursor(
+			new std::atomic<unsigned>[num_vertices]());
+		auto scatter = [&](unsigned* list) {
+			dd_parallel_for(num_triangles, threads,
+				[&](const size_t begin, const size_t end, const unsigned) {
+					for (size_t i = begin; i < end; i++) {
+						for (int c = 0; c < 3; c++) {
+							const unsigned slot = cursor[triangles[i].data[c]]
+								.fetch_add(1, std::memory_order_relaxed);
+							if (list) { list[slot] = (unsigned)i; }
+						}
+					}
+				});
+		};
+		scatter(nullptr);
+		std::vector<unsigned> vert_start(num_vertices + 1);
+		unsigned sum = 0;
+		for (size_t v = 0; v < num_vertices; v++) {
+			vert_start[v] = sum;
+			sum += cursor[v].load(std::memory_order_relaxed);
+			cursor[v].store(vert_start[v], std::memory_order_relaxed);
+		}
+		vert_start[num_vertices] = sum;
+		std::vector<unsigned> vert_tris(sum);
+		scatter(vert_tris.data());
+
+		dd_parallel_for(num_vertices, threads,
+			[&](const size_t begin, const size_t end, const unsigned) {
+				for (size_t v = begin; v < end; v++) {
+					unsigned* tris = vert_tris.data() + vert_start[v];
+					unsigned* tris_end = vert_tris.data() + vert_start[v + 1];
+					std::sort(tris, tris_end);
+					for (; tris != tris_end; tris++) {
+						acc_t.x[v] += face_t.x[*tris];
+						acc_t.y[v] += face_t.y[*tris];
+						acc_t.z[v] += face_t.z[*tris];
+						acc_b.x[v] += face_b.x[*tris];
+						acc_b.y[v] += face_b.y[*tris];
+						acc_b.z[v] += face_b.z[*tris];
+					}
+				}
+			});
+	}
+
+	// Gram-Schmidt against the normal & bitangent sign
+	dd_parallel_for(num_vertices, threads,
+		[&](const size_t begin, const size_t end, const unsigned) {
+			for (size_t i = begin; i < end; i++) {
+				Vertex &vert = vertices[i];
+				float nx = vert.normal[0];
+				float ny = vert.normal[1];
+				float nz = vert.normal[2];
+				const float n_len = std::sqrt(nx * nx + ny * ny + nz * nz);
+				if (n_len > 0.f) {
+					nx /= n_len;
+					ny /= n_len;
+					nz /= n_len;
+				}
+				float tx = acc_t.x[i], ty = acc_t.y[i], tz = acc_t.z[i];
+
+				const float n_dot_t = nx * tx + ny * ty + nz * tz;
+				tx -= nx * n_dot_t;
+				ty -= ny * n_dot_t;
+				tz -= nz * n_dot_t;
+				float len = std::sqrt(tx * tx + ty * ty + tz * tz);
+				if (!(len > 1e-20f)) {
+					// no tangent information: any vector perpendicular to n
+					// (n x X, or n x Y when n is close to X)
+					if (std::fabs(nx) < 0.9f) {
+						tx = 0.f; ty = nz; tz = -ny;
+					}
+					else {
+						tx = -nz; ty = 0.f; tz = nx;
+					}
+					len = std::sqrt(tx * tx + ty * ty + tz * tz);
+					if (!(len > 1e-20f)) {
+						tx = 1.f; ty = 0.f; tz = 0.f; len = 1.f;
+					}
+				}
+				tx /= len;
+				ty /= len;
+				tz /= len;
+
+				// handedness: does (n x t) point along the bitangent?
+				const float bx = ny * tz - nz * ty;
+				const float by = nz * tx - nx * tz;
+				const float bz = nx * ty - ny * tx;
+				const float b_dot = bx * acc_b.x[i] + by * acc_b.y[i] +
+									bz * acc_b.z[i];
+
+				vert.tangent[0] = tx;
+				vert.tangent[1] = ty;
+				vert.tangent[2] = tz;
+				vert.tangent[3] = (b_dot < 0.f) ? -1.f : 1.f;
+			}
+		});
+}
@@ -0,0 +1,74 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include "DD_TextWriter.h"
+#include <cmath>
+
+bool DD_TextWriter::open(const char* filename,
+						 const unsigned pipeline_blocks)
+{
+	close();
+	m_pos = 0;
+	m_good = m_stage.open(filename, m_block_size, pipeline_blocks);
+	m_block = m_good ? m_stage.acquire() : nullptr;
+	return m_good;
+}
+
+bool DD_TextWriter::close()
+{
+	if (m_block) {
+		m_stage.submit(m_block, m_pos);
+		m_block = nullptr;
+		m_pos = 0;
+		m_good = m_stage.close() && m_good;
+	}
+	return m_good;
+}
+
+void DD_TextWriter::flush()
+{
+	m_stage.submit(m_block, m_pos);
+	m_block = m_stage.acquire();
+	m_pos = 0;
+}
+
+/// \brief Matches printf("%.*f", precision, val) byte for byte.
+/// A float times 10^p (p <= 9) is exact in a double (24 + 21 mantissa bits),
+/// so rounding the scaled value half-to-even (printf's rule for exact ties)
+/// gives the same digits. NaN/inf and huge values go through snprintf
+void DD_TextWriter::putFixed(const float val, const unsigned precision)
+{
+	static const uint64_t k_pow10[] = {
+		1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull, 1000000ull,
+		10000000ull, 100000000ull, 1000000000ull };
+
+	const double d = val;
+	const unsigned p = (precision < 9) ? precision : 9;
+	const double scaled = std::fabs(d) * (double)k_pow10[p];
+	if (precision > 9 || !(scaled < 9.2e18)) {	// also catches NaN
+		char tmp[512];
+		const int len = snprintf(tmp, sizeof(tmp), "%.*f", (int)precision, d);
+		put(tmp, (len > 0) ? (size_t)len : 0);
+		return;
+	}
+
+	uint64_t n = (uint64_t)scaled;
+	const double rem = scaled - (double)n;
+	if (rem > 0.5 || (rem == 0.5 && (n & 1))) { n++; }
+
+	reserve(k_max_number);
+	if (std::signbit(d)) { m_block[m_pos++] = '-'; }
+
+	const uint64_t p10 = k_pow10[precision];
+	putUnsigned(n / p10);
+	if (precision > 0) {
+		uint64_t frac = n % p10;
+		m_block[m_pos++] = '.';
+		for (unsigned i = precision; i > 0; i--) {
+			m_block[m_pos + i - 1] = (char)('0' + frac % 10);
+			frac /= 10;
+		}
+		m_pos += precision;
+	}
+}
@@ -0,0 +1,504 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include "DD_VertexQuantize.h"
+#include "DD_Parallel.h"
+#include "DD_VertexStreams.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace
+{
+	const double k_rad_to_deg = 57.29577951308232;
+
+	/// \brief An attribute's floats: in interleaved Vertex records or in a
+	/// packed stream (stride in floats)
+	struct AttribSource
+	{
+		const float*	data;
+		size_t			stride;
+
+		inline const float* at(const size_t v) const
+		{
+			return data + v * stride;
+		}
+	};
+
+	struct VertexSource
+	{
+		size_t			num_vertices;
+		AttribSource	position;
+		AttribSource	normal;
+		AttribSource	texcoord;
+		AttribSource	tangent;
+	};
+
+	VertexSource interleavedSource(const Vertex* vertices,
+								   const size_t num_vertices)
+	{
+		const size_t stride = sizeof(Vertex) / sizeof(float);
+		auto field = [&](const size_t offset) {
+			const AttribSource src = {
+				(const float*)((const uint8_t*)vertices + offset), stride };
+			return src;
+		};
+		const VertexSource source = {
+			num_vertices,
+			field(offsetof(Vertex, position)),
+			field(offsetof(Vertex, normal)),
+			field(offsetof(Vertex, texCoords)),
+			field(offsetof(Vertex, tangent))
+		};
+		return source;
+	}
+
+	VertexSource streamSource(const VertexStreams &streams)
+	{
+		const VertexSource source = {
+			streams.size(),
+			{ streams.position.data(), 3 },
+			{ streams.normal.data(), 3 },
+			{ streams.texcoord.data(), 2 },
+			{ streams.tangent.data(), 4 }
+		};
+		return source;
+	}
+
+	uint32_t formatSize(const uint32_t format)
+	{
+		switch (format) {
+			case DDM_FORMAT_FLOAT32x2:		return 8;
+			case DDM_FORMAT_FLOAT32x3:		return 12;
+			case DDM_FORMAT_FLOAT32x4:		return 16;
+			case DDM_FORMAT_FLOAT16x2:		return 4;
+			case DDM_FORMAT_FLOAT16x4:		return 8;
+			case DDM_FORMAT_UNORM16x2:		return 4;
+			case DDM_FORMAT_UNORM16x4:		return 8;
+			case DDM_FORMAT_OCT_SNORM16x2:	return 4;
+			case DDM_FORMAT_OCT_SNORM16x4:	return 8;
+			case DDM_FORMAT_SNORM10x3_2:	return 4;
+		}
+		return 0;
+	}
+
+	uint32_t directionFormat(const DirectionEncoding enc, const bool tangent)
+	{
+		switch (enc) {
+			case DirectionEncoding::OCT_SNORM16:
+				return tangent ? DDM_FORMAT_OCT_SNORM16x4 :
+								 DDM_FORMAT_OCT_SNORM16x2;
+			case DirectionEncoding::SNORM10:
+				return DDM_FORMAT_SNORM10x3_2;
+			default:
+				return tangent ? DDM_FORMAT_FLOAT32x4 : DDM_FORMAT_FLOAT32x3;
+		}
+	}
+
+	inline float clampUnit(const float val)
+	{
+		return val < -1.f ? -1.f : (val > 1.f ? 1.f : val);
+	}
+
+	inline float signOf(const float val) { return val < 0.f ? -1.f : 1.f; }
+
+	/// \brief Unit vector -> octahedral snorm16 pair
+	void octEncode(const float* dir, int16_t* out)
+	{
+		const float l1 = std::fabs(dir[0]) + std::fabs(dir[1]) +
+						 std::fabs(dir[2]);
+		if (!(l1 > 0.f)) {
+			out[0] = out[1] = 0;
+			return;
+		}
+		float x = dir[0] / l1, y = dir[1] / l1;
+		if (dir[2] < 0.f) {
+			// fold the lower hemisphere over the diagonals
+			const float fx = (1.f - std::fabs(y)) * signOf(x);
+			const float fy = (1.f - std::fabs(x)) * signOf(y);
+			x = fx;
+			y = fy;
+		}
+		out[0] = (int16_t)std::lround(clampUnit(x) * 32767.f);
+		out[1] = (int16_t)std::lround(clampUnit(y) * 32767.f);
+	}
+
+	void octDecode(const int16_t* in, float* dir)
+	{
+		float x = std::max(in[0] / 32767.f, -1.f);
+		float y = std::max(in[1] / 32767.f, -1.f);
+		const float z = 1.f - std::fabs(x) - std::fabs(y);
+		if (z < 0.f) {
+			const float fx = (1.f - std::fabs(y)) * signOf(x);
+			const float fy = (1.f - std::fabs(x)) * signOf(y);
+			x = fx;
+			y = fy;
+		}
+		dir[0] = x;
+		dir[1] = y;
+		dir[2] = z;
+	}
+
+	uint32_t snorm10Encode(const float* dir, const float w)
+	{
+		uint32_t out = 0;
+		for (int i = 0; i < 3; i++) {
+			const int32_t q = (int32_t)std::lround(clampUnit(dir[i]) * 511.f);
+			out |= ((uint32_t)q & 0x3FF) << (i * 10);
+		}
+		const int32_t qw = (w < 0.f) ? -1 : (w > 0.f ? 1 : 0);
+		return out | (((uint32_t)qw & 0x3) << 30);
+	}
+
+	void snorm10Decode(const uint32_t val, float* dir)
+	{
+		for (int i = 0; i < 3; i++) {
+			int32_t q = (int32_t)((val >> (i * 10)) & 0x3FF);
+			q = (q & 0x200) ? q - 0x400 : q;	// sign extend
+			dir[i] = std::max(q / 511.f, -1.f);
+		}
+	}
+
+	/// \brief Angle in degrees between two (not necessarily unit) vectors.
+	/// 0 if either is zero length
+	float angleDeg(const float* a, const float* b)
+	{
+		const double cx = (double)a[1] * b[2] - (double)a[2] * b[1];
+		const double cy = (double)a[2] * b[0] - (double)a[0] * b[2];
+		const double cz = (double)a[0] * b[1] - (double)a[1] * b[0];
+		const double dot = (double)a[0] * b[0] + (double)a[1] * b[1] +
+						   (double)a[2] * b[2];
+		const double cross = std::sqrt(cx * cx + cy * cy + cz * cz);
+		if (cross == 0.0 && dot == 0.0) { return 0.f; }
+		return (float)(std::atan2(cross, dot) * k_rad_to_deg);
+	}
+
+	/// \brief Encode a normal or tangent (w = bitangent sign, 0 for normals)
+	/// Returns the angular error
+	float encodeDirection(const uint32_t format, const float* dir,
+						  const float w, uint8_t* dst)
+	{
+		float decoded[3];
+		switch (format) {
+			case DDM_FORMAT_OCT_SNORM16x2:
+			case DDM_FORMAT_OCT_SNORM16x4: {
+				int16_t q[4] = { 0, 0, 0, 0 };
+				octEncode(dir, q);
+				q[2] = (w < 0.f) ? -32767 : 32767;
+				memcpy(dst, q, formatSize(format));
+				octDecode(q, decoded);
+				break;
+			}
+			case DDM_FORMAT_SNORM10x3_2: {
+				const uint32_t q = snorm10Encode(dir, w);
+				memcpy(dst, &q, sizeof(q));
+				snorm10Decode(q, decoded);
+				break;
+			}
+			default: {
+				float vals[4] = { dir[0], dir[1], dir[2], w };
+				memcpy(dst, vals, formatSize(format));
+				return 0.f;
+			}
+		}
+		return angleDeg(dir, decoded);
+	}
+
+	/// \brief Encode count floats (over range for unorm16). Fills the
+	/// remaining components of a 4 wide format w/ w_fill. Returns max error
+	float encodeValues(const uint32_t format, const float* vals,
+					   const int count, const DDMAttribRange &range,
+					   const float w_fill, uint8_t* dst)
+	{
+		float error = 0.f;
+		const int width = (format == DDM_FORMAT_FLOAT16x4 ||
+						   format == DDM_FORMAT_UNORM16x4) ? 4 : count;
+		switch (format) {
+			case DDM_FORMAT_FLOAT16x2:
+			case DDM_FORMAT_FLOAT16x4: {
+				uint16_t q[4];
+				for (int i = 0; i < width; i++) {
+					q[i] = dd_floatToHalf(i < count ? vals[i] : w_fill);
+					if (i < count) {
+						error = std::max(error,
+							std::fabs(dd_halfToFloat(q[i]) - vals[i]));
+					}
+				}
+				memcpy(dst, q, width * sizeof(uint16_t));
+				break;
+			}
+			case DDM_FORMAT_UNORM16x2:
+			case DDM_FORMAT_UNORM16x4: {
+				uint16_t q[4] = { 0, 0, 0, 0 };
+				for (int i = 0; i < count; i++) {
+					const float extent = range.max[i] - range.min[i];
+					float t = (extent > 0.f) ?
+						(vals[i] - range.min[i]) / extent : 0.f;
+					t = std::min(std::max(t, 0.f), 1.f);
+					q[i] = (uint16_t)std::lround(t * 65535.f);
+					const float decoded = range.min[i] +
+						(q[i] / 65535.f) * extent;
+					error = std::max(error, std::fabs(decoded - vals[i]));
+				}
+				memcpy(dst, q, width * sizeof(uint16_t));
+				break;
+			}
+			default:
+				memcpy(dst, vals, count * sizeof(float));
+				break;
+		}
+		return error;
+	}
+}
+
+uint16_t dd_floatToHalf(const float val)
+{
+	uint32_t bits;
+	memcpy(&bits, &val, sizeof(bits));
+	const uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+	uint32_t abs = bits & 0x7FFFFFFF;
+
+	if (abs >= 0x7F800000) {	// inf / nan
+		return sign | ((abs > 0x7F800000) ? 0x7E00 : 0x7C00);
+	}
+	if (abs >= 0x477FF000) {	// rounds past 65504
+		return sign | 0x7C00;
+	}
+	if (abs < 0x38800000) {		// half subnormal (or zero)
+		float mag;
+		memcpy(&mag, &abs, sizeof(mag));
+		return sign | (uint16_t)std::lrint(mag * 16777216.f);
+	}
+	// rebias exponent, round mantissa to nearest even
+	abs += 0xC8000FFF + ((abs >> 13) & 1);
+	return sign | (uint16_t)(abs >> 13);
+}
+
+float dd_halfToFloat(const uint16_t val)
+{
+	const uint32_t sign = (uint32_t)(val & 0x8000) << 16;
+	const uint32_t exp = (val >> 10) & 0x1F;
+	const uint32_t mant = val & 0x3FF;
+	if (exp == 0) {
+		const float mag = mant / 16777216.f;
+		return sign ? -mag : mag;
+	}
+	const uint32_t bits = (exp == 31) ?
+		sign | 0x7F800000 | (mant << 13) :
+		sign | ((exp + 112) << 23) | (mant << 13);
+	float out;
+	memcpy(&out, &bits, sizeof(out));
+	return out;
+}
+
+bool VertexLayout::isRawVertex() const
+{
+	if (split || num_attribs != 4 || stride != sizeof(Vertex)) {
+		return false;
+	}
+	const uint32_t raw[4][2] = {
+		{ DDM_FORMAT_FLOAT32x3, (uint32_t)offsetof(Vertex, position) },
+		{ DDM_FORMAT_FLOAT32x3, (uint32_t)offsetof(Vertex, normal) },
+		{ DDM_FORMAT_FLOAT32x2, (uint32_t)offsetof(Vertex, texCoords) },
+		{ DDM_FORMAT_FLOAT32x4, (uint32_t)offsetof(Vertex, tangent) }
+	};
+	for (unsigned i = 0; i < 4; i++) {
+		if (attribs[i].format != raw[i][0] || attribs[i].offset != raw[i][1]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool VertexLayout::isRawStreams() const
+{
+	if (!split) { return false; }
+	for (unsigned a = 0; a < num_attribs; a++) {
+		const uint32_t format = attribs[a].format;
+		if (format != DDM_FORMAT_FLOAT32x2 && format != DDM_FORMAT_FLOAT32x3 &&
+			format != DDM_FORMAT_FLOAT32x4) {
+			return false;
+		}
+	}
+	return true;
+}
+
+uint64_t VertexLayout::streamOffset(const unsigned a,
+									const size_t num_vertices) const
+{
+	uint64_t offset = 0;
+	for (unsigned b = 0; b < a; b++) {
+		offset += (uint64_t)attribs[b].stride * num_vertices;
+	}
+	return offset;
+}
+
+VertexLayout dd_vertexLayout(const VertexEncoding &enc, const bool has_normals,
+							 const bool has_texcoords, const bool split)
+{
+	VertexLayout layout;
+	layout.split = split;
+	auto add = [&](const uint32_t semantic, const uint32_t format) {
+		DDMVertexAttrib &attrib = layout.attribs[layout.num_attribs];
+		attrib.semantic = semantic;
+		attrib.format = format;
+		attrib.offset = split ? 0 : layout.stride;
+		attrib.stride = split ? formatSize(format) : 0;
+
+		DDMAttribRange &range = layout.ranges[layout.num_attribs];
+		memset(&range, 0, sizeof(range));
+		range.semantic = semantic;
+		for (int i = 0; i < 4; i++) {
+			range.min[i] = -1.f;
+			range.max[i] = 1.f;
+		}
+		layout.stride += formatSize(format);
+		layout.num_attribs++;
+	};
+
+	const uint32_t pos_format[] = {
+		DDM_FORMAT_FLOAT32x3, DDM_FORMAT_FLOAT16x4, DDM_FORMAT_UNORM16x4
+	};
+	const uint32_t uv_format[] = {
+		DDM_FORMAT_FLOAT32x2, DDM_FORMAT_FLOAT16x2, DDM_FORMAT_UNORM16x2
+	};
+	add(DDM_ATTRIB_POSITION, pos_format[(int)enc.position]);
+	if (has_normals) {
+		add(DDM_ATTRIB_NORMAL, directionFormat(enc.normal, false));
+	}
+	if (has_texcoords) {
+		add(DDM_ATTRIB_TEXCOORD, uv_format[(int)enc.texcoord]);
+	}
+	if (has_normals && has_texcoords) {
+		add(DDM_ATTRIB_TANGENT, directionFormat(enc.tangent, true));
+	}
+	return layout;
+}
+
+namespace
+{
+	void vertexRanges(const VertexSource &source, VertexLayout &layout)
+	{
+		for (unsigned a = 0; a < layout.num_attribs; a++) {
+			DDMAttribRange &range = layout.ranges[a];
+			const uint32_t semantic = layout.attribs[a].semantic;
+			if (semantic != DDM_ATTRIB_POSITION &&
+				semantic != DDM_ATTRIB_TEXCOORD) {
+				continue;
+			}
+			const bool position = semantic == DDM_ATTRIB_POSITION;
+			const AttribSource &src = position ? source.position :
+												 source.texcoord;
+			const unsigned count = position ? 3 : 2;
+			dd_streamBounds(src.data, source.num_vertices, count, src.stride,
+							range.min, range.max);
+			for (unsigned i = count; i < 4; i++) {
+				range.min[i] = 0.f;
+				range.max[i] = 0.f;
+			}
+		}
+	}
+
+	void quantizeVertices(const VertexSource &source,
+						  const VertexLayout &layout, uint8_t* out,
+						  QuantizeError &error, const unsigned num_threads)
+	{
+		const size_t num_vertices = source.num_vertices;
+		// attribute a of vertex v: base[a] + v * step[a]
+		uint64_t base[4];
+		uint32_t step[4];
+		for (unsigned a = 0; a < layout.num_attribs; a++) {
+			base[a] = layout.split ? layout.streamOffset(a, num_vertices) :
+									 layout.attribs[a].offset;
+			step[a] = layout.split ? layout.attribs[a].stride : layout.stride;
+		}
+		const unsigned threads = num_threads ? num_threads :
+											   dd_hardware_threads();
+		std::vector<QuantizeError> errors(threads);
+
+		dd_parallel_for(num_vertices, threads,
+			[&](const size_t begin, const size_t end,
+				const unsigned range_idx) {
+				QuantizeError &err = errors[range_idx];
+				for (size_t v = begin; v < end; v++) {
+					for (unsigned a = 0; a < layout.num_attribs; a++) {
+						const DDMVertexAttrib &attrib = layout.attribs[a];
+						uint8_t* attr_dst = out + base[a] + v * step[a];
+						switch (attrib.semantic) {
+							case DDM_ATTRIB_POSITION:
+								err.position = std::max(err.position,
+									encodeValues(attrib.format,
+												 source.position.at(v), 3,
+												 layout.ranges[a], 1.f,
+												 attr_dst));
+								break;
+							case DDM_ATTRIB_NORMAL:
+								err.normal_deg = std::max(err.normal_deg,
+									encodeDirection(attrib.format,
+													source.normal.at(v), 0.f,
+													attr_dst));
+								break;
+							case DDM_ATTRIB_TEXCOORD:
+								err.texcoord = std::max(err.texcoord,
+									encodeValues(attrib.format,
+												 source.texcoord.at(v), 2,
+												 layout.ranges[a], 0.f,
+												 attr_dst));
+								break;
+							case DDM_ATTRIB_TANGENT: {
+								const float* tangent = source.tangent.at(v);
+								err.tangent_deg = std::max(err.tangent_deg,
+									encodeDirection(attrib.format, tangent,
+													tangent[3], attr_dst));
+								break;
+							}
+						}
+					}
+				}
+			});
+
+		error = QuantizeError();
+		for (const QuantizeError &err : errors) { dd_mergeError(error, err); }
+	}
+}
+
+void dd_vertexRanges(const Vertex* vertices, const size_t num_vertices,
+					 VertexLayout &layout)
+{
+	vertexRanges(interleavedSource(vertices, num_vertices), layout);
+}
+
+void dd_vertexRanges(const VertexStreams &streams, VertexLayout &layout)
+{
+	vertexRanges(streamSource(streams), layout);
+}
+
+void dd_quantizeVertices(const Vertex* vertices, const size_t num_vertices,
+						 const VertexLayout &layout,
+						 std::vector<uint8_t> &out, QuantizeError &error,
+						 const unsigned num_threads)
+{
+	out.resize(num_vertices * layout.stride);
+	quantizeVertices(interleavedSource(vertices, num_vertices), layout,
+					 out.data(), error, num_threads);
+}
+
+void dd_quantizeVertices(const VertexStreams &streams,
+						 const VertexLayout &layout,
+						 std::vector<uint8_t> &out, QuantizeError &error,
+						 const unsigned num_threads)
+{
+	out.resize(streams.size() * layout.stride);
+	quantizeVertices(streamSource(streams), layout, out.data(), error,
+					 num_threads);
+}
+
+void dd_quantizeVertices(const Vertex* vertices, const size_t num_vertices,
+						 const VertexLayout &layout, uint8_t* out,
+						 QuantizeError &error, const unsigned num_threads)
+{
+	quantizeVertices(interleavedSource(vertices, num_vertices), layout, out,
+					 error, num_threads);
+}
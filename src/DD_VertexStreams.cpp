@@ -0,0 +1,114 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include "DD_VertexStreams.h"
+#include "DD_Parallel.h"
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || \
+	(defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define DD_STREAM_SSE 1
+#include <xmmintrin.h>
+#else
+#define DD_STREAM_SSE 0
+#endif
+
+namespace
+{
+#if DD_STREAM_SSE
+	/// \brief Bounds of the first (count / 4) * 4 elements of a packed
+	/// stream, merged into min/max. 4 elements are W loads: lane j of load k
+	/// holds component (4 * k + j) % W, so every load keeps its own min/max
+	/// register and the lanes are folded at the end
+	template <unsigned W>
+	size_t packedBoundsSSE(const float* data, const size_t count, float* min,
+						   float* max)
+	{
+		__m128 lo[W], hi[W];
+		for (unsigned k = 0; k < W; k++) {
+			lo[k] = _mm_setr_ps(data[(4 * k) % W], data[(4 * k + 1) % W],
+								data[(4 * k + 2) % W], data[(4 * k + 3) % W]);
+			hi[k] = lo[k];
+		}
+		const size_t blocks = count / 4;
+		for (size_t b = 0; b < blocks; b++) {
+			const float* src = data + b * 4 * W;
+			for (unsigned k = 0; k < W; k++) {
+				const __m128 val = _mm_loadu_ps(src + 4 * k);
+				lo[k] = _mm_min_ps(lo[k], val);
+				hi[k] = _mm_max_ps(hi[k], val);
+			}
+		}
+		for (unsigned k = 0; k < W; k++) {
+			float lanes_lo[4], lanes_hi[4];
+			_mm_storeu_ps(lanes_lo, lo[k]);
+			_mm_storeu_ps(lanes_hi, hi[k]);
+			for (unsigned j = 0; j < 4; j++) {
+				const unsigned c = (4 * k + j) % W;
+				min[c] = std::min(min[c], lanes_lo[j]);
+				max[c] = std::max(max[c], lanes_hi[j]);
+			}
+		}
+		return blocks * 4;
+	}
+#endif
+}
+
+void dd_splitVertices(const Vertex* vertices, const size_t num_vertices,
+					  VertexStreams &streams, const unsigned num_threads)
+{
+	streams.position.resizeUninitialized(num_vertices * 3);
+	streams.normal.resizeUninitialized(num_vertices * 3);
+	streams.texcoord.resizeUninitialized(num_vertices * 2);
+	streams.tangent.resizeUninitialized(num_vertices * 4);
+
+	dd_parallel_for(num_vertices, num_threads,
+		[&](const size_t begin, const size_t end, const unsigned) {
+			float* pos = streams.position.data();
+			float* nrm = streams.normal.data();
+			float* uv = streams.texcoord.data();
+			float* tan = streams.tangent.data();
+			for (size_t v = begin; v < end; v++) {
+				const Vertex &vert = vertices[v];
+				for (int k = 0; k < 3; k++) {
+					pos[v * 3 + k] = vert.position[k];
+					nrm[v * 3 + k] = vert.normal[k];
+				}
+				for (int k = 0; k < 2; k++) {
+					uv[v * 2 + k] = vert.texCoords[k];
+				}
+				for (int k = 0; k < 4; k++) {
+					tan[v * 4 + k] = vert.tangent[k];
+				}
+			}
+		});
+}
+
+void dd_streamBounds(const float* data, const size_t count,
+					 const unsigned width, const size_t stride,
+					 float* min, float* max)
+{
+	for (unsigned k = 0; k < width; k++) {
+		min[k] = count ? data[k] : 0.f;
+		max[k] = count ? data[k] : 0.f;
+	}
+	size_t first = 0;	// elements done w/ SIMD
+#if DD_STREAM_SSE
+	if (stride == width && count > 0) {
+		switch (width) {
+			case 1: first = packedBoundsSSE<1>(data, count, min, max); break;
+			case 2: first = packedBoundsSSE<2>(data, count, min, max); break;
+			case 3: first = packedBoundsSSE<3>(data, count, min, max); break;
+			case 4: first = packedBoundsSSE<4>(data, count, min, max); break;
+		}
+	}
+#endif
+	for (size_t i = first; i < count; i++) {
+		const float* val = data + i * stride;
+		for (unsigned k = 0; k < width; k++) {
+			min[k] = std::min(min[k], val[k]);
+			max[k] = std::max(max[k], val[k]);
+		}
+	}
+}
@@ -1,19 +1,717 @@
+#include <algorithm>
+#include <cctype>
+#include <chrono>
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
 #include "DD_Strings.h"
 #include "DD_MeshUtility.h"
 #include "DD_Container.h"
+#include "DD_ConvertCache.h"
+#include "DD_MeshFormat.h"
 #include "DD_ObjConverter.h"
+#include "DD_Parallel.h"
+#include "DD_StatsJson.h"
+#include "DD_ThreadPool.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <dirent.h>
+	#include <glob.h>
+#endif
+#include <sys/stat.h>
 
 // g++ main.cpp -I ./ -ggdb -std=c++11 -o test
 
-int main(int argc, char const *argv[])
+namespace
 {
-	if (argc == 2) {
+	struct Options
+	{
+		unsigned num_threads = 1;		// parse threads per file
+		unsigned num_workers = 0;		// batch workers (0 = all cores)
+		DDMFormat format = DDMFormat::BINARY;
+		ObjConvertOptions convert;
+		const char* out_dir = nullptr;
+		const char* cache_dir = nullptr;	// conversion cache (off if null)
+		uint64_t cache_mb = 4096;
+		const char* json_file = nullptr;	// stats report (off if null)
+		float lod_error = SimplifyLevel().max_error;
+	};
+
+	/// \brief Result of converting one file in batch mode
+	struct BatchResult
+	{
+		std::string		path;
+		std::string		name;		// output file name w/o extension
+		uint64_t		size = 0;
+		ObjConvertStats	stats;
+		double			total_ms = 0.0;
+		const char*		status = "not run";
+		bool			ok = false;
+		bool			cached = false;
+	};
+
+	void printUsage(const char* exe)
+	{
+		printf("Usage: %s [options] <file.obj>\n", exe);
+		printf("       %s [options] -b <directory | glob | list file>\n", exe);
+		printf("Options:\n");
+		printf("  -j <n>   parse threads per file (0 = all hardware threads, "
+			   "default 1)\n");
+		printf("  -t       write text .ddm instead of binary\n");
+		printf("  -z       compress binary index data (delta + varint)\n");
+		printf("  -s       binary vertex data as one stream per attribute "
+			   "(kept split in\n           memory too)\n");
+		printf("  -n <deg> crease angle of generated normals (faces w/o vn), "
+			   "default 60;\n           180 smooths every edge\n");
+		printf("  -N       don't generate normals for faces w/o vn\n");
+		printf("  -q <enc> binary attribute encodings, comma separated:\n"
+			   "             pos=f32|half|u16  (u16: over the bounding box)\n"
+			   "             nrm=f32|oct16|s10 tan=f32|oct16|s10\n"
+			   "             uv=f32|half|u16   (u16: over the uv bounds)\n");
+		printf("  -O       reorder triangles & vertices for gpu vertex cache "
+			   "and fetch\n           locality (each ebo gets its own vertex "
+			   "range)\n");
+		printf("  -l <lst> binary lod chain, comma separated triangle ratio "
+			   "per level\n           (e.g. 0.5,0.25; 0 = only bounded by "
+			   "-L)\n");
+		printf("  -L <err> max lod error relative to the mesh extent "
+			   "(default 0.01)\n");
+		printf("  -m <v,t> binary meshlets of at most v vertices & t "
+			   "triangles (e.g. 64,124;\n           max 256,512)\n");
+		printf("  -B <n>   binary SAH bvh per ebo, at most n triangles per "
+			   "leaf (e.g. 4)\n");
+		printf("  -p <n>   pipeline the stages (read/scan, parse/dedup, "
+			   "encode/write),\n           n chunks or blocks queued per "
+			   "stage (e.g. 8)\n");
+		printf("  -b <src> batch convert every .obj in a directory, matching "
+			   "a glob\n           pattern, or listed (one per line) in a "
+			   "text file\n");
+		printf("  -w <n>   batch worker threads (default: all hardware "
+			   "threads)\n");
+		printf("  -o <dir> output directory (default: current directory)\n");
+		printf("  -c <dir> reuse outputs of unchanged inputs from a cache "
+			   "directory\n");
+		printf("  -C <mb>  cache size limit in MB (default 4096)\n");
+		printf("  -J <fil> write stats & profile counters as JSON (an array "
+			   "in batch\n           mode)\n");
+	}
+
+	double msSince(const std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(
+			std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	double toMBs(const uint64_t bytes, const double ms)
+	{
+		return (ms > 0.0) ? (bytes / (1024.0 * 1024.0)) / (ms / 1000.0) : 0.0;
+	}
+
+	const char* statusString(const ObjImportStatus status)
+	{
+		switch (status) {
+			case ObjImportStatus::GOOD:
+				return "ok";
+			case ObjImportStatus::FILE_NOT_FOUND:
+				return "file not found";
+			case ObjImportStatus::V_VT_VN_MISSING:
+				return "face refers to a missing v/vt/vn";
+		}
+		return "unknown";
+	}
+
+	bool isDirectory(const char* path)
+	{
+		struct stat info;
+		return stat(path, &info) == 0 && (info.st_mode & S_IFDIR) != 0;
+	}
+
+	uint64_t fileSize(const char* path)
+	{
+		struct stat info;
+		return (stat(path, &info) == 0) ? (uint64_t)info.st_size : 0;
+	}
+
+	bool hasObjExtension(const std::string &path)
+	{
+		if (path.size() < 4) { return false; }
+		std::string ext = path.substr(path.size() - 4);
+		for (char &c : ext) { c = (char)tolower(c); }
+		return ext == ".obj";
+	}
+
+	/// \brief File name w/o directory and extension
+	std::string fileStem(const std::string &path)
+	{
+		const size_t slash = path.find_last_of("/\\");
+		std::string name = (slash == std::string::npos) ?
+			path : path.substr(slash + 1);
+		const size_t dot = name.find_last_of('.');
+		return (dot == std::string::npos || dot == 0) ?
+			name : name.substr(0, dot);
+	}
+
+	/// \brief Output names for batch inputs: the file stems, except that
+	/// inputs w/ a stem already taken (same name in another directory, or
+	/// differing only in case) get "_2", "_3", .. so no two conversions
+	/// write the same file
+	std::vector<std::string> outputNames(const std::vector<std::string> &files)
+	{
+		auto lower = [](std::string str) {
+			for (char &c : str) { c = (char)tolower(c); }
+			return str;
+		};
+		std::set<std::string> taken;
+		for (const std::string &file : files) {
+			taken.insert(lower(fileStem(file)));
+		}
+		std::set<std::string> used;
+		std::vector<std::string> names;
+		names.reserve(files.size());
+		for (const std::string &file : files) {
+			const std::string stem = fileStem(file);
+			std::string name = stem;
+			// a suffixed name also skips the stems of other inputs
+			for (unsigned n = 2; used.count(lower(name)) ||
+				 (name != stem && taken.count(lower(name))); n++) {
+				name = stem + "_" + std::to_string(n);
+			}
+			if (name != stem) {
+				printf("%s: %s.ddm is taken, writing %s.ddm\n", file.c_str(),
+					   stem.c_str(), name.c_str());
+			}
+			used.insert(lower(name));
+			names.push_back(name);
+		}
+		return names;
+	}
+
+	/// \brief Collect .obj files in a directory (not recursive)
+	void listDirectory(const std::string &dir, std::vector<std::string> &out)
+	{
+	#ifdef _WIN32
+		WIN32_FIND_DATAA data;
+		HANDLE find = FindFirstFileA((dir + "\\*").c_str(), &data);
+		if (find == INVALID_HANDLE_VALUE) { return; }
+		do {
+			const std::string name = data.cFileName;
+			if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+				hasObjExtension(name)) {
+				out.push_back(dir + "\\" + name);
+			}
+		} while (FindNextFileA(find, &data));
+		FindClose(find);
+	#else
+		DIR* handle = opendir(dir.c_str());
+		if (!handle) { return; }
+		while (dirent* entry = readdir(handle)) {
+			const std::string path = dir + "/" + entry->d_name;
+			if (hasObjExtension(path) && !isDirectory(path.c_str())) {
+				out.push_back(path);
+			}
+		}
+		closedir(handle);
+	#endif
+	}
+
+	/// \brief Collect files matching a wildcard pattern
+	void listGlob(const std::string &pattern, std::vector<std::string> &out)
+	{
+	#ifdef _WIN32
+		const size_t slash = pattern.find_last_of("/\\");
+		const std::string dir = (slash == std::string::npos) ?
+			"" : pattern.substr(0, slash + 1);
+		WIN32_FIND_DATAA data;
+		HANDLE find = FindFirstFileA(pattern.c_str(), &data);
+		if (find == INVALID_HANDLE_VALUE) { return; }
+		do {
+			if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+				out.push_back(dir + data.cFileName);
+			}
+		} while (FindNextFileA(find, &data));
+		FindClose(find);
+	#else
+		glob_t matches;
+		if (glob(pattern.c_str(), 0, nullptr, &matches) == 0) {
+			for (size_t i = 0; i < matches.gl_pathc; i++) {
+				if (!isDirectory(matches.gl_pathv[i])) {
+					out.push_back(matches.gl_pathv[i]);
+				}
+			}
+		}
+		globfree(&matches);
+	#endif
+	}
+
+	/// \brief Collect files listed one per line ('#' starts a comment)
+	bool listFile(const char* path, std::vector<std::string> &out)
+	{
+		FILE* file = fopen(path, "r");
+		if (!file) { return false; }
+		char line[4096];
+		while (fgets(line, sizeof(line), file)) {
+			std::string entry = line;
+			while (!entry.empty() && isspace((unsigned char)entry.back())) {
+				entry.pop_back();
+			}
+			const size_t start = entry.find_first_not_of(" \t");
+			if (start == std::string::npos || entry[start] == '#') { continue; }
+			out.push_back(entry.substr(start));
+		}
+		fclose(file);
+		return true;
+	}
+
+	/// \brief Index of name in names (-1 if not found)
+	int findName(const std::string &name, const char* const* names,
+				 const int count)
+	{
+		for (int i = 0; i < count; i++) {
+			if (name == names[i]) { return i; }
+		}
+		return -1;
+	}
+
+	/// \brief Parse "attr=enc[,attr=enc...]" (see printUsage) into enc
+	bool parseEncoding(const char* spec, VertexEncoding &enc)
+	{
+		// in enum order
+		const char* const value_names[] = { "f32", "half", "u16" };
+		const char* const dir_names[] = { "f32", "oct16", "s10" };
+
+		const std::string list = spec;
+		size_t start = 0;
+		while (start <= list.size()) {
+			size_t end = list.find(',', start);
+			end = (end == std::string::npos) ? list.size() : end;
+			const std::string item = list.substr(start, end - start);
+			start = end + 1;
+
+			const size_t eq = item.find('=');
+			if (eq == std::string::npos) { return false; }
+			const std::string attr = item.substr(0, eq);
+			const std::string val = item.substr(eq + 1);
+			int idx = -1;
+			if (attr == "pos" && (idx = findName(val, value_names, 3)) >= 0) {
+				enc.position = (PositionEncoding)idx;
+			}
+			else if (attr == "uv" &&
+					 (idx = findName(val, value_names, 3)) >= 0) {
+				enc.texcoord = (TexCoordEncoding)idx;
+			}
+			else if (attr == "nrm" &&
+					 (idx = findName(val, dir_names, 3)) >= 0) {
+				enc.normal = (DirectionEncoding)idx;
+			}
+			else if (attr == "tan" &&
+					 (idx = findName(val, dir_names, 3)) >= 0) {
+				enc.tangent = (DirectionEncoding)idx;
+			}
+			else {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	/// \brief Parse "ratio[,ratio...]" into one lod level per ratio
+	bool parseLods(const char* spec, std::vector<SimplifyLevel> &lods)
+	{
+		lods.clear();
+		const char* ptr = spec;
+		while (*ptr) {
+			char* end = nullptr;
+			SimplifyLevel level;
+			level.ratio = std::strtof(ptr, &end);
+			if (end == ptr || (*end && *end != ',') || level.ratio < 0.f ||
+				level.ratio >= 1.f) {
+				return false;
+			}
+			lods.push_back(level);
+			ptr = (*end == ',') ? end + 1 : end;
+		}
+		return !lods.empty();
+	}
+
+	/// \brief Parse "max_vertices,max_triangles"
+	bool parseMeshletLimits(const char* spec, MeshletLimits &limits)
+	{
+		char* end = nullptr;
+		limits.max_vertices = (unsigned)std::strtoul(spec, &end, 10);
+		if (*end != ',') { return false; }
+		const char* tris = end + 1;
+		limits.max_triangles = (unsigned)std::strtoul(tris, &end, 10);
+		return end != tris && *end == '\0' &&
+			   limits.max_vertices >= 3 &&
+			   limits.max_vertices <= k_meshlet_max_vertices &&
+			   limits.max_triangles >= 1 &&
+			   limits.max_triangles <= k_meshlet_max_triangles;
+	}
+
+	/// \brief Everything that changes the .ddm produced for an input
+	std::string cacheOptions(const Options &opts, const char* name)
+	{
+		std::string lods;
+		for (const SimplifyLevel &level : opts.convert.lods) {
+			char item[64];
+			snprintf(item, sizeof(item), "%g/%g,", level.ratio,
+					 level.max_error);
+			lods += item;
+		}
+
+		char buff[512];
+		snprintf(buff, sizeof(buff),
+				 "ddm %u.%u;format=%s;vcache=%d;vfetch=%d;varint=%d;"
+				 "split=%d;normals=%d/%g;enc=%d%d%d%d;lods=%s;"
+				 "meshlets=%u/%u;bvh=%u;name=%s",
+				 (unsigned)k_ddm_version_major, (unsigned)k_ddm_version_minor,
+				 (opts.format == DDMFormat::BINARY) ? "binary" : "text",
+				 opts.convert.optimize_vertex_cache ? 1 : 0,
+				 opts.convert.optimize_vertex_fetch ? 1 : 0,
+				 opts.convert.compress_indices ? 1 : 0,
+				 opts.convert.split_vertex_streams ? 1 : 0,
+				 opts.convert.generate_normals ? 1 : 0,
+				 opts.convert.crease_angle,
+				 (int)opts.convert.vertex_encoding.position,
+				 (int)opts.convert.vertex_encoding.normal,
+				 (int)opts.convert.vertex_encoding.tangent,
+				 (int)opts.convert.vertex_encoding.texcoord, lods.c_str(),
+				 opts.convert.build_meshlets ?
+					 opts.convert.meshlet_limits.max_vertices : 0,
+				 opts.convert.build_meshlets ?
+					 opts.convert.meshlet_limits.max_triangles : 0,
+				 opts.convert.build_bvh ? opts.convert.bvh_max_leaf : 0,
+				 name);
+		return buff;
+	}
+
+	/// \brief Convert res.path to <out_dir>/<name>.ddm, reusing a cached
+	/// result when the input & options haven't changed
+	void convertFile(DD_ObjConverter &converter, const char* name,
+					 const Options &opts, DD_ConvertCache *cache,
+					 BatchResult &res)
+	{
+		const auto start = std::chrono::high_resolution_clock::now();
+		converter.setName(name);
+		const std::string out_path = converter.outputPath(opts.out_dir);
+
+		uint64_t key = 0, input_bytes = 0;
+		const bool keyed = cache && DD_ConvertCache::makeKey(
+			res.path.c_str(), cacheOptions(opts, name).c_str(), key,
+			input_bytes);
+		if (keyed && cache->fetch(key, input_bytes, out_path.c_str())) {
+			res.ok = true;
+			res.cached = true;
+			res.status = "cached";
+			res.stats = ObjConvertStats();
+			res.stats.bytes_read = input_bytes;
+			res.stats.bytes_written = fileSize(out_path.c_str());
+			res.total_ms = msSince(start);
+			return;
+		}
+
+		converter.setOptions(opts.convert);
+		const ObjImportStatus status =
+			converter.importOBJ(res.path.c_str(), opts.num_threads);
+		res.status = statusString(status);
+		if (status == ObjImportStatus::GOOD) {
+			converter.setName(name);
+			res.ok = converter.exportMesh(opts.format, opts.out_dir);
+			res.status = res.ok ? "ok" : "export failed";
+			if (res.ok && keyed) { cache->store(key, out_path.c_str()); }
+		}
+		res.stats = converter.stats();
+		res.total_ms = msSince(start);
+	}
+
+	/// \brief Write the -J report for results (no-op w/o -J)
+	bool writeJson(const Options &opts,
+				   const std::vector<BatchResult> &results, const bool batch)
+	{
+		if (!opts.json_file) { return true; }
+		std::vector<StatsJsonEntry> entries(results.size());
+		for (size_t i = 0; i < results.size(); i++) {
+			entries[i].input = results[i].path;
+			entries[i].status = results[i].status;
+			entries[i].cached = results[i].cached;
+			entries[i].total_ms = results[i].total_ms;
+			entries[i].stats = results[i].stats;
+		}
+		return dd_writeStatsJson(opts.json_file, entries, batch);
+	}
+
+	void printCacheStats(const DD_ConvertCache &cache)
+	{
+		const ConvertCacheStats stats = cache.stats();
+		printf("\nCache\n");
+		printf("\thits:           %lu\n", (unsigned long)stats.hits);
+		printf("\tmisses:         %lu\n", (unsigned long)stats.misses);
+		printf("\tinput skipped:  %lu bytes\n",
+			   (unsigned long)stats.bytes_saved);
+		printf("\toutput reused:  %lu bytes\n",
+			   (unsigned long)stats.bytes_reused);
+		printf("\tevictions:      %lu (%lu bytes)\n",
+			   (unsigned long)stats.evictions,
+			   (unsigned long)stats.bytes_evicted);
+		printf("\tsize:           %lu bytes\n",
+			   (unsigned long)cache.sizeInBytes());
+	}
+
+	int convertOne(const char* input, const Options &opts,
+				   DD_ConvertCache *cache)
+	{
 		DD_ObjConverter converter;
-		converter.importOBJ(argv[1]);
-		converter.printStats();
-		converter.exportMesh();
+		BatchResult res;
+		res.path = input;
+		convertFile(converter, "static_mesh", opts, cache, res);
+		const bool json_ok = writeJson(opts, { res }, false);
+		if (!res.ok) {
+			printf("Failed converting %s: %s\n", input, res.status);
+			return 1;
+		}
+		if (res.cached) {
+			printf("Cache hit for %s: reused %lu bytes\n", input,
+				   (unsigned long)res.stats.bytes_written);
+		}
+		else {
+			converter.printStats();
+			printf("Wrote %s.ddm (%s): %lu bytes in %.3f ms (%.2f MB/s)\n",
+				   converter.name(),
+				   (opts.format == DDMFormat::BINARY) ? "binary" : "text",
+				   (unsigned long)res.stats.bytes_written, res.stats.export_ms,
+				   toMBs(res.stats.bytes_written, res.stats.export_ms));
+			if (opts.format == DDMFormat::BINARY && res.stats.num_triangles) {
+				// lod levels share the index block
+				uint64_t num_triangles = res.stats.num_triangles;
+				for (const unsigned lod : res.stats.lod_triangles) {
+					num_triangles += lod;
+				}
+				printf("  indices: %lu bytes (%.3f bytes per index)\n",
+					   (unsigned long)res.stats.index_bytes,
+					   (double)res.stats.index_bytes / (num_triangles * 3.0));
+			}
+			if (opts.format == DDMFormat::BINARY) {
+				const ObjConvertStats &stats = res.stats;
+				const QuantizeError &err = stats.quantize_error;
+				const uint64_t saved = (uint64_t)stats.num_vertices *
+					(sizeof(Vertex) - stats.vertex_stride);
+				printf("  vertices: %u bytes each (%lu bytes saved vs %lu)\n",
+					   stats.vertex_stride, (unsigned long)saved,
+					   (unsigned long)sizeof(Vertex));
+				printf("  max error: position %g, normal %.4f deg, "
+					   "tangent %.4f deg, uv %g\n", err.position,
+					   err.normal_deg, err.tangent_deg, err.texcoord);
+			}
+		}
+		if (cache) { printCacheStats(*cache); }
+		return json_ok ? 0 : 1;
+	}
+
+	int convertBatch(const char* source, const Options &opts,
+					 DD_ConvertCache *cache)
+	{
+		std::vector<std::string> files;
+		if (isDirectory(source)) {
+			listDirectory(source, files);
+		}
+		else if (strpbrk(source, "*?[")) {
+			listGlob(source, files);
+		}
+		else if (!listFile(source, files)) {
+			printf("Cannot open %s\n", source);
+			return 1;
+		}
+		if (files.empty()) {
+			printf("No input files found in %s\n", source);
+			return 1;
+		}
+
+		// largest first so the long conversions don't end up last
+		std::vector<BatchResult> results(files.size());
+		const std::vector<std::string> names = outputNames(files);
+		for (size_t i = 0; i < files.size(); i++) {
+			results[i].path = files[i];
+			results[i].name = names[i];
+			results[i].size = fileSize(files[i].c_str());
+		}
+		std::stable_sort(results.begin(), results.end(),
+			[](const BatchResult &a, const BatchResult &b) {
+				return a.size > b.size;
+			});
+
+		dd_workpool pool(opts.num_workers == 0 ? dd_hardware_threads() :
+												 opts.num_workers);
+		// one converter per worker so buffers are reused between files
+		std::vector<DD_ObjConverter> converters(pool.numWorkers());
+
+		for (BatchResult &result : results) {
+			BatchResult *res = &result;
+			pool.push([res, &converters, &opts, cache](const unsigned worker) {
+				convertFile(converters[worker], res->name.c_str(),
+							opts, cache, *res);
+			});
+		}
+
+		const auto batch_start = std::chrono::high_resolution_clock::now();
+		pool.run();
+		const double batch_ms = msSince(batch_start);
+
+		// report
+		uint64_t bytes_in = 0, bytes_out = 0, triangles = 0;
+		unsigned failed = 0;
+		printf("%-40s %12s %10s %10s %10s  %s\n", "file", "bytes", "import ms",
+			   "export ms", "MB/s", "status");
+		for (const BatchResult &result : results) {
+			printf("%-40s %12lu %10.3f %10.3f %10.2f  %s\n",
+				   result.path.c_str(), (unsigned long)result.size,
+				   result.stats.import_ms, result.stats.export_ms,
+				   toMBs(result.size, result.total_ms), result.status);
+			bytes_in += result.size;
+			bytes_out += result.stats.bytes_written;
+			triangles += result.ok ? result.stats.num_triangles : 0;
+			failed += result.ok ? 0 : 1;
+		}
+		printf("\nBatch\n");
+		printf("\tfiles:          %lu (%u failed)\n",
+			   (unsigned long)results.size(), failed);
+		printf("\tworkers:        %u\n", pool.numWorkers());
+		printf("\twall time:      %.3f ms\n", batch_ms);
+		printf("\tinput:          %lu bytes (%.2f MB/s)\n",
+			   (unsigned long)bytes_in, toMBs(bytes_in, batch_ms));
+		printf("\toutput:         %lu bytes\n", (unsigned long)bytes_out);
+		printf("\ttriangles:      %lu (%.0f /s)\n", (unsigned long)triangles,
+			   batch_ms > 0.0 ? triangles / (batch_ms / 1000.0) : 0.0);
+		printf("\tfiles/s:        %.2f\n",
+			   batch_ms > 0.0 ? results.size() / (batch_ms / 1000.0) : 0.0);
+		if (cache) { printCacheStats(*cache); }
+		const bool json_ok = writeJson(opts, results, true);
+		return (failed || !json_ok) ? 1 : 0;
+	}
+}
+
+int main(int argc, char const *argv[])
+{
+	const char* input = nullptr;
+	const char* batch = nullptr;
+	Options opts;
+
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+			opts.num_threads = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "-w") == 0 && i + 1 < argc) {
+			opts.num_workers = (unsigned)std::strtoul(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+			batch = argv[++i];
+		}
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+			opts.out_dir = argv[++i];
+		}
+		else if (strcmp(argv[i], "-c") == 0 && i + 1 < argc) {
+			opts.cache_dir = argv[++i];
+		}
+		else if (strcmp(argv[i], "-C") == 0 && i + 1 < argc) {
+			opts.cache_mb = std::strtoull(argv[++i], nullptr, 10);
+		}
+		else if (strcmp(argv[i], "-J") == 0 && i + 1 < argc) {
+			opts.json_file = argv[++i];
+		}
+		else if (strcmp(argv[i], "-O") == 0) {
+			opts.convert.optimize_vertex_cache = true;
+			opts.convert.optimize_vertex_fetch = true;
+		}
+		else if (strcmp(argv[i], "-q") == 0 && i + 1 < argc) {
+			if (!parseEncoding(argv[++i], opts.convert.vertex_encoding)) {
+				printUsage(argv[0]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+			if (!parseLods(argv[++i], opts.convert.lods)) {
+				printUsage(argv[0]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+			opts.convert.build_meshlets = true;
+			if (!parseMeshletLimits(argv[++i], opts.convert.meshlet_limits)) {
+				printUsage(argv[0]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-B") == 0 && i + 1 < argc) {
+			opts.convert.build_bvh = true;
+			opts.convert.bvh_max_leaf =
+				(unsigned)std::strtoul(argv[++i], nullptr, 10);
+			if (opts.convert.bvh_max_leaf == 0 ||
+				opts.convert.bvh_max_leaf > k_bvh_max_leaf) {
+				printUsage(argv[0]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-L") == 0 && i + 1 < argc) {
+			opts.lod_error = std::strtof(argv[++i], nullptr);
+		}
+		else if (strcmp(argv[i], "-z") == 0) {
+			opts.convert.compress_indices = true;
+		}
+		else if (strcmp(argv[i], "-s") == 0) {
+			opts.convert.vertex_streams = true;
+			opts.convert.split_vertex_streams = true;
+		}
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+			opts.convert.crease_angle = std::strtof(argv[++i], nullptr);
+		}
+		else if (strcmp(argv[i], "-N") == 0) {
+			opts.convert.generate_normals = false;
+		}
+		else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) {
+			opts.convert.pipeline = true;
+			opts.convert.pipeline_depth =
+				(unsigned)std::strtoul(argv[++i], nullptr, 10);
+			if (opts.convert.pipeline_depth == 0) {
+				printUsage(argv[0]);
+				return 1;
+			}
+		}
+		else if (strcmp(argv[i], "-t") == 0) {
+			opts.format = DDMFormat::TEXT;
+		}
+		else if (argv[i][0] == '-') {
+			printUsage(argv[0]);
+			return 1;
+		}
+		else {
+			input = argv[i];
+		}
+	}
+
+	for (SimplifyLevel &level : opts.convert.lods) {
+		level.max_error = opts.lod_error;
+	}
+
+	DD_ConvertCache cache;
+	if (opts.cache_dir &&
+		!cache.open(opts.cache_dir, opts.cache_mb * 1024 * 1024)) {
+		return 1;
+	}
+	DD_ConvertCache *cache_ptr = cache.isOpen() ? &cache : nullptr;
+
+	if (batch) {
+		return convertBatch(batch, opts, cache_ptr);
+	}
+	if (input) {
+		return convertOne(input, opts, cache_ptr);
 	}
-	
-	return 0;
-}
\ No newline at end of file
+	// no input is a usage error too (scripts check the exit code)
+	printUsage(argv[0]);
+	return 1;
+}
@@ -0,0 +1,1048 @@
+/*
+* Copyright (c) 2017, Moses Adeagbo
+* All rights reserved.
+*/
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "DD_IndexCodec.h"
+#include "DD_IndexMap.h"
+#include "DD_MeshFormat.h"
+#include "DD_NumParse.h"
+#include "DD_ObjConverter.h"
+#include "DD_TextWriter.h"
+#include "DD_VertexQuantize.h"
+#include "DD_VertexStreams.h"
+
+/*-----------------------------------------------------------------------------
+*
+*	dd_tests: conversion regression tests ("ctest" in the build directory)
+*		- each test writes a small obj to the working directory, imports it
+*		  and checks the resulting mesh
+*		- exits non-zero if any check fails
+*
+-----------------------------------------------------------------------------*/
+
+namespace
+{
+	unsigned g_checks = 0;
+	unsigned g_failures = 0;
+
+	#define DD_CHECK(cond)											\
+		do {														\
+			g_checks++;												\
+			if (!(cond)) {											\
+				g_failures++;										\
+				printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #cond);	\
+			}														\
+		} while (0)
+
+	/// \brief Write text to filename, returns false on failure
+	bool writeFile(const char* filename, const std::string &text)
+	{
+		FILE* file = fopen(filename, "wb");
+		if (!file) { return false; }
+		const bool good = fwrite(text.data(), 1, text.size(), file) ==
+						  text.size();
+		fclose(file);
+		return good;
+	}
+
+	/// \brief Contents of filename ("" if it can't be read)
+	std::string readFile(const char* filename)
+	{
+		std::string text;
+		FILE* file = fopen(filename, "rb");
+		if (!file) { return text; }
+		char block[4096];
+		size_t len;
+		while ((len = fread(block, 1, sizeof(block), file)) > 0) {
+			text.append(block, len);
+		}
+		fclose(file);
+		return text;
+	}
+
+	/// \brief Import an obj written from text
+	MeshContainer importText(const char* filename, const std::string &text,
+							 ObjImportStatus &status,
+							 const unsigned num_threads = 1,
+							 const ObjConvertOptions &options =
+								ObjConvertOptions())
+	{
+		DD_ObjConverter converter;
+		converter.setOptions(options);
+		if (!writeFile(filename, text)) {
+			status = ObjImportStatus::FILE_NOT_FOUND;
+			return MeshContainer();
+		}
+		return converter.importOBJ(filename, status, num_threads);
+	}
+
+	/// \brief Largest |component| of a unit normal: 1 if it's axis aligned
+	float axisAligned(const float* normal)
+	{
+		return std::max(std::fabs(normal[0]),
+						std::max(std::fabs(normal[1]), std::fabs(normal[2])));
+	}
+
+	/// \brief Generated normals at a position shared by every face (fan
+	/// center): 2 half discs at a right angle around one center, 100k
+	/// triangles each. The center splits into 1 vertex per half disc
+	void testHighValenceNormals()
+	{
+		const unsigned k_fan = 100000;
+		const double k_pi = 3.14159265358979;
+		std::string obj = "v 0 0 0\n";
+		char line[96];
+		for (unsigned disc = 0; disc < 2; disc++) {
+			for (unsigned i = 0; i <= k_fan; i++) {
+				const double a = k_pi * i / k_fan;
+				// disc 0 in the xy plane, disc 1 in the xz plane
+				snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", std::cos(a),
+						 disc ? 0.0 : std::sin(a), disc ? -std::sin(a) : 0.0);
+				obj += line;
+			}
+		}
+		for (unsigned disc = 0; disc < 2; disc++) {
+			const unsigned first = 2 + disc * (k_fan + 1);
+			for (unsigned i = 0; i < k_fan; i++) {
+				snprintf(line, sizeof(line), "f 1 %u %u\n", first + i,
+						 first + i + 1);
+				obj += line;
+			}
+		}
+
+		ObjImportStatus status;
+		const MeshContainer mesh = importText("test_fan.obj", obj, status);
+		DD_CHECK(status == ObjImportStatus::GOOD);
+		DD_CHECK(mesh.indices.size() == 2 * k_fan);
+		DD_CHECK(mesh.numVertices() == 2 * (k_fan + 1) + 2);
+		bool flat = true;
+		for (size_t v = 0; v < mesh.data.size(); v++) {
+			flat = flat && axisAligned(mesh.data[v].normal) > 0.9999f;
+		}
+		DD_CHECK(flat);
+	}
+
+	/// \brief Faces outside any usemtl group go in an implicit first ebo
+	void testImplicitEbo()
+	{
+		// plain v/f file: 1 ebo w/ every triangle
+		ObjImportStatus status;
+		MeshContainer mesh = importText("test_quad.obj",
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n", status);
+		DD_CHECK(status == ObjImportStatus::GOOD);
+		DD_CHECK(mesh.indices.size() == 2);
+		DD_CHECK(mesh.mesh_idx.numRows() == 1);
+		if (mesh.mesh_idx.numRows() == 1) {
+			DD_CHECK(mesh.mesh_idx.GetElement(0, 0) == 0);
+			DD_CHECK(mesh.mesh_idx.GetElement(0, 1) == 2);
+		}
+
+		// faces before the first usemtl: their own ebo, then the group's
+		mesh = importText("test_groups.obj",
+			"v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3\n"
+			"usemtl a\nf 1 3 4\nf 1 2 4\n", status);
+		DD_CHECK(status == ObjImportStatus::GOOD);
+		DD_CHECK(mesh.indices.size() == 3);
+		DD_CHECK(mesh.mesh_idx.numRows() == 2);
+		if (mesh.mesh_idx.numRows() == 2) {
+			DD_CHECK(mesh.mesh_idx.GetElement(0, 1) == 1);
+			DD_CHECK(mesh.mesh_idx.GetElement(1, 0) == 1);
+			DD_CHECK(mesh.mesh_idx.GetElement(1, 1) == 2);
+		}
+	}
+
+	/// \brief A face that refers to a missing v, vt or vn fails the import,
+	/// in any chunk & w/ any thread count or pipelining
+	void testMissingIndex()
+	{
+		const char* k_faces[] = {
+			"f 1 2 5\n",				// v
+			"f 1/1 2/2 3/3\n",			// vt
+			"f 1//1 2//2 3//1\n",		// vn
+			"f -1 -2 -6\n",			// relative v
+			"f 1/1/1 2/1/1 x/1/1\n",	// malformed
+		};
+		const std::string header = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\n"
+								   "vt 0 0\nvt 1 0\nvn 0 0 1\n";
+		// > 1 MB of good faces: several chunks when pipelined
+		std::string good;
+		for (unsigned i = 0; i < 100000; i++) {
+			good += "f 1/1/1 2/2/1 3/1/1\n";
+		}
+
+		ObjConvertOptions pipelined;
+		pipelined.pipeline = true;
+		pipelined.pipeline_depth = 2;
+		for (const char* face : k_faces) {
+			ObjImportStatus status;
+			importText("test_bad.obj", header + face, status);
+			DD_CHECK(status == ObjImportStatus::V_VT_VN_MISSING);
+			// bad face first (the import stops early) & last
+			importText("test_bad.obj", header + face + good, status, 3,
+					   pipelined);
+			DD_CHECK(status == ObjImportStatus::V_VT_VN_MISSING);
+			importText("test_bad.obj", header + face + good, status, 3);
+			DD_CHECK(status == ObjImportStatus::V_VT_VN_MISSING);
+			importText("test_bad.obj", header + good + face, status, 3,
+					   pipelined);
+			DD_CHECK(status == ObjImportStatus::V_VT_VN_MISSING);
+		}
+		ObjImportStatus status;
+		importText("test_bad.obj", header + good, status, 3, pipelined);
+		DD_CHECK(status == ObjImportStatus::GOOD);
+	}
+
+	/// \brief n x n grid w/ every face layout (v, v/vt, v//vn, v/vt/vn),
+	/// quads & triangles, material groups & faces w/o vn
+	std::string gridObj(const unsigned n)
+	{
+		std::string obj;
+		char line[128];
+		for (unsigned j = 0; j < n; j++) {
+			for (unsigned i = 0; i < n; i++) {
+				snprintf(line, sizeof(line), "v %.5f %.5f %.5f\n", i * 0.1,
+						 j * 0.1, std::sin(i * 0.3) * std::cos(j * 0.2));
+				obj += line;
+				snprintf(line, sizeof(line), "vt %.4f %.4f\n", (double)i / n,
+						 (double)j / n);
+				obj += line;
+				snprintf(line, sizeof(line), "vn 0 %.4f 1\n", 0.01 * i);
+				obj += line;
+			}
+		}
+		for (unsigned j = 0; j + 1 < n; j++) {
+			if (j % 40 == 0) {
+				snprintf(line, sizeof(line), "usemtl m%u\n", j / 40);
+				obj += line;
+			}
+			for (unsigned i = 0; i + 1 < n; i++) {
+				const unsigned a = j * n + i + 1, b = a + 1;
+				const unsigned c = b + n, d = a + n;
+				switch ((i + j) % 4) {
+				case 0:
+					snprintf(line, sizeof(line),
+							 "f %u/%u/%u %u/%u/%u %u/%u/%u %u/%u/%u\n",
+							 a, a, a, b, b, b, c, c, c, d, d, d);
+					break;
+				case 1:
+					snprintf(line, sizeof(line), "f %u %u %u\nf %u %u %u\n",
+							 a, b, c, a, c, d);
+					break;
+				case 2:
+					snprintf(line, sizeof(line), "f %u/%u %u/%u %u/%u %u/%u\n",
+							 a, a, b, b, c, c, d, d);
+					break;
+				default:
+					snprintf(line, sizeof(line), "f %u//%u %u//%u %u//%u\n"
+							 "f %u//%u %u//%u %u//%u\n",
+							 a, a, b, b, c, c, a, a, c, c, d, d);
+				}
+				obj += line;
+			}
+		}
+		return obj;
+	}
+
+	/// \brief Parallel & pipelined conversions write the same bytes as a
+	/// serial one (the grid splits into several parse chunks)
+	void testParallelOutput()
+	{
+		if (!writeFile("test_grid.obj", gridObj(150))) {
+			DD_CHECK(false);
+			return;
+		}
+		std::string expected[2];
+		const DDMFormat k_formats[2] = { DDMFormat::BINARY, DDMFormat::TEXT };
+		for (unsigned threads : { 1u, 3u }) {
+			for (bool pipeline : { false, true }) {
+				ObjConvertOptions options;
+				options.pipeline = pipeline;
+				options.pipeline_depth = 2;
+				DD_ObjConverter converter;
+				converter.setOptions(options);
+				const ObjImportStatus status = converter.importOBJ(
+					"test_grid.obj", threads);
+				DD_CHECK(status == ObjImportStatus::GOOD);
+				converter.setName("test_grid");
+				for (unsigned f = 0; f < 2; f++) {
+					DD_CHECK(converter.exportMesh(k_formats[f], "."));
+					const std::string out = readFile("test_grid.ddm");
+					DD_CHECK(!out.empty());
+					if (expected[f].empty()) {
+						expected[f] = out;
+					}
+					else {
+						DD_CHECK(out == expected[f]);
+					}
+				}
+			}
+		}
+	}
+
+	/// \brief putFixed writes the same text as printf("%.Nf")
+	void testFixedText()
+	{
+		// ties (exact in binary), rounding carries, signed zero, values
+		// past the fast path, inf & nan, then pseudo random bit patterns
+		std::vector<float> values = {
+			0.f, -0.f, 0.0005f, -0.0004f, 1.0625f, 1.0675f, 2.5f, -2.5f,
+			9.9995f, 0.9999999f, 123456.789f, -1e-7f, 1e18f, -3e38f,
+			INFINITY, -INFINITY, NAN };
+		uint32_t bits = 12345u;
+		for (unsigned i = 0; i < 20000; i++) {
+			bits = bits * 1664525u + 1013904223u;
+			// exponents around 1: the range mesh data lives in
+			const uint32_t pattern = (bits & 0x807FFFFFu) |
+									 ((100u + (bits >> 24) % 50u) << 23);
+			float val;
+			memcpy(&val, &pattern, sizeof(val));
+			values.push_back(val);
+		}
+
+		for (unsigned precision : { 0u, 3u, 6u }) {
+			std::string expected;
+			char tmp[512];
+			DD_TextWriter writer(4096);	// small blocks: many flushes
+			DD_CHECK(writer.open("test_fixed.txt"));
+			for (const float val : values) {
+				snprintf(tmp, sizeof(tmp), "%.*f\n", (int)precision, val);
+				expected += tmp;
+				writer.putFixed(val, precision);
+				writer.put('\n');
+			}
+			DD_CHECK(writer.close());
+			DD_CHECK(readFile("test_fixed.txt") == expected);
+		}
+	}
+
+	/// \brief dd_parseFloat on token (not null terminated, then followed by
+	/// each obj separator) matches (float)strtod: value & bytes consumed
+	bool floatMatches(const std::string &token)
+	{
+		char* end;
+		const float expected = (float)strtod(token.c_str(), &end);
+		const size_t expected_len = end - token.c_str();
+		bool match = true;
+		for (const char* next : { "", " ", "/", "\n" }) {
+			// exact size copy: reading past the token is a bug
+			const std::string text = token + next;
+			std::vector<char> buff(text.begin(), text.end());
+			const char* str = buff.data();
+			const float val = dd_parseFloat(str, buff.data() + buff.size());
+			match = match && (size_t)(str - buff.data()) == expected_len;
+			match = match && (std::isnan(expected) ? std::isnan(val) :
+							  memcmp(&val, &expected, sizeof(val)) == 0);
+		}
+		if (!match) { printf("  dd_parseFloat(\"%s\")\n", token.c_str()); }
+		return match;
+	}
+
+	/// \brief dd_parseInt matches strtol (saturated to +-UINT32_MAX):
+	/// value, bytes consumed & failure (no digits: str unchanged)
+	bool intMatches(const std::string &token)
+	{
+		char* end;
+		long long expected = strtoll(token.c_str(), &end, 10);
+		size_t expected_len = end - token.c_str();
+		expected = std::max(-0xFFFFFFFFll, std::min(0xFFFFFFFFll, expected));
+		// strtol also skips leading space, obj tokens never have any
+		if (!token.empty() && token[0] == ' ') { expected_len = 0; }
+
+		std::vector<char> buff(token.begin(), token.end());
+		const char* str = buff.data();
+		int64_t val = 0;
+		const bool parsed = dd_parseInt(str, buff.data() + buff.size(), val);
+		const bool match = parsed ?
+			(val == expected && (size_t)(str - buff.data()) == expected_len) :
+			(expected_len == 0 && str == buff.data());
+		if (!match) { printf("  dd_parseInt(\"%s\")\n", token.c_str()); }
+		return match;
+	}
+
+	/// \brief Obj number scanners against the C library
+	void testNumParse()
+	{
+		const char* k_floats[] = {
+			// plain, signs, no integer or fraction digits
+			"0", "-0", "+0", "1", "-1", "+1.5", "-2.25", ".5", "-.5", "5.",
+			"-5.", "0.1", "0.3", "123.456", "-0.000", "00012.5000",
+			// exponents
+			"1e5", "1E5", "1e+5", "1e-5", "-2.5e-3", ".5e1", "5.e-1", "1e0",
+			"1e22", "1e23", "1e-22", "1e-23", "3.4028235e38", "3.5e38",
+			"1.17549435e-38", "1.4e-45", "1e-46", "1e400", "-1e400",
+			"1e-400", "1e99999999",
+			// long mantissas (past 19 digits & the 2^53 fast path)
+			"3.14159265358979323846264338327950288",
+			"9007199254740993", "9007199254740992.5",
+			"1234567890123456789", "12345678901234567890",
+			"123456789012345678901234567890e-10",
+			"0.000000000000000000000000000000000000000000001401298464324817",
+			"0.1000000000000000055511151231257827021181583404541015625",
+			"16777217", "16777217.0000000000000000001", "1.00000005960464477",
+			// malformed: strtod's prefix (or nothing) is read
+			"", "-", "+", ".", "-.", "e5", "1e", "1e+", "1.2.3", "1-2",
+			"--1", "+-1", "abc", "1x", "0x1p3", "inf", "-inf", "nan",
+			"infinity" };
+		bool floats = true;
+		for (const char* token : k_floats) { floats &= floatMatches(token); }
+		// pseudo random values in the ways exporters print them
+		uint32_t bits = 777u;
+		const char* k_formats[] = { "%.9g", "%.3f", "%.6e", "%.17g" };
+		char token[64];
+		for (unsigned i = 0; i < 20000; i++) {
+			bits = bits * 1664525u + 1013904223u;
+			const uint32_t pattern = (bits & 0x807FFFFFu) |
+									 ((90u + (bits >> 24) % 80u) << 23);
+			float val;
+			memcpy(&val, &pattern, sizeof(val));
+			snprintf(token, sizeof(token), k_formats[i % 4], val);
+			floats &= floatMatches(token);
+		}
+		DD_CHECK(floats);
+
+		const char* k_ints[] = {
+			"0", "7", "+7", "-7", "42", "-1", "-123456", "000123", "-0",
+			"2147483647", "2147483648", "-2147483649", "4294967295",
+			"4294967296", "-4294967296", "99999999999999999999",
+			// relative index prefixes & malformed
+			"-1/2", "3/", "12//4", "", "-", "+", "/1", "x1", "-x", "--1",
+			" 1", "1.5" };
+		bool ints = true;
+		for (const char* token : k_ints) { ints &= intMatches(token); }
+		DD_CHECK(ints);
+	}
+
+	/// \brief Negative (relative) indices refer back from the last record
+	/// read so far
+	void testRelativeIndices()
+	{
+		ObjImportStatus status;
+		const MeshContainer mesh = importText("test_relative.obj",
+			"v 0 0 0\nv 1 0 0\nvt 0.5 0.25\nvn 0 0 1\nv 1 1 0\n"
+			"f -3/1/1 -2/-1/-1 -1/-1/1\n"
+			"v 0 1 0\nvt 0.75 1\nf 1/-2 3/-1 -1/-1\n", status);
+		DD_CHECK(status == ObjImportStatus::GOOD);
+		DD_CHECK(mesh.indices.size() == 2);
+		DD_CHECK(mesh.data.size() == 6);
+		if (mesh.indices.size() == 2 && mesh.data.size() == 6) {
+			const float k_pos[2][3] = { { 0, 1, 1 }, { 0, 1, 0 } };
+			const float k_u[2][3] = { { 0.5f, 0.5f, 0.5f },
+									  { 0.5f, 0.75f, 0.75f } };
+			for (unsigned t = 0; t < 2; t++) {
+				for (unsigned c = 0; c < 3; c++) {
+					const Vertex &v = mesh.data[mesh.indices[t].data[c]];
+					DD_CHECK(v.position[0] == k_pos[t][c]);
+					DD_CHECK(v.texCoords[0] == k_u[t][c]);
+				}
+			}
+		}
+	}
+
+	/// \brief Keys that share a home slot stay distinct, growth keeps every
+	/// entry, clear() keeps the capacity
+	void testIndexMap()
+	{
+		const unsigned k_no = 0xFFFFFFFFu;	// an obj index that isn't there
+		bool inserted = false;
+
+		// keys whose home slot (in 16 slots) is base's: inserting one after
+		// base has to probe past it
+		const unsigned base[3] = { 1, 2, 3 };
+		std::vector<unsigned> colliding;
+		for (unsigned c = 4; colliding.size() < 5 && c < 100000; c++) {
+			dd_indexmap probe;
+			probe.reserve(1);
+			probe.findOrInsert(base[0], base[1], base[2], 0, inserted);
+			const uint64_t probes = probe.probes();
+			probe.findOrInsert(base[0], base[1], c, 1, inserted);
+			if (probe.probes() - probes > 1) { colliding.push_back(c); }
+		}
+		DD_CHECK(colliding.size() == 5);
+
+		// 10 keys: still 16 slots, so the colliding keys share one run
+		dd_indexmap map;
+		map.reserve(1);
+		const size_t capacity = map.capacity();
+		map.findOrInsert(base[0], base[1], base[2], 100, inserted);
+		for (size_t i = 0; i < colliding.size(); i++) {
+			const unsigned val = map.findOrInsert(base[0], base[1],
+												  colliding[i], (unsigned)i,
+												  inserted);
+			DD_CHECK(inserted && val == i);
+		}
+		// permutations & missing components are distinct keys too
+		const unsigned k_keys[][3] = {
+			{ 2, 1, 3 }, { 3, 2, 1 }, { 1, 3, 2 }, { 1, 2, k_no } };
+		for (unsigned k = 0; k < 4; k++) {
+			map.findOrInsert(k_keys[k][0], k_keys[k][1], k_keys[k][2],
+							 200 + k, inserted);
+			DD_CHECK(inserted);
+		}
+		DD_CHECK(map.size() == colliding.size() + 5);
+		DD_CHECK(map.findOrInsert(base[0], base[1], base[2], 0, inserted) ==
+				 100 && !inserted);
+		bool found = true;
+		for (size_t i = 0; i < colliding.size(); i++) {
+			found &= map.findOrInsert(base[0], base[1], colliding[i], 999,
+									  inserted) == i && !inserted;
+		}
+		for (unsigned k = 0; k < 4; k++) {
+			found &= map.findOrInsert(k_keys[k][0], k_keys[k][1],
+									  k_keys[k][2], 999, inserted) ==
+					 200 + k && !inserted;
+		}
+		DD_CHECK(found);
+		DD_CHECK(map.capacity() == capacity);
+
+		// growth from empty: every key survives each rehash
+		const unsigned k_count = 100000;
+		auto key = [](const unsigned i, unsigned* out) {
+			out[0] = i % 1000;
+			out[1] = (i / 1000) * 7;
+			out[2] = (i & 1) ? k_no : i;
+		};
+		dd_indexmap grown;
+		unsigned triple[3];
+		bool unique = true;
+		for (unsigned i = 0; i < k_count; i++) {
+			key(i, triple);
+			unique &= grown.findOrInsert(triple[0], triple[1], triple[2], i,
+										 inserted) == i && inserted;
+		}
+		DD_CHECK(unique);
+		DD_CHECK(grown.size() == k_count);
+		DD_CHECK(grown.size() * 10 <= grown.capacity() * 7);
+		found = true;
+		for (unsigned i = 0; i < k_count; i++) {
+			key(i, triple);
+			found &= grown.findOrInsert(triple[0], triple[1], triple[2], 0,
+										inserted) == i && !inserted;
+		}
+		DD_CHECK(found);
+
+		// reserve: no growth up to n keys. clear: empty, same capacity
+		dd_indexmap reserved;
+		reserved.reserve(k_count);
+		const size_t reserved_capacity = reserved.capacity();
+		for (unsigned i = 0; i < k_count; i++) {
+			key(i, triple);
+			reserved.findOrInsert(triple[0], triple[1], triple[2], i, inserted);
+		}
+		DD_CHECK(reserved.capacity() == reserved_capacity);
+		reserved.clear();
+		DD_CHECK(reserved.size() == 0);
+		DD_CHECK(reserved.capacity() == reserved_capacity);
+		key(5, triple);
+		DD_CHECK(reserved.findOrInsert(triple[0], triple[1], triple[2], 7,
+									   inserted) == 7 && inserted);
+	}
+
+	/// \brief Pseudo random float in [lo, hi)
+	float randomFloat(uint32_t &state, const float lo, const float hi)
+	{
+		state = state * 1664525u + 1013904223u;
+		return lo + (hi - lo) * (float)(state >> 8) / 16777216.f;
+	}
+
+	/// \brief Pseudo random unit vector
+	void randomDirection(uint32_t &state, float* dir)
+	{
+		float len = 0.f;
+		while (len < 0.1f) {
+			for (int i = 0; i < 3; i++) { dir[i] = randomFloat(state, -1, 1); }
+			len = std::sqrt(dir[0] * dir[0] + dir[1] * dir[1] +
+							dir[2] * dir[2]);
+		}
+		for (int i = 0; i < 3; i++) { dir[i] /= len; }
+	}
+
+	/// \brief Angle in degrees between a & b
+	double angleBetween(const float* a, const float* b)
+	{
+		double dot = 0.0, la = 0.0, lb = 0.0;
+		for (int i = 0; i < 3; i++) {
+			dot += (double)a[i] * b[i];
+			la += (double)a[i] * a[i];
+			lb += (double)b[i] * b[i];
+		}
+		const double c = dot / std::sqrt(la * lb);
+		return std::acos(std::max(-1.0, std::min(1.0, c))) * 57.29577951308232;
+	}
+
+	/// \brief Decode one attribute as a loader would (DD_MeshFormat.h).
+	/// Returns the components written to out (directions: xyz & sign w)
+	int decodeAttrib(const uint8_t* src, const uint32_t format,
+					 const DDMAttribRange &range, float* out)
+	{
+		switch (format) {
+			case DDM_FORMAT_FLOAT32x2:
+			case DDM_FORMAT_FLOAT32x3:
+			case DDM_FORMAT_FLOAT32x4: {
+				const int n = 2 + (int)(format - DDM_FORMAT_FLOAT32x2);
+				memcpy(out, src, n * sizeof(float));
+				return n;
+			}
+			case DDM_FORMAT_FLOAT16x2:
+			case DDM_FORMAT_FLOAT16x4: {
+				const int n = (format == DDM_FORMAT_FLOAT16x2) ? 2 : 4;
+				uint16_t q[4];
+				memcpy(q, src, n * sizeof(uint16_t));
+				for (int i = 0; i < n; i++) { out[i] = dd_halfToFloat(q[i]); }
+				return n;
+			}
+			case DDM_FORMAT_UNORM16x2:
+			case DDM_FORMAT_UNORM16x4: {
+				const int n = (format == DDM_FORMAT_UNORM16x2) ? 2 : 4;
+				uint16_t q[4];
+				memcpy(q, src, n * sizeof(uint16_t));
+				for (int i = 0; i < n; i++) {
+					out[i] = range.min[i] +
+						(q[i] / 65535.f) * (range.max[i] - range.min[i]);
+				}
+				return n;
+			}
+			case DDM_FORMAT_OCT_SNORM16x2:
+			case DDM_FORMAT_OCT_SNORM16x4: {
+				int16_t q[4] = { 0, 0, 32767, 0 };
+				memcpy(q, src, (format == DDM_FORMAT_OCT_SNORM16x2) ? 4 : 8);
+				float x = std::max(q[0] / 32767.f, -1.f);
+				float y = std::max(q[1] / 32767.f, -1.f);
+				const float z = 1.f - std::fabs(x) - std::fabs(y);
+				if (z < 0.f) {
+					const float fx = (1.f - std::fabs(y)) * (x < 0 ? -1 : 1);
+					const float fy = (1.f - std::fabs(x)) * (y < 0 ? -1 : 1);
+					x = fx;
+					y = fy;
+				}
+				out[0] = x;
+				out[1] = y;
+				out[2] = z;
+				out[3] = (q[2] < 0) ? -1.f : 1.f;
+				return 4;
+			}
+			case DDM_FORMAT_SNORM10x3_2: {
+				uint32_t val;
+				memcpy(&val, src, sizeof(val));
+				for (int i = 0; i < 3; i++) {
+					int32_t q = (int32_t)((val >> (i * 10)) & 0x3FF);
+					q = (q & 0x200) ? q - 0x400 : q;
+					out[i] = std::max(q / 511.f, -1.f);
+				}
+				const int32_t w = (int32_t)(val >> 30);
+				out[3] = (float)((w & 2) ? w - 4 : w);
+				return 4;
+			}
+		}
+		return 0;
+	}
+
+	/// \brief Every half converts to float exactly & back to itself, and
+	/// floats round to the nearest half
+	void testHalfFloat()
+	{
+		bool exact = true;
+		for (uint32_t h = 0; h < 0x10000; h++) {
+			const uint32_t exp = (h >> 10) & 0x1F, mant = h & 0x3FF;
+			if (exp == 31 && mant) {	// nan stays nan
+				exact &= std::isnan(dd_halfToFloat((uint16_t)h)) &&
+						 (dd_floatToHalf(dd_halfToFloat((uint16_t)h)) &
+						  0x7FFF) > 0x7C00;
+				continue;
+			}
+			double mag = (exp == 0) ? std::ldexp((double)mant, -24) :
+				(exp == 31) ? INFINITY :
+				std::ldexp((double)(1024 + mant), (int)exp - 25);
+			const float expected = (float)((h & 0x8000) ? -mag : mag);
+			const float val = dd_halfToFloat((uint16_t)h);
+			exact &= memcmp(&val, &expected, sizeof(val)) == 0;
+			exact &= dd_floatToHalf(val) == h;
+		}
+		DD_CHECK(exact);
+
+		// nearest (ties to even) over the finite range, overflow -> inf
+		bool nearest = true;
+		uint32_t state = 99u;
+		for (unsigned i = 0; i < 100000; i++) {
+			const float val = (i % 2 ? -1.f : 1.f) * std::ldexp(
+				randomFloat(state, 1.f, 2.f), (int)(i % 42) - 26);
+			const uint16_t h = dd_floatToHalf(val);
+			if (std::fabs(val) >= 65520.f) {
+				nearest &= (h & 0x7FFF) == 0x7C00;
+				continue;
+			}
+			const double err = std::fabs((double)dd_halfToFloat(h) - val);
+			for (const int step : { -1, 1 }) {
+				const uint16_t n = (uint16_t)(h + step);
+				if (((n ^ h) & 0x8000) || ((n >> 10) & 0x1F) == 31) {
+					continue;
+				}
+				const double other = std::fabs((double)dd_halfToFloat(n) - val);
+				nearest &= err < other || (err == other && !(h & 1));
+			}
+		}
+		DD_CHECK(nearest);
+		DD_CHECK(dd_floatToHalf(65504.f) == 0x7BFF);
+		DD_CHECK(dd_floatToHalf(65519.f) == 0x7BFF);
+		DD_CHECK(dd_floatToHalf(-65520.f) == 0xFC00);
+	}
+
+	/// \brief Every attribute encoding decodes within the error the
+	/// encoder reports in QuantizeError, and that error is within the
+	/// format's precision
+	void testVertexQuantize()
+	{
+		const size_t k_count = 4000;
+		std::vector<Vertex> vertices(k_count);
+		uint32_t state = 7u;
+		for (Vertex &v : vertices) {
+			v.position[0] = randomFloat(state, -3.f, 7.f);
+			v.position[1] = randomFloat(state, 100.f, 101.f);
+			v.position[2] = randomFloat(state, -0.5f, 0.25f);
+			randomDirection(state, v.normal);
+			v.texCoords[0] = randomFloat(state, 0.f, 2.f);
+			v.texCoords[1] = randomFloat(state, -1.f, 1.f);
+			randomDirection(state, v.tangent);
+			v.tangent[3] = randomFloat(state, -1.f, 1.f) < 0.f ? -1.f : 1.f;
+		}
+		// axis & diagonal directions (octahedron edges & folds)
+		const float k_dirs[][3] = {
+			{ 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 },
+			{ 0, 0, 1 }, { 0, 0, -1 }, { 0.6f, 0.f, -0.8f },
+			{ -0.6f, -0.8f, 0.f }, { 0.57735f, -0.57735f, -0.57735f } };
+		for (unsigned i = 0; i < 9; i++) {
+			memcpy(vertices[i].normal, k_dirs[i], sizeof(k_dirs[i]));
+			memcpy(vertices[i].tangent, k_dirs[8 - i], sizeof(k_dirs[i]));
+		}
+		VertexStreams streams;
+		dd_splitVertices(vertices.data(), k_count, streams, 2);
+
+		// largest bounding box sides (position x, uv u) & magnitudes
+		const float pos_extent = 10.f, uv_extent = 2.f;
+		float pos_abs = 0.f, uv_abs = 0.f;
+		for (const Vertex &v : vertices) {
+			for (int i = 0; i < 3; i++) {
+				pos_abs = std::max(pos_abs, std::fabs(v.position[i]));
+			}
+			for (int i = 0; i < 2; i++) {
+				uv_abs = std::max(uv_abs, std::fabs(v.texCoords[i]));
+			}
+		}
+
+		const DirectionEncoding k_dir_enc[] = {
+			DirectionEncoding::OCT_SNORM16, DirectionEncoding::SNORM10 };
+		const float k_dir_bound[] = { 0.01f, 0.2f };	// degrees
+		for (unsigned combo = 0; combo < 8; combo++) {
+			VertexEncoding enc;
+			const bool unorm = combo & 1;
+			enc.position = unorm ? PositionEncoding::UNORM16 :
+								   PositionEncoding::FLOAT16;
+			enc.texcoord = unorm ? TexCoordEncoding::FLOAT16 :
+								   TexCoordEncoding::UNORM16;
+			enc.normal = k_dir_enc[(combo >> 1) & 1];
+			enc.tangent = k_dir_enc[((combo >> 1) ^ (combo >> 2)) & 1];
+			const bool split = combo & 4;
+
+			VertexLayout layout = dd_vertexLayout(enc, true, true, split);
+			dd_vertexRanges(vertices.data(), k_count, layout);
+			std::vector<uint8_t> out;
+			QuantizeError reported;
+			dd_quantizeVertices(vertices.data(), k_count, layout, out,
+								reported, 3);
+			DD_CHECK(out.size() == k_count * layout.stride);
+			if (split) {
+				std::vector<uint8_t> from_streams;
+				QuantizeError streams_error;
+				dd_quantizeVertices(streams, layout, from_streams,
+									streams_error, 1);
+				DD_CHECK(from_streams == out);
+			}
+
+			QuantizeError measured;
+			bool signs = true;
+			for (size_t v = 0; v < k_count; v++) {
+				const Vertex &vert = vertices[v];
+				for (unsigned a = 0; a < layout.num_attribs; a++) {
+					const DDMVertexAttrib &attrib = layout.attribs[a];
+					const uint8_t* src = out.data() + (split ?
+						layout.streamOffset(a, k_count) + v * attrib.stride :
+						v * layout.stride + attrib.offset);
+					float dec[4];
+					decodeAttrib(src, attrib.format, layout.ranges[a], dec);
+					switch (attrib.semantic) {
+						case DDM_ATTRIB_POSITION:
+							for (int i = 0; i < 3; i++) {
+								measured.position = std::max(measured.position,
+									std::fabs(dec[i] - vert.position[i]));
+							}
+							break;
+						case DDM_ATTRIB_TEXCOORD:
+							for (int i = 0; i < 2; i++) {
+								measured.texcoord = std::max(measured.texcoord,
+									std::fabs(dec[i] - vert.texCoords[i]));
+							}
+							break;
+						case DDM_ATTRIB_NORMAL:
+							measured.normal_deg = std::max(measured.normal_deg,
+								(float)angleBetween(dec, vert.normal));
+							break;
+						case DDM_ATTRIB_TANGENT:
+							measured.tangent_deg = std::max(
+								measured.tangent_deg,
+								(float)angleBetween(dec, vert.tangent));
+							signs &= dec[3] == vert.tangent[3];
+							break;
+					}
+				}
+			}
+			DD_CHECK(signs);
+			// measured w/ a separate decoder: agrees w/ the report
+			DD_CHECK(measured.position <= reported.position * 1.0001f);
+			DD_CHECK(measured.texcoord <= reported.texcoord * 1.0001f);
+			DD_CHECK(measured.normal_deg <= reported.normal_deg + 1e-3f);
+			DD_CHECK(measured.tangent_deg <= reported.tangent_deg + 1e-3f);
+			DD_CHECK(reported.position <= measured.position * 1.0001f);
+			DD_CHECK(reported.texcoord <= measured.texcoord * 1.0001f);
+			// & within the format's precision
+			const float pos_bound = unorm ? pos_extent / 65535.f :
+											pos_abs / 2048.f;
+			const float uv_bound = unorm ? uv_abs / 2048.f :
+										   uv_extent / 65535.f;
+			DD_CHECK(reported.position > 0.f &&
+					 reported.position <= pos_bound);
+			DD_CHECK(reported.texcoord > 0.f &&
+					 reported.texcoord <= uv_bound);
+			DD_CHECK(reported.normal_deg > 0.f && reported.normal_deg <=
+					 k_dir_bound[enc.normal == DirectionEncoding::SNORM10]);
+			DD_CHECK(reported.tangent_deg > 0.f && reported.tangent_deg <=
+					 k_dir_bound[enc.tangent == DirectionEncoding::SNORM10]);
+		}
+
+		// float32: the vertices as they are, no error
+		VertexLayout raw = dd_vertexLayout(VertexEncoding(), true, true);
+		dd_vertexRanges(vertices.data(), k_count, raw);
+		DD_CHECK(raw.isRawVertex());
+		std::vector<uint8_t> out;
+		QuantizeError error;
+		dd_quantizeVertices(vertices.data(), k_count, raw, out, error, 2);
+		DD_CHECK(out.size() == k_count * sizeof(Vertex) &&
+				 memcmp(out.data(), vertices.data(), out.size()) == 0);
+		DD_CHECK(error.position == 0.f && error.normal_deg == 0.f &&
+				 error.tangent_deg == 0.f && error.texcoord == 0.f);
+	}
+
+	/// \brief Varint index streams decode exactly, across 16 & 32 bit
+	/// boundaries and base vertex offsets
+	void testIndexCodec()
+	{
+		// zigzag keeps small steps small & covers the whole int32 range
+		const int32_t k_steps[] = { 0, 1, -1, 63, -64, 64, 2147483647,
+									-2147483647 - 1 };
+		bool zigzag = true;
+		for (const int32_t step : k_steps) {
+			zigzag &= dd_indexcodec::unzigzag(
+				dd_indexcodec::zigzag(step)) == step;
+		}
+		DD_CHECK(zigzag);
+		DD_CHECK(dd_indexcodec::zigzag(-64) == 127);
+		DD_CHECK(dd_indexcodec::zigzag(64) == 128);
+
+		// bytes per index: 7 bits of zigzag step each
+		const uint32_t k_sizes[][2] = {
+			{ 63, 2 }, { 64, 3 }, { 8191, 3 }, { 8192, 4 }, { 0xFFFF, 4 },
+			{ 0x10000, 4 }, { 0xFFFFFFFFu, 2 }, { 0x7FFFFFFFu, 6 },
+			{ 0x80000000u, 6 } };
+		for (const auto &size : k_sizes) {
+			const uint32_t pair[2] = { 0, size[0] };
+			std::vector<uint8_t> out;
+			dd_encodeIndices(pair, 2, 0, out);
+			DD_CHECK(out.size() == size[1]);
+		}
+
+		// boundary values, big jumps both ways & runs, w/ several bases
+		std::vector<uint32_t> indices = {
+			0, 1, 2, 0xFFFE, 0xFFFF, 0x10000, 0x10001, 0xFFFF, 0,
+			0x7FFFFFFFu, 0x80000000u, 0xFFFFFFFEu, 0xFFFFFFFFu, 0, 0xFFFFFFFFu,
+			5, 5, 5 };
+		uint32_t state = 3u;
+		for (unsigned i = 0; i < 5000; i++) {
+			state = state * 1664525u + 1013904223u;
+			indices.push_back((i % 3) ? indices.back() + (state >> 28) - 8 :
+										state);
+		}
+		const uint32_t k_bases[] = { 0, 1, 65536, 0x80000000u, 0xFFFFFFFFu };
+		bool exact = true;
+		for (const uint32_t base : k_bases) {
+			// stored relative to base: decoding adds it back (mod 2^32)
+			std::vector<uint32_t> absolute(indices.size());
+			for (size_t i = 0; i < indices.size(); i++) {
+				absolute[i] = indices[i] + base;
+			}
+			std::vector<uint8_t> out = { 0xAB };	// appends
+			dd_encodeIndices(absolute.data(), absolute.size(), base, out);
+			std::vector<uint32_t> decoded(indices.size());
+			const size_t used = dd_decodeIndices(out.data() + 1,
+												 out.size() - 1,
+												 indices.size(), base,
+												 decoded.data());
+			exact &= used == out.size() - 1 && decoded == absolute;
+			// truncated: fails instead of reading past the end
+			exact &= dd_decodeIndices(out.data() + 1, out.size() - 2,
+									  indices.size(), base,
+									  decoded.data()) == 0;
+		}
+		DD_CHECK(exact);
+		// more than 5 bytes for one index is malformed
+		const uint8_t k_long[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x01 };
+		uint32_t idx;
+		DD_CHECK(dd_decodeIndices(k_long, sizeof(k_long), 1, 0, &idx) == 0);
+	}
+
+	/// \brief Binary export: each ebo's indices read back (16 bit, 32 bit
+	/// or varint, plus base_vertex) as the imported triangles. Ebo 0 spans
+	/// exactly 65536 vertices (16 bit), ebo 1 one more (32 bit)
+	void testIndexExport()
+	{
+		const unsigned k_side = 256;
+		std::string obj;
+		char line[96];
+		for (unsigned grid = 0; grid < 2; grid++) {
+			for (unsigned j = 0; j < k_side; j++) {
+				for (unsigned i = 0; i < k_side; i++) {
+					snprintf(line, sizeof(line), "v %u %u %u\n", i, j, grid);
+					obj += line;
+				}
+			}
+		}
+		obj += "v -1 -1 1\n";	// ebo 1's extra vertex
+		for (unsigned grid = 0; grid < 2; grid++) {
+			snprintf(line, sizeof(line), "usemtl grid%u\n", grid);
+			obj += line;
+			const unsigned first = grid * k_side * k_side + 1;
+			for (unsigned j = 0; j + 1 < k_side; j++) {
+				for (unsigned i = 0; i + 1 < k_side; i++) {
+					const unsigned a = first + j * k_side + i;
+					snprintf(line, sizeof(line), "f %u %u %u %u\n", a, a + 1,
+							 a + k_side + 1, a + k_side);
+					obj += line;
+				}
+			}
+		}
+		snprintf(line, sizeof(line), "f %u %u %u\n", 2 * k_side * k_side + 1,
+				 k_side * k_side + 1, k_side * k_side + 2);
+		obj += line;
+		if (!writeFile("test_ebos.obj", obj)) {
+			DD_CHECK(false);
+			return;
+		}
+
+		for (const bool varint : { false, true }) {
+			for (const bool fetch : { false, true }) {
+				ObjConvertOptions options;
+				options.generate_normals = false;
+				options.compress_indices = varint;
+				options.optimize_vertex_fetch = fetch;
+				DD_ObjConverter converter;
+				converter.setOptions(options);
+				DD_CHECK(converter.importOBJ("test_ebos.obj") ==
+						 ObjImportStatus::GOOD);
+				converter.setName("test_ebos");
+				DD_CHECK(converter.exportMesh(DDMFormat::BINARY, "."));
+				const std::string file = readFile("test_ebos.ddm");
+				const MeshContainer &mesh = converter.getMesh();
+				DD_CHECK(mesh.mesh_idx.numRows() == 2);
+				if (file.size() < sizeof(DDMHeader) ||
+					mesh.mesh_idx.numRows() != 2) {
+					DD_CHECK(false);
+					continue;
+				}
+				const uint8_t* data = (const uint8_t*)file.data();
+				DDMHeader header;
+				memcpy(&header, data, sizeof(header));
+				DD_CHECK(header.version_major == k_ddm_version_major);
+				std::vector<DDMEbo> ebos;
+				for (uint32_t b = 0; b < header.num_blocks; b++) {
+					DDMBlock block;
+					memcpy(&block, data + header.block_offset +
+						   b * sizeof(DDMBlock), sizeof(block));
+					if (block.type == DDM_BLOCK_EBOS) {
+						ebos.resize(block.count);
+						memcpy(ebos.data(), data + block.offset,
+							   block.count * sizeof(DDMEbo));
+					}
+				}
+				DD_CHECK(ebos.size() == 2);
+				if (ebos.size() != 2) { continue; }
+				DD_CHECK(ebos[0].index_size == 2 && ebos[1].index_size == 4);
+				DD_CHECK(ebos[1].base_vertex > 0);
+				bool same = true;
+				for (unsigned e = 0; e < 2; e++) {
+					const DDMEbo &ebo = ebos[e];
+					const vec3_u* tris = mesh.indices.data() +
+										 mesh.mesh_idx.GetElement(e, 0);
+					const unsigned num_tris = mesh.mesh_idx.GetElement(e, 1);
+					same &= ebo.num_indices == num_tris * 3;
+					std::vector<uint32_t> read(ebo.num_indices);
+					const uint8_t* src = data + ebo.offset;
+					if (varint) {
+						same &= dd_decodeIndices(src, file.size() - ebo.offset,
+												 read.size(), ebo.base_vertex,
+												 read.data()) > 0;
+					}
+					else {
+						for (size_t i = 0; i < read.size(); i++) {
+							uint32_t val = 0;
+							memcpy(&val, src + i * ebo.index_size,
+								   ebo.index_size);	// little endian
+							read[i] = val + ebo.base_vertex;
+						}
+					}
+					for (size_t i = 0; same && i < read.size(); i++) {
+						same &= read[i] == tris[i / 3].data[i % 3];
+					}
+				}
+				DD_CHECK(same);
+			}
+		}
+	}
+
+	struct TestCase
+	{
+		const char*	name;
+		void		(*run)();
+	};
+}
+
+int main()
+{
+	const TestCase tests[] = {
+		{ "high valence normals", testHighValenceNormals },
+		{ "implicit first ebo", testImplicitEbo },
+		{ "missing v/vt/vn", testMissingIndex },
+		{ "parallel & pipelined output", testParallelOutput },
+		{ "fixed point text", testFixedText },
+		{ "number scanners", testNumParse },
+		{ "relative indices", testRelativeIndices },
+		{ "index map", testIndexMap },
+		{ "half floats", testHalfFloat },
+		{ "vertex quantization", testVertexQuantize },
+		{ "varint index codec", testIndexCodec },
+		{ "exported indices", testIndexExport },
+	};
+
+	for (const TestCase &test : tests) {
+		const unsigned failures = g_failures;
+		printf("%s\n", test.name);
+		test.run();
+		printf("  %s\n", (g_failures == failures) ? "ok" : "FAILED");
+	}
+	printf("%u checks, %u failed\n", g_checks, g_failures);
+	return (g_failures == 0) ? 0 : 1;
+}